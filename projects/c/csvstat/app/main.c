@@ -2,17 +2,103 @@
 #include "csv.h"
 #include "stats.h"
 #include "csvstat_err.h"
+#include "numparse.h"
+#include "zonemap.h"
+#include "expr.h"
+#include "scan.h"
+#include "source.h"
+#include "watch.h"
+#include "checkpoint.h"
+#include "progress.h"
+#include "csvstat_alloc.h"
+#include "trace.h"
+#include "diag.h"
+#include "corr.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
 #include <math.h>
+#include <stdint.h>
+#include <limits.h>
+#include <time.h>
+#include <signal.h>
+#include <sys/stat.h>
 
 typedef struct {
     const char *file_path;
     const char *col_name;
     int quiet;
+    int no_quotes;  // treat '"' as an ordinary byte (v1 parsing)
+    char delim;     // field delimiter
+    int delim_auto; // sniff the delimiter from the header line
+
+    // Value-range filter on the stats column (inclusive bounds).
+    int has_range;
+    double range_lo;
+    double range_hi;
+
+    // Row filter expression (compiled against the header).
+    const char *where;
+
+    // Derived value expression used instead of --col.
+    const char *expr;
+
+    // Zone-map sidecar used to skip blocks that cannot match the range.
+    const char *zonemap_path;
+    size_t zonemap_rows;
+
+    // Worker threads for the scan (1 = sequential).
+    size_t threads;
+
+    // Pipe input: requested pipe buffer size (0 = leave as is) and the
+    // throughput report.
+    size_t pipe_size;
+    int io_stats;
+
+    // Follow an append-only file, printing a summary every interval.
+    int follow;
+    double follow_interval;  // seconds
+
+    // Resumable scan state, saved every checkpoint_every rows and at EOF.
+    const char *checkpoint_path;
+    size_t checkpoint_every;
+
+    // NDJSON progress lines every progress_interval seconds (0 = off), to
+    // progress_path or stderr.
+    double progress_interval;
+    const char *progress_path;
+
+    // Per-phase timing report on stderr (builds with CSVSTAT_PROFILE).
+    int profile;
+
+    // Allocation report on stderr; allocations after alloc_warmup rows per
+    // scanning thread are counted as steady-state.
+    int alloc_stats;
+    size_t alloc_warmup;
+
+    // Chrome trace-event timeline of the scan's threads.
+    const char *trace_path;
+
+    // Rows without a valid value, written as CSV with the header.
+    const char *reject_path;
+
+    // Skewness and kurtosis (third and fourth moments) in the summary.
+    int moments;
+
+    // Accumulation mode: Welford per value, or compensated blocks.
+    StatsPrecision precision;
+
+    // Exact fixed-point statistics with this many fractional digits.
+    int decimal;
+    unsigned decimal_scale;
+
+    // Columns to correlate (--corr), split from a copy of the list.
+    const char *corr;
+    const char *corr_names[CORR_MAX_COLS];
+    size_t ncorr;
+    char corr_buf[1024];
 } CliOptions;
 
 // Print usage to stderr
@@ -25,18 +111,146 @@ static void usage(FILE *out, const char *prog) {
     fprintf(out, 
         "csvstat – compute streaming stats for a numeric CSV column (v1)\n\n"
         "Usage:\n"
-        "  %s <csv-file> <column-name> [--quiet]\n"
-        "  %s --file <csv-file> --col <column-name> [--quiet]\n"
+        "  %s <csv-file>|- <column-name> [options]\n"
+        "  %s --file <csv-file> --col <column-name> [options]\n"
+        "  %s --file <csv-file> --expr <expression> [options]\n"
         "  %s --help\n\n"
         "Options:\n"
-        "  --file <path>     Input CSV file\n"
-        "  --col  <name>     Column name (must exist in header row)\n"
-        "  --quiet           Suppress non-fatal warnings\n"
-        "  --help            Show this help\n",
-        prog, prog, prog
+        "  --file <path>          Input CSV file ('-' reads stdin)\n"
+        "  --col  <name>          Column name (must exist in header row)\n"
+        "  --expr <expr>          Derived value instead of a column, e.g. 'price*qty',\n"
+        "                         'abs(x)', 'log(x)', 'qty > 0 ? price/qty : 0'\n"
+        "  --quiet                Suppress non-fatal warnings and the rejected-row report\n"
+        "  --no-quotes            Disable RFC 4180 quoted fields ('\"' is an ordinary byte)\n"
+        "  --delim <c>|tab|auto   Field delimiter (default ','); auto guesses from the header\n"
+        "  --range <lo>:<hi>      Only accumulate values in [lo, hi] (either bound may be empty)\n"
+        "  --where <expr>         Only use rows matching expr, e.g. 'qty > 5 && name != \"apple\"'\n"
+        "  --zonemap <path>       Per-block min/max sidecar: built on first run, used to skip blocks\n"
+        "  --zonemap-rows <n>     Rows per zone-map block when building (default 8192)\n"
+        "  --threads <n>          Scan the file with n worker threads (default 1)\n"
+        "                         (.zst input: decode up to n frames in parallel)\n"
+        "  --pipe-size <bytes>    Grow the stdin pipe buffer (Linux F_SETPIPE_SZ)\n"
+        "  --io-stats             Report input bytes, throughput and time spent waiting for input\n"
+        "  --follow               Keep reading lines appended to the file until interrupted\n"
+        "  --follow-interval <s>  Seconds between --follow summaries (default 5)\n"
+        "  --checkpoint <path>    Save scan state to path and resume from it on the next run\n"
+        "  --checkpoint-every <n> Rows between checkpoints (default 1000000)\n"
+        "  --progress-interval <s> Write an NDJSON progress line every s seconds\n"
+        "  --progress-file <path> Write progress lines to path instead of stderr\n"
+#ifdef CSVSTAT_PROFILE
+        "  --profile              Print time per phase (read/split/eval/parse/accum) to stderr\n"
+#endif
+        "  --alloc-stats          Print heap allocations per structure to stderr\n"
+        "  --alloc-warmup <n>     Rows per thread before allocations count as steady-state\n"
+        "                         (default 10000)\n"
+        "  --trace <path>         Write a Chrome/Perfetto trace of the scan's threads to path\n"
+        "  --reject-file <path>   Write rows with a missing or invalid value to path (CSV)\n"
+        "  --moments              Also report skewness and excess kurtosis (population and sample)\n"
+        "  --precision <mode>     welford (default), neumaier or pairwise: compensated sums\n"
+        "                         for an accurate mean on huge or large-magnitude inputs\n"
+        "  --decimal <scale>      Exact fixed-point sum/min/max/mean with scale (0-18)\n"
+        "                         fractional digits; inexact values are rejected\n"
+        "  --corr <x>,<y>[,...]   Covariance, Pearson r and the regression line of y on x;\n"
+        "                         with more columns, the correlation matrix\n"
+        "  --help                 Show this help\n",
+        prog, prog, prog, prog
     );
 }
 
+/*
+Parse a positive decimal integer option value (digits only).
+Returns 0 on success, -1 on failure.
+*/
+static int parse_size(const char *s, size_t *out) {
+    if (!s || !out || s[0] < '0' || s[0] > '9') return -1;
+
+    char *end = NULL;
+    errno = 0;
+    unsigned long long v = strtoull(s, &end, 10);
+    if (errno == ERANGE || *end != '\0' || v > (unsigned long long)SIZE_MAX) return -1;
+
+    *out = (size_t)v;
+    return 0;
+}
+
+/*
+Parse a --delim value: a single byte, "tab" (or a literal "\t"), or "auto".
+Returns 0 on success, -1 on failure.
+*/
+static int parse_delim(const char *s, char *delim, int *is_auto) {
+    if (!s || !delim || !is_auto) return -1;
+
+    *is_auto = 0;
+    if (strcmp(s, "auto") == 0) {
+        *is_auto = 1;
+        *delim = ',';
+        return 0;
+    }
+    if (strcmp(s, "tab") == 0 || strcmp(s, "\\t") == 0) {
+        *delim = '\t';
+        return 0;
+    }
+    if (s[0] == '\0' || s[1] != '\0') return -1;
+    if (s[0] == '"' || s[0] == '\n' || s[0] == '\r') return -1;
+
+    *delim = s[0];
+    return 0;
+}
+
+/*
+Parse "LO:HI" into inclusive bounds. Either side may be empty to leave the
+range open on that side (e.g. "1000:" means x >= 1000).
+Returns 0 on success, -1 on failure.
+*/
+static int parse_range(const char *s, double *lo, double *hi) {
+    if (!s || !lo || !hi) return -1;
+
+    const char *colon = strchr(s, ':');
+    if (!colon) return -1;
+
+    char buf[64];
+    size_t n = (size_t)(colon - s);
+
+    *lo = -INFINITY;
+    if (n > 0) {
+        if (n >= sizeof buf) return -1;
+        memcpy(buf, s, n);
+        buf[n] = '\0';
+        if (parse_double_strict(buf, lo) != 0) return -1;
+    }
+
+    *hi = INFINITY;
+    if (colon[1] != '\0') {
+        if (parse_double_strict(colon + 1, hi) != 0) return -1;
+    }
+
+    return (*lo <= *hi) ? 0 : -1;
+}
+
+/*
+Split a --corr list ("price,qty,...") into opt->corr_names, using a copy in
+opt->corr_buf. Names must be non-empty; 2..CORR_MAX_COLS of them.
+Returns 0 on success, -1 on failure.
+*/
+static int parse_corr(const char *s, CliOptions *opt) {
+    size_t len = strlen(s);
+    if (len >= sizeof opt->corr_buf) return -1;
+    memcpy(opt->corr_buf, s, len + 1);
+
+    opt->corr = s;
+    opt->ncorr = 0;
+    char *name = opt->corr_buf;
+    for (;;) {
+        char *comma = strchr(name, ',');
+        if (comma) *comma = '\0';
+        if (name[0] == '\0' || opt->ncorr == CORR_MAX_COLS) return -1;
+        opt->corr_names[opt->ncorr++] = name;
+        if (!comma) break;
+        name = comma + 1;
+    }
+    return opt->ncorr >= 2 ? 0 : -1;
+}
+
 static int parse_cli(int argc, char **argv, CliOptions *opt) {
     /*
     int argc: argument count
@@ -50,6 +264,36 @@ static int parse_cli(int argc, char **argv, CliOptions *opt) {
     opt->file_path = NULL;
     opt->col_name = NULL;
     opt->quiet = 0;
+    opt->no_quotes = 0;
+    opt->delim = ',';
+    opt->delim_auto = 0;
+    opt->has_range = 0;
+    opt->range_lo = -INFINITY;
+    opt->range_hi = INFINITY;
+    opt->where = NULL;
+    opt->expr = NULL;
+    opt->zonemap_path = NULL;
+    opt->zonemap_rows = 0;
+    opt->threads = 1;
+    opt->pipe_size = 0;
+    opt->io_stats = 0;
+    opt->follow = 0;
+    opt->follow_interval = 5.0;
+    opt->checkpoint_path = NULL;
+    opt->checkpoint_every = 1000000;
+    opt->progress_interval = 0.0;
+    opt->progress_path = NULL;
+    opt->profile = 0;
+    opt->alloc_stats = 0;
+    opt->alloc_warmup = 0;
+    opt->trace_path = NULL;
+    opt->reject_path = NULL;
+    opt->moments = 0;
+    opt->precision = STATS_WELFORD;
+    opt->decimal = 0;
+    opt->decimal_scale = 0;
+    opt->corr = NULL;
+    opt->ncorr = 0;
 
     // if (argc == 2 && strcmp(argv[1], "--help") == 0) {
     //     usage(stdout, argv[0]);
@@ -80,6 +324,15 @@ static int parse_cli(int argc, char **argv, CliOptions *opt) {
             return -1; // do not allow mixing --help with other args
         } else if (strcmp(a, "--quiet") == 0) {
             opt->quiet = 1;
+        } else if (strcmp(a, "--no-quotes") == 0) {
+            opt->no_quotes = 1;
+        } else if (strcmp(a, "--delim") == 0) {
+            if (i + 1 >= argc) {
+                return -1;
+            }
+            if (parse_delim(argv[++i], &opt->delim, &opt->delim_auto) != 0) {
+                return -1;
+            }
         } else if (strcmp(a, "--file") == 0) {
             if (i + 1 >= argc) {
                 return -1;
@@ -98,8 +351,132 @@ static int parse_cli(int argc, char **argv, CliOptions *opt) {
             }
             opt->col_name = argv[++i];
             saw_flag_col = 1;
-        } else if (a[0] == '-') {
-            return -1; // unknown flag
+        } else if (strcmp(a, "--range") == 0) {
+            if (i + 1 >= argc) {
+                return -1;
+            }
+            if (parse_range(argv[++i], &opt->range_lo, &opt->range_hi) != 0) {
+                return -1;
+            }
+            opt->has_range = 1;
+        } else if (strcmp(a, "--where") == 0) {
+            if (i + 1 >= argc || opt->where) {
+                return -1;
+            }
+            opt->where = argv[++i];
+        } else if (strcmp(a, "--expr") == 0) {
+            if (i + 1 >= argc || opt->expr) {
+                return -1;
+            }
+            opt->expr = argv[++i];
+        } else if (strcmp(a, "--zonemap") == 0) {
+            if (i + 1 >= argc) {
+                return -1;
+            }
+            opt->zonemap_path = argv[++i];
+        } else if (strcmp(a, "--zonemap-rows") == 0) {
+            if (i + 1 >= argc) {
+                return -1;
+            }
+            if (parse_size(argv[++i], &opt->zonemap_rows) != 0 || opt->zonemap_rows == 0) {
+                return -1;
+            }
+        } else if (strcmp(a, "--threads") == 0) {
+            if (i + 1 >= argc) {
+                return -1;
+            }
+            if (parse_size(argv[++i], &opt->threads) != 0 || opt->threads == 0) {
+                return -1;
+            }
+        } else if (strcmp(a, "--pipe-size") == 0) {
+            if (i + 1 >= argc) {
+                return -1;
+            }
+            if (parse_size(argv[++i], &opt->pipe_size) != 0 || opt->pipe_size == 0) {
+                return -1;
+            }
+        } else if (strcmp(a, "--io-stats") == 0) {
+            opt->io_stats = 1;
+        } else if (strcmp(a, "--follow") == 0) {
+            opt->follow = 1;
+        } else if (strcmp(a, "--follow-interval") == 0) {
+            if (i + 1 >= argc) {
+                return -1;
+            }
+            if (parse_double_strict(argv[++i], &opt->follow_interval) != 0 ||
+                !(opt->follow_interval > 0.0) || opt->follow_interval > 86400.0) {
+                return -1;
+            }
+        } else if (strcmp(a, "--checkpoint") == 0) {
+            if (i + 1 >= argc) {
+                return -1;
+            }
+            opt->checkpoint_path = argv[++i];
+        } else if (strcmp(a, "--checkpoint-every") == 0) {
+            if (i + 1 >= argc) {
+                return -1;
+            }
+            if (parse_size(argv[++i], &opt->checkpoint_every) != 0 || opt->checkpoint_every == 0) {
+                return -1;
+            }
+        } else if (strcmp(a, "--progress-interval") == 0) {
+            if (i + 1 >= argc) {
+                return -1;
+            }
+            if (parse_double_strict(argv[++i], &opt->progress_interval) != 0 ||
+                !(opt->progress_interval > 0.0) || opt->progress_interval > 86400.0) {
+                return -1;
+            }
+        } else if (strcmp(a, "--progress-file") == 0) {
+            if (i + 1 >= argc) {
+                return -1;
+            }
+            opt->progress_path = argv[++i];
+        } else if (strcmp(a, "--profile") == 0) {
+#ifdef CSVSTAT_PROFILE
+            opt->profile = 1;
+#else
+            fprintf(stderr, "csvstat: --profile: built without phase timers (rebuild with PROFILE=1)\n");
+            return -1;
+#endif
+        } else if (strcmp(a, "--alloc-stats") == 0) {
+            opt->alloc_stats = 1;
+        } else if (strcmp(a, "--alloc-warmup") == 0) {
+            if (i + 1 >= argc) {
+                return -1;
+            }
+            if (parse_size(argv[++i], &opt->alloc_warmup) != 0 || opt->alloc_warmup == 0) {
+                return -1;
+            }
+        } else if (strcmp(a, "--trace") == 0) {
+            if (i + 1 >= argc) {
+                return -1;
+            }
+            opt->trace_path = argv[++i];
+        } else if (strcmp(a, "--reject-file") == 0) {
+            if (i + 1 >= argc) {
+                return -1;
+            }
+            opt->reject_path = argv[++i];
+        } else if (strcmp(a, "--moments") == 0) {
+            opt->moments = 1;
+        } else if (strcmp(a, "--precision") == 0) {
+            if (i + 1 >= argc || stats_precision_parse(argv[++i], &opt->precision) != 0) {
+                return -1;
+            }
+        } else if (strcmp(a, "--decimal") == 0) {
+            size_t scale = 0;
+            if (i + 1 >= argc || parse_size(argv[++i], &scale) != 0 || scale > DECIMAL_MAX_SCALE) {
+                return -1;
+            }
+            opt->decimal = 1;
+            opt->decimal_scale = (unsigned)scale;
+        } else if (strcmp(a, "--corr") == 0) {
+            if (i + 1 >= argc || parse_corr(argv[++i], opt) != 0) {
+                return -1;
+            }
+        } else if (a[0] == '-' && a[1] != '\0') {
+            return -1; // unknown flag ("-" alone is stdin)
         } else {
             // Positional mode: allow exactly two positional args total: file then column.
             // Mixed mode with --quiet is allowed, but mixing with --file/--col is not.
@@ -109,7 +486,7 @@ static int parse_cli(int argc, char **argv, CliOptions *opt) {
 
             if (positional_count == 0) {
                 opt->file_path = a;
-            } else if (positional_count == 1) {
+            } else if (positional_count == 1 && !opt->expr) {
                 opt->col_name = a;
             } else {
                 return -1; // too many positional args
@@ -118,13 +495,95 @@ static int parse_cli(int argc, char **argv, CliOptions *opt) {
         }
     }
 
-    if (!opt->file_path || !opt->col_name) {
+    // --corr alone summarizes its first column.
+    if (opt->corr && !opt->col_name && !opt->expr) {
+        opt->col_name = opt->corr_names[0];
+    }
+
+    // Exactly one value source: a column or a derived expression.
+    if (!opt->file_path || (!opt->col_name == !opt->expr)) {
+        return -1;
+    }
+
+    // Zone maps record and skip blocks in file order; keep that sequential.
+    if (opt->threads > 1 && opt->zonemap_path) {
+        return -1;
+    }
+
+    // A zone map is keyed to a file's identity, which stdin does not have.
+    if (opt->zonemap_path && strcmp(opt->file_path, "-") == 0) {
+        return -1;
+    }
+
+    // Following reads one growing file, line by line, on this thread.
+    if (opt->follow && (opt->threads > 1 || opt->zonemap_path || strcmp(opt->file_path, "-") == 0)) {
+        return -1;
+    }
+
+    // --follow prints its own periodic summaries, and never finishes a profile.
+    if ((opt->progress_interval > 0.0 || opt->profile || opt->alloc_stats) && opt->follow) {
+        return -1;
+    }
+    if (opt->alloc_warmup && !opt->alloc_stats) {
+        return -1;
+    }
+    if (opt->alloc_stats && opt->alloc_warmup == 0) {
+        opt->alloc_warmup = ALLOC_WARMUP_ROWS;
+    }
+    if (opt->progress_path && !(opt->progress_interval > 0.0)) {
+        return -1;
+    }
+
+    // A checkpoint is one offset into one re-readable file, scanned in order.
+    if (opt->checkpoint_path && (opt->threads > 1 || opt->zonemap_path || opt->follow ||
+                                 strcmp(opt->file_path, "-") == 0)) {
+        return -1;
+    }
+
+    // The correlation state is not part of a checkpoint.
+    if (opt->corr && opt->checkpoint_path) {
+        return -1;
+    }
+
+    // --decimal keeps integers only: no derived values, bounds or moments.
+    if (opt->decimal && (opt->expr || opt->has_range || opt->moments ||
+                         opt->precision != STATS_WELFORD)) {
         return -1;
     }
 
     return 0;
 }
 
+/*
+Wall-clock seconds for the --io-stats report.
+*/
+static double wall_seconds(void) {
+    struct timespec ts;
+    if (timespec_get(&ts, TIME_UTC) != TIME_UTC) return 0.0;
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/*
+Return 1 if zone-map block `b` may hold a row that passes both the --range
+filter on the stats column and the column bounds implied by --where.
+*/
+static int block_may_match(const ZoneMap *zm, size_t b, const CliOptions *opt,
+                           size_t col_index, const ExprProgram *where) {
+    // --range bounds a derived value under --expr, which the map cannot see,
+    // and does not filter the rows --corr sees.
+    if (opt->has_range && !opt->expr && !opt->corr &&
+        !zonemap_block_may_match(zm, b, col_index, opt->range_lo, opt->range_hi)) {
+        return 0;
+    }
+    if (where) {
+        for (size_t i = 0; i < where->nbounds; i++) {
+            const ExprBound *eb = &where->bounds[i];
+            if (!zonemap_block_may_match(zm, b, eb->col, eb->lo, eb->hi)) return 0;
+        }
+    }
+    return 1;
+}
+
 static int die(CsvStatErr code, const char *context) {
     if (context && context[0]) {
         fprintf(stderr, "csvstat: %s: %s\n", context, csvstat_err_str(code));
@@ -155,57 +614,376 @@ static int die_errno(CsvStatErr code, const char *context, int errnum) {
 }
 
 /*
-Empty-line policy:
-Skip empty or whitespace-only lines.
-We treat spaces and tabs as whitespace for this project version.
+--corr: the pair statistics of two columns, or the matrix of Pearson r
+(one line per column) for more.
 */
-static int is_empty_line(const char *s) {
-    // "empty line" policy: skip empty or whitespace-only
-    while (*s) {
-        if (*s != ' ' && *s != '\t') return 0;
-        s++;
+static void print_corr(const CliOptions *opt, const ScanState *ss) {
+    double v = 0.0;
+
+    printf("corr: %s\n", opt->corr);
+    printf("corr_skipped: %zu\n", ss->sc.corr_skipped);
+    if (opt->ncorr == 2) {
+        static const char *const names[4] = { "covariance", "pearson_r", "slope", "intercept" };
+        int (*const fns[4])(const CoMoment *, double *) = {
+            comoment_covariance, comoment_pearson, comoment_slope, comoment_intercept,
+        };
+        printf("corr_rows: %zu\n", ss->co.n);
+        for (size_t i = 0; i < 4; i++) {
+            if (fns[i](&ss->co, &v) == 0) {
+                printf("%s: %.17g\n", names[i], v);
+            } else {
+                printf("%s: n/a\n", names[i]);
+            }
+        }
+        return;
+    }
+
+    printf("corr_rows: %zu\n", ss->cm.n);
+    for (size_t i = 0; i < opt->ncorr; i++) {
+        printf("pearson_r.%s:", opt->corr_names[i]);
+        for (size_t j = 0; j < opt->ncorr; j++) {
+            CoMoment co;
+            if (corr_matrix_pair(&ss->cm, i, j, &co) == 0 && comoment_pearson(&co, &v) == 0) {
+                printf(" %.17g", v);
+            } else {
+                printf(" n/a");
+            }
+        }
+        printf("\n");
     }
-    
-    return 1;
 }
 
 /*
-Strict numeric parsing:
-- rejects empty strings
-- uses strtod
-- allows trailing spaces/tabs only
-- rejects junk suffix (e.g., "12abc")
-Returns:
-- 0 on success and writes to *out
-- -1 on failure
+Print the summary block for the current state of a scan.
+Returns CSVSTAT_OK, or CSVSTAT_EINTERNAL if a statistic cannot be read.
 */
-static int parse_double_strict(const char *s, double *out) {
-    // Null checks
-    if (!s || !out) return -1;
+static CsvStatErr print_summary(const CliOptions *opt, const char *col_name, const Source *src,
+                                const ScanState *ss, const ZoneMap *zm,
+                                size_t blocks_pruned, size_t rows_pruned, double t_scan) {
+    const ScanCounters *sc = &ss->sc;
+    const Stats *st = &ss->st;
 
-    // Reject empty string
-    if (s[0] == '\0') return -1;
+    printf("file: %s\n", opt->file_path);
+    if (opt->expr) {
+        printf("expr: %s\n", opt->expr);
+    } else {
+        printf("column: %s\n", col_name);
+    }
+    if (src->kind != SOURCE_PLAIN) {
+        printf("compression: %s\n", source_kind_name(src->kind));
+    }
+    if (opt->delim_auto) {
+        if (opt->delim == '\t') {
+            printf("delimiter: tab\n");
+        } else {
+            printf("delimiter: %c\n", opt->delim);
+        }
+    }
+    // Pruned rows were seen through the zone map (none of them can match),
+    // so rows_seen is the same whether or not blocks were skipped.
+    printf("rows_seen: %zu\n", sc->rows_seen + rows_pruned);
+    printf("missing_column: %zu\n", sc->missing_col);
+    printf("numeric_ok: %zu\n", sc->numeric_ok);
+    printf("numeric_bad: %zu\n", sc->numeric_bad);
+    if (opt->where) {
+        printf("where_rejected: %zu\n", sc->where_rejected);
+    }
+    if (opt->has_range) {
+        printf("range_rejected: %zu\n", sc->range_rejected);
+    }
+    if (opt->zonemap_path) {
+        printf("blocks_total: %zu\n", zm ? zm->nblocks : 0);
+        printf("blocks_pruned: %zu\n", blocks_pruned);
+        printf("rows_pruned: %zu\n", rows_pruned);
+    }
 
-    char *end = NULL;
-    errno = 0;
-    double v = strtod(s, &end);
+    double v = 0.0;
+    size_t n = stats_count(st);
 
-    // No conversion performed
-    if (end == s) return -1;
+    if (opt->decimal) {
+        // Exact: printed from the scaled integers, never through a double.
+        const DecStats *d = &ss->dec;
+        unsigned scale = opt->decimal_scale;
+        dec128 mean = 0;
+        if (d->n == 0) {
+            printf("min: n/a\n");
+            printf("max: n/a\n");
+            printf("sum: 0\n");
+            printf("mean: n/a\n");
+            printf("stddev_sample: n/a\n");
+        } else {
+            if (decimal_stats_mean(d, &mean) != 0) {
+                return CSVSTAT_EINTERNAL;
+            }
+            printf("min: ");
+            decimal_print(stdout, d->min, scale);
+            printf("\nmax: ");
+            decimal_print(stdout, d->max, scale);
+            printf("\nsum: ");
+            decimal_print(stdout, d->sum, scale);
+            printf("\nmean: ");
+            decimal_print(stdout, mean, scale + DECIMAL_MEAN_DIGITS);
+            printf("\n");
+            if (decimal_stats_stddev(d, scale, &v) == 0) {
+                printf("stddev_sample: %.17g\n", v);
+            } else {
+                printf("stddev_sample: n/a\n");
+            }
+        }
+    } else if (!stats_has_data(st)) {
+        printf("min: n/a\n");
+        printf("max: n/a\n");
+        printf("mean: n/a\n");
+        printf("stddev_sample: n/a\n");
+    } else {
+        // n >= 1
+        // There should succeed when n > 0; if they fail, treat as internal error.
+        if (stats_min(st, &v) != 0) {
+            return CSVSTAT_EINTERNAL;
+        }
+        printf("min: %.17g\n", v);
 
-    // Allow trailing spaces/tabs only
-    while (*end == ' ' || *end == '\t') end++;
+        if (stats_max(st, &v) != 0) {
+            return CSVSTAT_EINTERNAL;
+        }
+        printf("max: %.17g\n", v);
+        
+        if (stats_mean(st, &v) != 0) {
+            return CSVSTAT_EINTERNAL;
+        }
+        printf("mean: %.17g\n", v);
+        
+        if (!stats_has_sample_variance(st)) {
+            // Sample standard deviation is undefined for n < 2.
+            (void)n; // n kept for readibility / potential future printing
+            printf("stddev_sample: n/a\n");
+        } else {
+            if (stats_stddev_sample(st, &v) != 0) {
+                return CSVSTAT_EINTERNAL;
+            }
+            printf("stddev_sample: %.17g\n", v);
+        }
+    }
 
-    // Any remaining characters => invalid numeric token
-    if (*end != '\0') return -1;
+    if (opt->moments) {
+        // Undefined for too few values or zero spread.
+        static const char *const names[4] = {
+            "skewness_population", "skewness_sample", "kurtosis_population", "kurtosis_sample",
+        };
+        int (*const fns[4])(const Stats *, double *) = {
+            stats_skewness_population, stats_skewness_sample,
+            stats_kurtosis_population, stats_kurtosis_sample,
+        };
+        for (size_t i = 0; i < 4; i++) {
+            if (fns[i](st, &v) == 0) {
+                printf("%s: %.17g\n", names[i], v);
+            } else {
+                printf("%s: n/a\n", names[i]);
+            }
+        }
+    }
+
+    if (opt->corr) {
+        print_corr(opt, ss);
+    }
+
+    if (opt->io_stats) {
+        // A wait share near 1 means the producer (or decoder) is the
+        // bottleneck; near 0 means csvstat is.
+        double wait = (double)src->wait_ns / 1e9;
+        printf("input_bytes: %llu\n", src->pos);
+        printf("input_seconds: %.3f\n", t_scan);
+        printf("input_mib_per_s: %.1f\n", t_scan > 0 ? (double)src->pos / (1024.0 * 1024.0) / t_scan : 0.0);
+        printf("input_wait_seconds: %.3f\n", wait);
+    }
+
+    return CSVSTAT_OK;
+}
+
+/*
+Set by SIGINT/SIGTERM to end --follow; the final summary is still printed.
+*/
+static volatile sig_atomic_t follow_stop = 0;
+
+static void on_follow_signal(int sig) {
+    (void)sig;
+    follow_stop = 1;
+}
+
+/*
+--follow: process complete lines as they are appended to the file, printing
+a summary every `opt->follow_interval` seconds when rows changed, until a
+signal arrives or the file is truncated. The reader holds a partial last
+line until its newline is written.
 
-    // Treat ERANGE as invalid (overflow/underflow) - Number too large
-    if (errno == ERANGE) return -1;
+Returns CSVSTAT_OK, or the error that should abort the scan.
+*/
+static CsvStatErr follow_scan(const CliOptions *opt, const char *col_name, Source *src,
+                              LineReader *lr, ScanState *ss, double t_start, int *saved_errno) {
+    FileWatch fw;
+    if (file_watch_init(&fw, opt->file_path) != 0) return CSVSTAT_EINTERNAL;
+
+    void (*prev_int)(int) = signal(SIGINT, on_follow_signal);
+    void (*prev_term)(int) = signal(SIGTERM, on_follow_signal);
+
+    CsvStatErr err = CSVSTAT_OK;
+    size_t printed_rows = (size_t)-1;
+    double next_print = wall_seconds() + opt->follow_interval;
+
+    while (!follow_stop) {
+        // Everything complete so far; a partial last line stays held.
+        for (;;) {
+            const char *line = NULL;
+            size_t len = 0;
+
+            int rc = line_reader_next(lr, &line, &len);
+            if (rc == 1) break;
+            if (rc != 0) {
+                err = CSVSTAT_EIO;
+                *saved_errno = errno;
+                goto done;
+            }
+            if (scan_is_empty_line(line)) continue;
 
-    // Reject NaN / +/-Inf
-    if (!isfinite(v)) return -1;
+            err = scan_row(ss, (char *)line, NULL, 0);
+            if (err != CSVSTAT_OK) goto done;
+        }
+
+        // Flush buffered --expr rows so the summary is current.
+        err = scan_finish(ss);
+        if (err != CSVSTAT_OK) goto done;
 
-    *out = v;
+        double now = wall_seconds();
+        if (now >= next_print) {
+            if (ss->sc.rows_seen != printed_rows) {
+                err = print_summary(opt, col_name, src, ss, NULL, 0, 0, now - t_start);
+                if (err != CSVSTAT_OK) goto done;
+                printf("\n");
+                fflush(stdout);
+                printed_rows = ss->sc.rows_seen;
+            }
+            next_print = now + opt->follow_interval;
+        }
+
+        // Offsets only grow in an append-only file.
+        struct stat sb;
+        if (fstat(src->fd, &sb) == 0 && (unsigned long long)sb.st_size < src->pos) {
+            if (!opt->quiet) {
+                fprintf(stderr, "csvstat: --follow: %s was truncated; stopping\n", opt->file_path);
+            }
+            break;
+        }
+
+        double wait = next_print - wall_seconds();
+        int wait_ms = (wait > 0.0) ? (int)(wait * 1000.0) + 1 : 1;
+        if (file_watch_wait(&fw, wait_ms) < 0) {
+            err = CSVSTAT_EIO;
+            *saved_errno = errno;
+            goto done;
+        }
+    }
+
+done:
+    signal(SIGINT, prev_int == SIG_ERR ? SIG_DFL : prev_int);
+    signal(SIGTERM, prev_term == SIG_ERR ? SIG_DFL : prev_term);
+    file_watch_destroy(&fw);
+    return err;
+}
+
+/*
+Hash of everything a checkpoint's state depends on besides the input bytes:
+the value (column or expression), the filters, the dialect and the header.
+A checkpoint taken under a different job is not resumed.
+*/
+static uint64_t checkpoint_job(const CliOptions *opt, const CsvRowView *header) {
+    uint64_t h = CHECKPOINT_HASH_SEED;
+    const char *parts[3] = {
+        opt->expr ? "expr" : "col",
+        opt->expr ? opt->expr : opt->col_name,
+        opt->where ? opt->where : "",
+    };
+    for (size_t i = 0; i < 3; i++) {
+        h = checkpoint_hash(h, parts[i], strlen(parts[i]) + 1);  // keep the NUL as separator
+    }
+
+    double range[2] = { opt->range_lo, opt->range_hi };
+    int flags[7] = { opt->has_range, !opt->no_quotes, (unsigned char)opt->delim, opt->moments,
+                     (int)opt->precision, opt->decimal ? (int)opt->decimal_scale : -1,
+                     opt->reject_path != NULL };
+    h = checkpoint_hash(h, range, sizeof range);
+    h = checkpoint_hash(h, flags, sizeof flags);
+
+    for (size_t i = 0; i < header->nfields; i++) {
+        h = checkpoint_hash(h, header->fields[i], strlen(header->fields[i]) + 1);
+    }
+    return h;
+}
+
+/*
+Checkpoint target for --checkpoint (see `checkpoint_write()`).
+*/
+typedef struct {
+    const char *path;   // checkpoint file
+    const char *input;  // input file
+    int compressed;
+    uint64_t job;
+    DiagRejects *rejects;   // --reject-file, or NULL
+} CheckpointCtx;
+
+/*
+Save the state of `ss` as resumable at `offset`. Queued --reject-file rows
+are written and synced first, so the saved file length covers them.
+Returns 0 on success, -1 on I/O error (errno is set).
+*/
+static int checkpoint_write(const CheckpointCtx *cc, ScanState *ss, unsigned long long offset) {
+    Checkpoint cp;
+    cp.job = cc->job;
+    cp.offset = offset;
+    cp.row_no = ss->row_no;
+    cp.sc = ss->sc;
+    cp.st = ss->st;
+    cp.dec = ss->dec;
+    cp.diag = ss->diag;  // only the counts and examples are saved
+    cp.reject_offset = 0;
+    if (cc->rejects) {
+        diag_flush(&ss->diag);
+        if (diag_rejects_sync(cc->rejects, &cp.reject_offset) != 0) return -1;
+    }
+
+    if (checkpoint_identify(&cp, cc->input, cc->compressed) != 0) return -1;
+    return checkpoint_save(cc->path, &cp);
+}
+
+/*
+Periodic work driven by the scan's tick hook: --checkpoint,
+--progress-interval and the end of the --alloc-stats warm-up.
+*/
+typedef struct {
+    const CheckpointCtx *ckpt;  // NULL without --checkpoint
+    size_t ckpt_every;          // rows between checkpoints
+    size_t ckpt_row;            // row_no at the last checkpoint
+    Progress *progress;         // NULL without --progress-interval
+    size_t alloc_warmup;        // rows before steady state (0 without --alloc-stats)
+} ScanHooks;
+
+/*
+ScanTickFn for ScanHooks. Under --threads checkpoints are off; progress
+updates are thread-safe and the steady-state mark is per thread, so every
+worker ends its own warm-up.
+*/
+static int scan_hooks_tick(void *ctx, ScanState *ss, unsigned long long offset) {
+    ScanHooks *h = (ScanHooks *)ctx;
+
+    if (h->alloc_warmup && ss->row_no >= h->alloc_warmup) {
+        csvstat_alloc_steady(1);
+    }
+    if (h->progress && progress_update(h->progress, ss, offset - ss->tick_origin) != 0) {
+        return -1;
+    }
+    if (h->ckpt && ss->row_no - h->ckpt_row >= h->ckpt_every) {
+        h->ckpt_row = ss->row_no;
+        return checkpoint_write(h->ckpt, ss, offset);
+    }
     return 0;
 }
 
@@ -220,24 +998,51 @@ int main(int argc, char **argv) {
     }
 
     const char *path = opt.file_path;
-    const char *col_name = opt.col_name;
+    const char *col_name = opt.col_name ? opt.col_name : opt.expr;
 
     CsvStatErr err = CSVSTAT_OK;
-    int fp_open = 0;
+    int src_open = 0;
     int lr_init = 0;
     int parser_init = 0;
+    int zm_init = 0;
+    int where_init = 0;
+    int expr_init = 0;
+    int ss_init = 0;
+    int hindex_init = 0;
+    int progress_on = 0;
+    int rejects_open = 0;
     int saved_errno = 0;
+    size_t rows_scanned = 0;  // for the --alloc-stats report
 
-    FILE *fp = fopen(path, "rb");
-    if (!fp) {
+    // gzip/zstd input is detected from the magic bytes and decoded on
+    // background threads; the rest of the scan only sees decoded bytes.
+    double t_start = wall_seconds();
+
+    // Before the source opens, so its decoder threads are traced too.
+    if (opt.trace_path) {
+        if (trace_open(opt.trace_path) != 0) {
+            err = CSVSTAT_EIO;
+            saved_errno = errno;
+            goto cleanup;
+        }
+        trace_thread_name("main");
+    }
+
+    Source src;
+    if (source_open(&src, path, opt.threads) != 0) {
         err = CSVSTAT_EIO;
         saved_errno = errno;
         goto cleanup;
     }
-    fp_open = 1;
+    src_open = 1;
+
+    // A larger pipe buffer lets the producer run ahead between our reads.
+    if (opt.pipe_size > 0 && source_set_pipe_size(&src, opt.pipe_size) != 0 && !opt.quiet) {
+        fprintf(stderr, "csvstat: --pipe-size: %s\n", strerror(errno));
+    }
 
     LineReader lr;
-    if (line_reader_init(&lr, fp) != 0) {
+    if (line_reader_init_source(&lr, &src) != 0) {
         err = CSVSTAT_EIO;
         if (saved_errno == 0) saved_errno = errno;
         goto cleanup;
@@ -251,12 +1056,33 @@ int main(int argc, char **argv) {
     }
     parser_init = 1;
 
+    // Quoted fields may span lines, so the reader and parser must agree.
+    line_reader_set_quotes(&lr, !opt.no_quotes);
+    csv_parser_set_quotes(&parser, !opt.no_quotes);
+
     const char *line = NULL;
     size_t len = 0;
 
+    // A growing file may end mid-line; such a line is completed later.
+    line_reader_set_hold_partial(&lr, opt.follow);
+
+    // Set up while the header is still in the line buffer (see below).
+    CheckpointCtx ckpt = {
+        .path = opt.checkpoint_path,
+        .input = path,
+        .compressed = src.kind != SOURCE_PLAIN,
+        .job = 0,
+        .rejects = NULL,
+    };
+    Checkpoint cp;
+    int resume = 0;  // cp is a checkpoint of this job and input
+
     // ---- Read header (skip empty lines) ----
     CsvRowView header = (CsvRowView){0};
+    DiagRejects rejects;
+    CsvHeaderIndex hindex;
     size_t col_index = 0;
+    size_t corr_cols[CORR_MAX_COLS];
 
     for (;;) {
         int rc = line_reader_next(&lr, &line, &len);
@@ -270,10 +1096,18 @@ int main(int argc, char **argv) {
             goto cleanup;
         }
 
-        if (is_empty_line(line)) {
+        if (scan_is_empty_line(line)) {
             continue; // skip empty/whitespace-only lines
         }
 
+        if (opt.delim_auto) {
+            opt.delim = csv_sniff_delim(line);
+        }
+        if (csv_parser_set_delim(&parser, opt.delim) != 0) {
+            err = CSVSTAT_EARG;
+            goto cleanup;
+        }
+
         // `csv_split` modifies the line buffer, so we must cast away `const`.
         // This is safe because the underlying buffer is owned by LineReader and mutable.
         if (csv_split(&parser, (char *)line, &header) != 0) {
@@ -281,143 +1115,466 @@ int main(int argc, char **argv) {
             goto cleanup;
         }
         
-        if (csv_find_column(&header, col_name, &col_index) != 0) {
+        // Resolve names through a hash index: O(1) per lookup on wide headers.
+        if (csv_header_index_init(&hindex, &header) != 0) {
+            err = CSVSTAT_ENOMEM;
+            goto cleanup;
+        }
+        hindex_init = 1;
+
+        if (hindex.ndups > 0 && !opt.quiet) {
+            fprintf(stderr, "csvstat: header: %zu duplicate column name(s), e.g. '%s'; "
+                            "the first occurrence is used\n",
+                    hindex.ndups, csv_header_index_name(&hindex, hindex.first_dup));
+        }
+
+        if (opt.col_name && csv_header_index_find(&hindex, opt.col_name, &col_index) != 0) {
             err = CSVSTAT_ENOCOL;
             goto cleanup;
         }
 
-        break;
-    }
+        if (opt.corr && csv_header_index_resolve(&hindex, opt.corr_names, opt.ncorr, corr_cols) != 0) {
+            for (size_t i = 0; i < opt.ncorr; i++) {
+                if (corr_cols[i] == CSV_NO_COLUMN) {
+                    fprintf(stderr, "csvstat: --corr: no column '%s'\n", opt.corr_names[i]);
+                    break;
+                }
+            }
+            err = CSVSTAT_ENOCOL;
+            goto cleanup;
+        }
 
-    // ---- Stream rows and accumulate stats ----
-    Stats st;
-    stats_init(&st);
+        // Look for a checkpoint to resume now: a resumed scan reopens its
+        // --reject-file where the checkpoint left it instead of starting a
+        // new one. (Checkpoints imply a sequential scan, see parse_cli.)
+        if (opt.checkpoint_path) {
+            ckpt.job = checkpoint_job(&opt, &header);
 
-    size_t rows_seen = 0;    // rows we attempted to process (non-empty)
-    size_t numeric_ok = 0;   // successfully parsed numbers
-    size_t numeric_bad = 0;  // missing/invalid numbers
-    size_t missing_col = 0;  // rows with fewer fields than header
+            unsigned long long origin = 0;  // first data byte
+            if (line_reader_tell(&lr, &origin) != 0) {
+                err = CSVSTAT_EIO;
+                saved_errno = errno;
+                goto cleanup;
+            }
+            int crc = checkpoint_load(opt.checkpoint_path, &cp);
+            resume = (crc == 0 && cp.job == ckpt.job && cp.offset >= origin &&
+                      checkpoint_matches(&cp, path, ckpt.compressed) == 1);
+            if (!resume && crc != 1 && !opt.quiet) {
+                fprintf(stderr, "csvstat: --checkpoint: %s does not match this scan; starting over\n",
+                        opt.checkpoint_path);
+            }
+        }
 
-    CsvRowView row = (CsvRowView){0};
-    size_t row_no = 0;
+        if (opt.reject_path) {
+            int rrc = 1;
+            if (resume) {
+                rrc = diag_rejects_resume(&rejects, opt.reject_path, cp.reject_offset,
+                                          opt.delim, !opt.no_quotes);
+                if (rrc == 1) {
+                    resume = 0;
+                    if (!opt.quiet) {
+                        fprintf(stderr, "csvstat: --checkpoint: %s is missing or shorter than "
+                                "checkpointed; starting over\n", opt.reject_path);
+                    }
+                }
+            }
+            if (rrc == 1) {
+                rrc = diag_rejects_open(&rejects, opt.reject_path, &header, opt.delim, !opt.no_quotes);
+            }
+            if (rrc != 0) {
+                err = CSVSTAT_EIO;
+                saved_errno = errno;
+                goto cleanup;
+            }
+            rejects_open = 1;
+            ckpt.rejects = opt.checkpoint_path ? &rejects : NULL;
+        }
 
-    for (;;) {
-        int rc = line_reader_next(&lr, &line, &len);
-        if (rc == 1) break; // EOF
-        if (rc != 0) {
-            err = CSVSTAT_EIO;
-            if (saved_errno == 0) saved_errno = errno;
+        break;
+    }
+
+    // ---- Compile --where once against the header ----
+    ExprProgram where;
+    if (opt.where) {
+        char msg[128];
+        if (expr_compile(&where, opt.where, &hindex, EXPR_SCALAR, msg, sizeof msg) != 0) {
+            fprintf(stderr, "csvstat: --where: %s\n", msg[0] ? msg : "invalid expression");
+            err = CSVSTAT_EARG;
             goto cleanup;
         }
+        where_init = 1;
+    }
 
-        if (is_empty_line(line)) {
-            continue; // skip empty/whitespace-only lines
+    // ---- Compile --expr for batch (vector) evaluation ----
+    ExprProgram expr;
+    if (opt.expr) {
+        char msg[128];
+        if (expr_compile(&expr, opt.expr, &hindex, EXPR_VECTOR, msg, sizeof msg) != 0) {
+            fprintf(stderr, "csvstat: --expr: %s\n", msg[0] ? msg : "invalid expression");
+            err = CSVSTAT_EARG;
+            goto cleanup;
         }
+        expr_init = 1;
+    }
 
-        if (csv_split(&parser, (char *)line, &row) != 0) {
-            err = CSVSTAT_EFORMAT;
+    // ---- Zone map: load a matching sidecar, or build one during this scan ----
+    // `header` points into the line buffer, so this must run before the next read.
+    ZoneMap zm;
+    ZoneSource zsrc = {0};
+    int zm_build = 0;   // accumulating a new map during this scan
+    int zm_prune = 0;   // skipping blocks using a loaded map
+
+    if (opt.zonemap_path) {
+        if (zonemap_source_stat(path, &zsrc) != 0) {
+            err = CSVSTAT_EIO;
+            saved_errno = errno;
             goto cleanup;
         }
 
-        rows_seen++;
-
-        if (col_index >= row.nfields) {
-            // Row has fewer fields than the header (v1 behavior: skip; optionally warn).
-            missing_col++;
-            if (!opt.quiet) {
-                fprintf(stderr, "Row %zu: missing column %s\n", row_no, col_name);
+        int zrc = zonemap_load(&zm, opt.zonemap_path, &zsrc, &header);
+        if (zrc == 0) {
+            zm_init = 1;
+            zm_prune = opt.has_range || (where_init && where.nbounds > 0);
+        } else {
+            if (zrc < 0 && !opt.quiet) {
+                fprintf(stderr, "csvstat: zonemap: ignoring unreadable map %s\n", opt.zonemap_path);
+            }
+            if (zonemap_init(&zm, &header, opt.zonemap_rows) != 0) {
+                err = CSVSTAT_ENOMEM;
+                goto cleanup;
             }
-            row_no++;
-            continue;
+            zm_init = 1;
+            zm_build = 1;
         }
+    }
 
-        const char *cell = row.fields[col_index];
-        double x = 0.0;
+    // ---- Per-row work shared by the sequential and parallel scans ----
+    ScanConfig cfg = {
+        .col_index = col_index,
+        .col_name = col_name,
+        .where = where_init ? &where : NULL,
+        .expr = expr_init ? &expr : NULL,
+        .has_range = opt.has_range,
+        .range_lo = opt.range_lo,
+        .range_hi = opt.range_hi,
+        .rejects = rejects_open ? &rejects : NULL,
+        .quotes = !opt.no_quotes,
+        .delim = opt.delim,
+        .split_all = zm_build,
+        .moments = opt.moments,
+        .precision = opt.precision,
+        .decimal = opt.decimal,
+        .scale = opt.decimal_scale,
+        .corr_cols = opt.corr ? corr_cols : NULL,
+        .ncorr = opt.ncorr,
+    };
 
-        if (parse_double_strict(cell, &x) != 0) {
-            numeric_bad++;
+    ScanState ss;
+    if (scan_state_init(&ss, &cfg) != 0) {
+        err = CSVSTAT_ENOMEM;
+        goto cleanup;
+    }
+    ss_init = 1;
+
+    size_t blocks_pruned = 0;    // zone-map blocks skipped without reading
+    size_t rows_pruned = 0;      // non-empty rows inside skipped blocks
+
+    // ---- Resume from the checkpoint found with the header, if any ----
+    ScanHooks hooks = {0};
+    unsigned long long scan_origin = 0;  // first data byte this run reads
+    if (line_reader_tell(&lr, &scan_origin) != 0) {
+        err = CSVSTAT_EIO;
+        saved_errno = errno;
+        goto cleanup;
+    }
+
+    if (opt.checkpoint_path) {
+        if (resume) {
+            if (line_reader_seek(&lr, cp.offset) != 0) {
+                err = CSVSTAT_EIO;
+                saved_errno = errno;
+                goto cleanup;
+            }
+            ss.st = cp.st;
+            ss.dec = cp.dec;
+            ss.sc = cp.sc;
+            ss.row_no = cp.row_no;
+            diag_restore(&ss.diag, &cp.diag);
+            scan_origin = cp.offset;
             if (!opt.quiet) {
-                fprintf(stderr, "Row %zu: invalid number '%s'\n", row_no, cell);
+                fprintf(stderr, "csvstat: --checkpoint: resuming after row %zu (byte %llu)\n",
+                        cp.row_no, cp.offset);
             }
-            row_no++;
-            continue;
         }
 
-        if (stats_push(&st, x) != 0) {
-            err = CSVSTAT_EINTERNAL;
+        hooks.ckpt = &ckpt;
+        hooks.ckpt_every = opt.checkpoint_every;
+        hooks.ckpt_row = ss.row_no;
+    }
+
+    // Byte-range workers need random access; compressed input is scanned
+    // sequentially (its decoder threads still run alongside the scan).
+    int parallel = opt.threads > 1 && source_is_seekable(&src);
+    if (opt.threads > 1 && !parallel && !opt.quiet) {
+        fprintf(stderr, "csvstat: --threads: %s input is scanned sequentially\n",
+                src.stream ? "stdin" : source_kind_name(src.kind));
+    }
+
+    if (opt.follow && (src.kind != SOURCE_PLAIN || !source_is_seekable(&src))) {
+        fprintf(stderr, "csvstat: --follow: needs an uncompressed regular file\n");
+        err = CSVSTAT_EARG;
+        goto cleanup;
+    }
+
+    // ---- Progress lines: the clock is only read on the tick hook ----
+    Progress progress;
+    if (opt.progress_interval > 0.0) {
+        if (progress_init(&progress, opt.progress_path, opt.progress_interval,
+                          parallel ? opt.threads : 1, ss.sc.rows_seen) != 0) {
+            err = CSVSTAT_EIO;
+            saved_errno = errno;
             goto cleanup;
         }
-        
-        numeric_ok++;
-        row_no++;
+        progress_on = 1;
+        hooks.progress = &progress;
     }
 
-    // ---- Print summary ----
-    printf("file: %s\n", path);
-    printf("column: %s\n", col_name);
-    printf("rows_seen: %zu\n", rows_seen);
-    printf("missing_column: %zu\n", missing_col);
-    printf("numeric_ok: %zu\n", numeric_ok);
-    printf("numeric_bad: %zu\n", numeric_bad);
+    hooks.alloc_warmup = opt.alloc_stats ? opt.alloc_warmup : 0;
 
-    double v = 0.0;
-    size_t n = stats_count(&st);
+    if (hooks.ckpt || hooks.progress || hooks.alloc_warmup) {
+        ss.tick = scan_hooks_tick;
+        ss.tick_ctx = &hooks;
+        ss.tick_every = SIZE_MAX;
+        if (hooks.progress) ss.tick_every = PROGRESS_SAMPLE_ROWS;
+        if (hooks.ckpt && hooks.ckpt_every < ss.tick_every) ss.tick_every = hooks.ckpt_every;
+        if (hooks.alloc_warmup && hooks.alloc_warmup < ss.tick_every) ss.tick_every = hooks.alloc_warmup;
+        ss.tick_row = ss.row_no;
+        ss.tick_origin = scan_origin;
+    }
 
-    if (!stats_has_data(&st)) {
-        printf("min: n/a\n");
-        printf("max: n/a\n");
-        printf("mean: n/a\n");
-        printf("stddev_sample: n/a\n");
+    unsigned long long scan_end = scan_origin;  // offset the scan stopped at
+
+    ProfileMark prof_start;
+    profile_init(&ss.prof, opt.profile);
+    profile_mark(&prof_start);
+
+    if (opt.follow) {
+        // ---- Follow: the sequential line loop, resumed on every append ----
+        err = follow_scan(&opt, col_name, &src, &lr, &ss, t_start, &saved_errno);
+        if (err != CSVSTAT_OK) goto cleanup;
+    } else if (parallel) {
+        // ---- Parallel: record-aligned byte ranges, one stream per worker ----
+        unsigned long long begin = 0;
+        struct stat sb;
+        if (line_reader_tell(&lr, &begin) != 0 || fstat(src.fd, &sb) != 0) {
+            err = CSVSTAT_EIO;
+            saved_errno = errno;
+            goto cleanup;
+        }
+        unsigned long long end = (unsigned long long)sb.st_size;
+        if (end < begin) end = begin;
+
+        err = scan_parallel(&cfg, path, begin, end, opt.threads, &ss, &saved_errno);
+        if (err != CSVSTAT_OK) goto cleanup;
+        scan_end = end;
     } else {
-        // n >= 1
-        // There should succeed when n > 0; if they fail, treat as internal error.
-        if (stats_min(&st, &v) != 0) { 
-            err = CSVSTAT_EINTERNAL;
+        // ---- Sequential: stream rows, pruning or building zone-map blocks ----
+        size_t blk = 0;              // next zone-map block to enter (prune mode)
+        size_t blk_rows_left = 0;    // rows left in the current block (prune mode)
+        unsigned long long row_off = 0;
+
+
+        if (scan_can_batch(&cfg) && !zm_prune) {
+            // Column stats alone take the batch path, starting with the
+            // bytes the reader buffered past the header.
+            err = scan_stream(&ss, &lr, ULLONG_MAX, &saved_errno);
+            if (err != CSVSTAT_OK) goto cleanup;
+        } else {
+            for (;;) {
+                if (zm_prune && blk_rows_left == 0 && blk < zm.nblocks) {
+                    // Entering a new block: skip every following block whose range
+                    // cannot intersect [lo, hi], then seek once past them.
+                    size_t first = blk;
+                    while (blk < zm.nblocks &&
+                           !block_may_match(&zm, blk, &opt, col_index, cfg.where)) {
+                        blocks_pruned++;
+                        rows_pruned += zm.blocks[blk].rows;
+                        blk++;
+                    }
+                    if (blk > first && line_reader_seek(&lr, zm.blocks[blk - 1].end) != 0) {
+                        err = CSVSTAT_EIO;
+                        saved_errno = errno;
+                        goto cleanup;
+                    }
+                    if (blk < zm.nblocks) {
+                        blk_rows_left = zm.blocks[blk].rows;
+                        blk++;
+                    }
+                }
+
+                // Offsets are only needed where a new zone-map block begins.
+                if (zm_build && zonemap_at_block_start(&zm) && line_reader_tell(&lr, &row_off) != 0) {
+                    err = CSVSTAT_EIO;
+                    saved_errno = errno;
+                    goto cleanup;
+                }
+
+                uint64_t t0 = 0;
+                const int timed = PROFILE_ON(&ss.prof) && profile_sample(&ss.prof, PROFILE_ROW_BURST);
+                PROFILE_START(timed, t0);
+                int rc = line_reader_next(&lr, &line, &len);
+                if (rc == 1) break; // EOF
+                if (rc != 0) {
+                    err = CSVSTAT_EIO;
+                    if (saved_errno == 0) saved_errno = errno;
+                    goto cleanup;
+                }
+                PROFILE_STOP(timed, &ss.prof, PROF_READ, t0, len + 1, 1);
+
+                if (scan_is_empty_line(line)) {
+                    continue; // skip empty/whitespace-only lines
+                }
+
+                if (blk_rows_left > 0) blk_rows_left--;
+
+                // `scan_row` splits the line in place; the LineReader buffer is mutable.
+                err = scan_row(&ss, (char *)line, zm_build ? &zm : NULL, row_off);
+                if (err != CSVSTAT_OK) goto cleanup;
+
+                if (ss.tick) {
+                    unsigned long long next_off = 0;
+                    if (line_reader_tell(&lr, &next_off) != 0) {
+                        err = CSVSTAT_EIO;
+                        saved_errno = errno;
+                        goto cleanup;
+                    }
+                    err = scan_tick(&ss, next_off);
+                    if (err != CSVSTAT_OK) {
+                        if (err == CSVSTAT_EIO) saved_errno = errno;
+                        goto cleanup;
+                    }
+                }
+            }
+        }
+
+        err = scan_finish(&ss);
+        if (err != CSVSTAT_OK) goto cleanup;
+
+        if (line_reader_tell(&lr, &scan_end) != 0) {
+            err = CSVSTAT_EIO;
+            saved_errno = errno;
             goto cleanup;
         }
-        printf("min: %.17g\n", v);
 
-        if (stats_max(&st, &v) != 0) {
-            err = CSVSTAT_EINTERNAL;
+        // A final checkpoint at EOF: a rerun resumes here and only reads
+        // rows appended since.
+        if (hooks.ckpt && checkpoint_write(hooks.ckpt, &ss, scan_end) != 0) {
+            err = CSVSTAT_EIO;
+            saved_errno = errno;
             goto cleanup;
         }
-        printf("max: %.17g\n", v);
-        
-        if (stats_mean(&st, &v) != 0) {
-            err = CSVSTAT_EINTERNAL;
+    }
+
+    // Allocations from here on (zone-map save, reporting) are not per row.
+    csvstat_alloc_steady(0);
+
+    if (progress_on && progress_finish(&progress, &ss, scan_end - scan_origin) != 0) {
+        err = CSVSTAT_EIO;
+        saved_errno = errno;
+        goto cleanup;
+    }
+
+    if (zm_build) {
+        unsigned long long end_off = 0;
+        if (line_reader_tell(&lr, &end_off) != 0) {
+            err = CSVSTAT_EIO;
+            saved_errno = errno;
             goto cleanup;
         }
-        printf("mean: %.17g\n", v);
-        
-        if (!stats_has_sample_variance(&st)) {
-            // Sample standard deviation is undefined for n < 2.
-            (void)n; // n kept for readibility / potential future printing
-            printf("stddev_sample: n/a\n");
-        } else {
-            if (stats_stddev_sample(&st, &v) != 0) {
-                err = CSVSTAT_EINTERNAL;
-                goto cleanup;
-            }
-            printf("stddev_sample: %.17g\n", v);
+        zonemap_finish(&zm, end_off);
+
+        if (zonemap_save(&zm, opt.zonemap_path, &zsrc) != 0) {
+            err = CSVSTAT_EIO;
+            saved_errno = errno;
+            goto cleanup;
         }
     }
 
+    const double t_scan = wall_seconds() - t_start;
+
+    // ---- Print summary ----
+    err = print_summary(&opt, col_name, &src, &ss, zm_init ? &zm : NULL,
+                        blocks_pruned, rows_pruned, t_scan);
+    if (err != CSVSTAT_OK) goto cleanup;
+
+    if (!opt.quiet) {
+        fflush(stdout);
+        diag_report(stderr, &ss.diag, opt.expr ? NULL : col_name);
+    }
+    if (opt.profile) {
+        fflush(stdout);
+        profile_report(stderr, &ss.prof, &prof_start, parallel ? opt.threads : 1, ss.sc.rows_seen);
+    }
+    rows_scanned = ss.sc.rows_seen;
+
     err = CSVSTAT_OK;
 
 cleanup:
+    if (progress_on) {
+        progress_destroy(&progress);
+    }
+    if (ss_init) {
+        scan_state_destroy(&ss);
+    }
+    if (expr_init) {
+        expr_destroy(&expr);
+    }
+    if (where_init) {
+        expr_destroy(&where);
+    }
+    if (zm_init) {
+        zonemap_destroy(&zm);
+    }
+    if (hindex_init) {
+        csv_header_index_destroy(&hindex);
+    }
     if (parser_init) {
         csv_parser_destroy(&parser);
     }
     if (lr_init) {
         line_reader_destroy(&lr);
     }
-    if (fp_open) {
-        fclose(fp);
+    if (src_open) {
+        source_close(&src);
+    }
+
+    if (rejects_open && diag_rejects_close(&rejects) != 0 && err == CSVSTAT_OK) {
+        err = CSVSTAT_EIO;
+        saved_errno = errno;
     }
 
+    // Every worker and decoder thread has been joined by now.
+    if (TRACE_ON() && trace_close() != 0 && err == CSVSTAT_OK) {
+        err = CSVSTAT_EIO;
+        saved_errno = errno;
+    }
+
+    progress_on = 0;
+    rejects_open = 0;
+    ss_init = 0;
+    expr_init = 0;
+    where_init = 0;
+    zm_init = 0;
+    hindex_init = 0;
     parser_init = 0;
     lr_init = 0;
-    fp_open = 0;
+    src_open = 0;
+
+    // After cleanup, so frees are complete and live bytes show leaks.
+    if (opt.alloc_stats && err == CSVSTAT_OK) {
+        fflush(stdout);
+        csvstat_alloc_report(stderr, opt.alloc_warmup, rows_scanned);
+    }
 
     // Use context strings that help us locate where the failure happened.
     if (err != CSVSTAT_OK) {
@@ -425,6 +1582,7 @@ cleanup:
             case CSVSTAT_EARG:      return die(err, "cli");
             case CSVSTAT_EIO:       return die_errno(err, "io", saved_errno);
             case CSVSTAT_EFORMAT:   return die(err, "format");
+            case CSVSTAT_EOVERFLOW: return die(err, "--decimal");
             case CSVSTAT_ENOCOL:    return die(err, "header");
             case CSVSTAT_ENOMEM:    return die(err, "memory");
             default:                return die(err, "internal");
@@ -0,0 +1,736 @@
+#define _POSIX_C_SOURCE 200809L  // clock_gettime, posix_spawn
+
+/*
+csvstat-bench: throughput of the hot modules and of the whole program.
+
+The input is loaded once. Each benchmark then runs --repeat times over the
+same data and keeps the fastest run:
+
+- line_reader_next     lines from a Source on the file (page-cache reads)
+- csv_split            in-place split of every record (copied to a scratch
+                       line first, as LineReader hands it over)
+- csv_split_batch      column-major batch split of the data block
+- parse_double_strict  every cell of --col as a NUL-terminated string
+- parse_double_n       the same cells as (pointer, length)
+- stats_push           every valid value of --col
+- end_to_end           `APP FILE COL --quiet --alloc-stats` as a child
+                       process (--app); run first, before the input is loaded
+
+Results are one JSON object on stdout or in --out: bytes and items (rows,
+cells or values) per run, best seconds, GB/s and ns per item; end_to_end
+adds the child's peak RSS and heap allocations per row (from its
+--alloc-stats report).
+*/
+
+#include "line_reader.h"
+#include "source.h"
+#include "csv.h"
+#include "numparse.h"
+#include "stats.h"
+#include "scan.h"
+#include "corr.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+extern char **environ;
+
+typedef struct {
+    const char *input;
+    const char *col;
+    const char *app;       // csvstat binary for end_to_end, or NULL to skip it
+    const char *out_path;  // NULL: stdout
+    const char *only;      // comma-separated benchmark names, or NULL for all
+    size_t repeat;
+} BenchOptions;
+
+/*
+The loaded input: raw bytes, record boundaries and the --col cells.
+*/
+typedef struct {
+    char *data;
+    size_t len;
+    size_t body;            // offset of the first data record
+    size_t col;             // index of --col
+
+    size_t *line_off;       // owned: start of each data record
+    size_t *line_len;       // owned: record length without its newline
+    size_t nlines;
+    size_t max_line;
+
+    char *cells;            // owned: --col cells, NUL-separated
+    size_t *cell_off;       // owned: ncells + 1 offsets into cells
+    size_t ncells;
+
+    double *values;         // owned: the cells that parse
+    size_t nvalues;
+} Corpus;
+
+typedef struct {
+    const char *name;
+    double seconds;               // fastest run
+    unsigned long long bytes;     // per run
+    unsigned long long items;     // per run
+    long peak_rss_kib;            // end_to_end only, else -1
+    double allocs_per_row;        // end_to_end only, else -1
+} BenchResult;
+
+// Results are folded into this so the optimizer cannot drop the work.
+static volatile double bench_sink;
+
+static void usage(FILE *out, const char *prog) {
+    fprintf(out,
+        "csvstat-bench – module and end-to-end throughput, as JSON\n\n"
+        "Usage:\n"
+        "  %s --input <csv-file> [options]\n\n"
+        "Options:\n"
+        "  --input <path>   CSV file to measure (e.g. from csvgen)\n"
+        "  --col <name>     Numeric column for the parse/stats benchmarks (default num0)\n"
+        "  --app <path>     csvstat binary for the end_to_end benchmark (skipped if absent)\n"
+        "  --repeat <n>     Runs per benchmark; the fastest is reported (default 5)\n"
+        "  --only <names>   Comma-separated benchmarks to run (default all)\n"
+        "  --out <path>     Write the JSON here instead of stdout\n"
+        "  --help           Show this help\n",
+        prog);
+}
+
+static int parse_cli(int argc, char **argv, BenchOptions *opt) {
+    opt->input = NULL;
+    opt->col = "num0";
+    opt->app = NULL;
+    opt->out_path = NULL;
+    opt->only = NULL;
+    opt->repeat = 5;
+
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        if (strcmp(a, "--help") == 0) {
+            usage(stdout, argv[0]);
+            return 1;
+        }
+        if (i + 1 >= argc) {
+            fprintf(stderr, "csvstat-bench: missing value for %s\n", a);
+            return -1;
+        }
+        const char *v = argv[++i];
+        if (strcmp(a, "--input") == 0) {
+            opt->input = v;
+        } else if (strcmp(a, "--col") == 0) {
+            opt->col = v;
+        } else if (strcmp(a, "--app") == 0) {
+            opt->app = v;
+        } else if (strcmp(a, "--out") == 0) {
+            opt->out_path = v;
+        } else if (strcmp(a, "--only") == 0) {
+            opt->only = v;
+        } else if (strcmp(a, "--repeat") == 0) {
+            char *end = NULL;
+            errno = 0;
+            unsigned long n = strtoul(v, &end, 10);
+            if (v[0] < '0' || v[0] > '9' || errno || *end || n == 0 || n > 1000) {
+                fprintf(stderr, "csvstat-bench: invalid value for --repeat: %s\n", v);
+                return -1;
+            }
+            opt->repeat = (size_t)n;
+        } else {
+            fprintf(stderr, "csvstat-bench: unknown option: %s\n", a);
+            return -1;
+        }
+    }
+    if (!opt->input) {
+        fprintf(stderr, "csvstat-bench: --input is required\n");
+        return -1;
+    }
+    return 0;
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/*
+Return 1 if `name` is selected by --only.
+*/
+static int selected(const BenchOptions *opt, const char *name) {
+    if (!opt->only) return 1;
+    size_t n = strlen(name);
+    for (const char *p = opt->only; *p; ) {
+        const char *e = strchr(p, ',');
+        size_t k = e ? (size_t)(e - p) : strlen(p);
+        if (k == n && strncmp(p, name, n) == 0) return 1;
+        if (!e) break;
+        p = e + 1;
+    }
+    return 0;
+}
+
+static void corpus_destroy(Corpus *c) {
+    free(c->data);
+    free(c->line_off);
+    free(c->line_len);
+    free(c->cells);
+    free(c->cell_off);
+    free(c->values);
+    memset(c, 0, sizeof *c);
+}
+
+static int grow(void **p, size_t *cap, size_t need, size_t elem) {
+    if (need <= *cap) return 0;
+    size_t n = *cap ? *cap : 1024;
+    while (n < need) n *= 2;
+    void *q = realloc(*p, n * elem);
+    if (!q) return -1;
+    *p = q;
+    *cap = n;
+    return 0;
+}
+
+/*
+Read the file, find record boundaries with a LineReader (so quoted newlines
+and CRLF are handled as csvstat handles them) and collect the --col cells.
+*/
+static int corpus_load(Corpus *c, const char *path, const char *col) {
+    memset(c, 0, sizeof *c);
+
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        fprintf(stderr, "csvstat-bench: %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    size_t cap = 0;
+    for (;;) {
+        if (grow((void **)&c->data, &cap, c->len + (1u << 20) + 1, 1) != 0) {
+            fclose(fp);
+            fprintf(stderr, "csvstat-bench: out of memory\n");
+            return -1;
+        }
+        size_t got = fread(c->data + c->len, 1, cap - c->len - 1, fp);
+        c->len += got;
+        if (got == 0) break;
+    }
+    int rerr = ferror(fp);
+    fclose(fp);
+    if (rerr) {
+        fprintf(stderr, "csvstat-bench: %s: read error\n", path);
+        return -1;
+    }
+    c->data[c->len] = '\0';
+
+    Source src;
+    LineReader lr;
+    CsvParser parser;
+    if (source_open(&src, path, 1) != 0) {
+        fprintf(stderr, "csvstat-bench: %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    if (line_reader_init_source(&lr, &src) != 0) {
+        source_close(&src);
+        return -1;
+    }
+    if (csv_parser_init(&parser, 0) != 0) {
+        line_reader_destroy(&lr);
+        source_close(&src);
+        return -1;
+    }
+    line_reader_set_quotes(&lr, 1);
+
+    int rc = -1;
+    int have_header = 0;
+    size_t lcap = 0, lcap2 = 0, ccap = 0, ocap = 0, vcap = 0, cells_len = 0;
+    char *scratch = NULL;
+    size_t scap = 0;
+
+    for (;;) {
+        unsigned long long off = 0;
+        const char *line = NULL;
+        size_t len = 0;
+        line_reader_tell(&lr, &off);
+        int nrc = line_reader_next(&lr, &line, &len);
+        if (nrc == 1) break;
+        if (nrc != 0) goto out;
+        if (scan_is_empty_line(line)) continue;
+
+        if (grow((void **)&scratch, &scap, len + 1, 1) != 0) goto out;
+        memcpy(scratch, line, len + 1);
+        CsvRowView row;
+        if (csv_split(&parser, scratch, &row) != 0) goto out;
+
+        if (!have_header) {
+            if (csv_find_column(&row, col, &c->col) != 0) {
+                fprintf(stderr, "csvstat-bench: column not found: %s\n", col);
+                goto out;
+            }
+            have_header = 1;
+            line_reader_tell(&lr, &off);
+            c->body = (size_t)off;
+            continue;
+        }
+
+        if (grow((void **)&c->line_off, &lcap, c->nlines + 1, sizeof *c->line_off) != 0 ||
+            grow((void **)&c->line_len, &lcap2, c->nlines + 1, sizeof *c->line_len) != 0) {
+            goto out;
+        }
+        c->line_off[c->nlines] = (size_t)off;
+        c->line_len[c->nlines] = len;
+        c->nlines++;
+        if (len > c->max_line) c->max_line = len;
+
+        if (c->col < row.nfields) {
+            const char *cell = row.fields[c->col];
+            size_t clen = strlen(cell);
+            if (grow((void **)&c->cells, &ccap, cells_len + clen + 1, 1) != 0 ||
+                grow((void **)&c->cell_off, &ocap, c->ncells + 2, sizeof *c->cell_off) != 0) {
+                goto out;
+            }
+            c->cell_off[c->ncells] = cells_len;
+            memcpy(c->cells + cells_len, cell, clen + 1);
+            cells_len += clen + 1;
+            c->ncells++;
+            c->cell_off[c->ncells] = cells_len;
+
+            double x = 0.0;
+            if (parse_double_strict(cell, &x) == 0) {
+                if (grow((void **)&c->values, &vcap, c->nvalues + 1, sizeof *c->values) != 0) goto out;
+                c->values[c->nvalues++] = x;
+            }
+        }
+    }
+    if (!have_header) {
+        fprintf(stderr, "csvstat-bench: %s: no header row\n", path);
+        goto out;
+    }
+    rc = 0;
+
+out:
+    if (rc != 0 && have_header) fprintf(stderr, "csvstat-bench: failed to load %s\n", path);
+    free(scratch);
+    csv_parser_destroy(&parser);
+    line_reader_destroy(&lr);
+    source_close(&src);
+    return rc;
+}
+
+// ---- Benchmarks: one run each; the caller repeats and times them ----
+
+static int run_line_reader(const Corpus *c, const BenchOptions *opt, BenchResult *r) {
+    Source src;
+    LineReader lr;
+    if (source_open(&src, opt->input, 1) != 0) return -1;
+    if (line_reader_init_source(&lr, &src) != 0) {
+        source_close(&src);
+        return -1;
+    }
+    line_reader_set_quotes(&lr, 1);
+
+    unsigned long long lines = 0, sum = 0;
+    const char *line = NULL;
+    size_t len = 0;
+    int nrc = 0;
+    while ((nrc = line_reader_next(&lr, &line, &len)) == 0) {
+        lines++;
+        sum += len;
+    }
+    line_reader_destroy(&lr);
+    source_close(&src);
+    if (nrc != 1) return -1;
+
+    bench_sink += (double)sum;
+    r->bytes = c->len;
+    r->items = lines;
+    return 0;
+}
+
+static int run_csv_split(const Corpus *c, const BenchOptions *opt, BenchResult *r) {
+    (void)opt;
+    CsvParser parser;
+    if (csv_parser_init(&parser, 0) != 0) return -1;
+    char *line = malloc(c->max_line + 1);
+    if (!line) {
+        csv_parser_destroy(&parser);
+        return -1;
+    }
+
+    unsigned long long fields = 0, bytes = 0;
+    int rc = 0;
+    for (size_t i = 0; i < c->nlines; i++) {
+        size_t len = c->line_len[i];
+        memcpy(line, c->data + c->line_off[i], len);
+        line[len] = '\0';
+        CsvRowView row;
+        if (csv_split(&parser, line, &row) != 0) {
+            rc = -1;
+            break;
+        }
+        fields += row.nfields;
+        bytes += len + 1;
+    }
+    free(line);
+    csv_parser_destroy(&parser);
+
+    bench_sink += (double)fields;
+    r->bytes = bytes;
+    r->items = c->nlines;
+    return rc;
+}
+
+static int run_csv_split_batch(const Corpus *c, const BenchOptions *opt, BenchResult *r) {
+    (void)opt;
+    CsvParser parser;
+    CsvBatch batch;
+    if (csv_parser_init(&parser, 0) != 0) return -1;
+    if (csv_batch_init(&batch, &c->col, 1, SCAN_BATCH_ROWS) != 0) {
+        csv_parser_destroy(&parser);
+        return -1;
+    }
+
+    const char *p = c->data + c->body;
+    size_t left = c->len - c->body;
+    unsigned long long rows = 0, sum = 0;
+    int rc = 0;
+    while (left > 0) {
+        size_t used = 0;
+        if (csv_split_batch(&parser, &batch, p, left, 1, &used) != 0 || used == 0) {
+            rc = -1;
+            break;
+        }
+        for (size_t k = 0; k < batch.nrows; k++) sum += batch.spans[k].len;
+        rows += batch.nrows;
+        p += used;
+        left -= used;
+    }
+    csv_batch_destroy(&batch);
+    csv_parser_destroy(&parser);
+
+    bench_sink += (double)sum;
+    r->bytes = c->len - c->body;
+    r->items = rows;
+    return rc;
+}
+
+static int run_parse_strict(const Corpus *c, const BenchOptions *opt, BenchResult *r) {
+    (void)opt;
+    double acc = 0.0;
+    for (size_t i = 0; i < c->ncells; i++) {
+        double x = 0.0;
+        if (parse_double_strict(c->cells + c->cell_off[i], &x) == 0) acc += x;
+    }
+    bench_sink += acc;
+    r->bytes = c->ncells ? c->cell_off[c->ncells] : 0;
+    r->items = c->ncells;
+    return 0;
+}
+
+static int run_parse_n(const Corpus *c, const BenchOptions *opt, BenchResult *r) {
+    (void)opt;
+    double acc = 0.0;
+    for (size_t i = 0; i < c->ncells; i++) {
+        double x = 0.0;
+        size_t len = c->cell_off[i + 1] - c->cell_off[i] - 1;
+        if (parse_double_n(c->cells + c->cell_off[i], len, &x) == 0) acc += x;
+    }
+    bench_sink += acc;
+    r->bytes = c->ncells ? c->cell_off[c->ncells] : 0;
+    r->items = c->ncells;
+    return 0;
+}
+
+static int run_stats_push(const Corpus *c, const BenchOptions *opt, BenchResult *r) {
+    (void)opt;
+    Stats st;
+    stats_init(&st);
+    for (size_t i = 0; i < c->nvalues; i++) {
+        if (stats_push(&st, c->values[i]) != 0) return -1;
+    }
+    bench_sink += st.mean;
+    r->bytes = (unsigned long long)c->nvalues * sizeof(double);
+    r->items = c->nvalues;
+    return 0;
+}
+
+static int run_stats_push_moments(const Corpus *c, const BenchOptions *opt, BenchResult *r) {
+    (void)opt;
+    Stats st;
+    stats_init_moments(&st);
+    for (size_t i = 0; i < c->nvalues; i++) {
+        if (stats_push(&st, c->values[i]) != 0) return -1;
+    }
+    bench_sink += st.mean + st.m4;
+    r->bytes = (unsigned long long)c->nvalues * sizeof(double);
+    r->items = c->nvalues;
+    return 0;
+}
+
+/*
+stats_push_batch() in a precision mode, fed SCAN_BATCH_ROWS values at a time
+as the batch scan does.
+*/
+static int stats_batches(const Corpus *c, StatsPrecision p, BenchResult *r) {
+    Stats st;
+    stats_init(&st);
+    if (stats_set_precision(&st, p) != 0) return -1;
+    for (size_t i = 0; i < c->nvalues; i += SCAN_BATCH_ROWS) {
+        size_t n = c->nvalues - i < SCAN_BATCH_ROWS ? c->nvalues - i : SCAN_BATCH_ROWS;
+        if (stats_push_batch(&st, c->values + i, n) != 0) return -1;
+    }
+    bench_sink += st.mean;
+    r->bytes = (unsigned long long)c->nvalues * sizeof(double);
+    r->items = c->nvalues;
+    return 0;
+}
+
+static int run_stats_neumaier(const Corpus *c, const BenchOptions *opt, BenchResult *r) {
+    (void)opt;
+    return stats_batches(c, STATS_NEUMAIER, r);
+}
+
+static int run_stats_pairwise(const Corpus *c, const BenchOptions *opt, BenchResult *r) {
+    (void)opt;
+    return stats_batches(c, STATS_PAIRWISE, r);
+}
+
+#define BENCH_CORR_COLS 8   // corr_matrix: columns per row
+
+/*
+comoment_push() over consecutive pairs of corpus values.
+*/
+static int run_comoment_push(const Corpus *c, const BenchOptions *opt, BenchResult *r) {
+    (void)opt;
+    CoMoment co;
+    comoment_init(&co);
+    for (size_t i = 0; i + 1 < c->nvalues; i += 2) {
+        if (comoment_push(&co, c->values[i], c->values[i + 1]) != 0) return -1;
+    }
+    bench_sink += co.c_xy;
+    r->bytes = (unsigned long long)c->nvalues * sizeof(double);
+    r->items = c->nvalues / 2;
+    return 0;
+}
+
+/*
+corr_matrix_push() over rows of BENCH_CORR_COLS consecutive corpus values.
+*/
+static int run_corr_matrix(const Corpus *c, const BenchOptions *opt, BenchResult *r) {
+    (void)opt;
+    CorrMatrix m;
+    if (corr_matrix_init(&m, BENCH_CORR_COLS) != 0) return -1;
+    size_t rows = c->nvalues / BENCH_CORR_COLS;
+    for (size_t i = 0; i < rows; i++) corr_matrix_push(&m, c->values + i * BENCH_CORR_COLS);
+    corr_matrix_flush(&m);
+    bench_sink += m.cm[1];
+    corr_matrix_destroy(&m);
+    r->bytes = (unsigned long long)rows * BENCH_CORR_COLS * sizeof(double);
+    r->items = rows;
+    return 0;
+}
+
+/*
+Read "allocs_per_row: X" from a --alloc-stats report. Returns -1 if absent.
+*/
+static double read_allocs_per_row(FILE *report) {
+    char line[256];
+    double v = -1.0;
+    rewind(report);
+    while (fgets(line, sizeof line, report)) {
+        if (sscanf(line, "allocs_per_row: %lf", &v) == 1) break;
+    }
+    return v;
+}
+
+static int run_end_to_end(const Corpus *c, const BenchOptions *opt, BenchResult *r) {
+    FILE *report = tmpfile();  // the child's stderr
+    if (!report) return -1;
+
+    posix_spawn_file_actions_t fa;
+    if (posix_spawn_file_actions_init(&fa) != 0) {
+        fclose(report);
+        return -1;
+    }
+    posix_spawn_file_actions_addopen(&fa, 1, "/dev/null", O_WRONLY, 0);
+    posix_spawn_file_actions_adddup2(&fa, fileno(report), 2);
+
+    char *argv[] = { (char *)opt->app, (char *)opt->input, (char *)opt->col, "--quiet",
+                     "--alloc-stats", NULL };
+    pid_t pid;
+    int err = posix_spawn(&pid, opt->app, &fa, NULL, argv, environ);
+    posix_spawn_file_actions_destroy(&fa);
+    if (err != 0) {
+        fprintf(stderr, "csvstat-bench: %s: %s\n", opt->app, strerror(err));
+        fclose(report);
+        return -1;
+    }
+
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) {
+            fclose(report);
+            return -1;
+        }
+    }
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "csvstat-bench: %s failed on %s\n", opt->app, opt->input);
+        fclose(report);
+        return -1;
+    }
+    r->allocs_per_row = read_allocs_per_row(report);
+    fclose(report);
+
+    // Children run one at a time, so the children's maximum is this run's.
+    struct rusage ru;
+    if (getrusage(RUSAGE_CHILDREN, &ru) == 0) r->peak_rss_kib = ru.ru_maxrss;
+    r->bytes = c->len;
+    return 0;
+}
+
+typedef int (*BenchFn)(const Corpus *c, const BenchOptions *opt, BenchResult *r);
+
+static int bench_run(const char *name, BenchFn fn, const Corpus *c, const BenchOptions *opt,
+                     BenchResult *r) {
+    r->name = name;
+    r->seconds = 0.0;
+    r->bytes = 0;
+    r->items = 0;
+    r->peak_rss_kib = -1;
+    r->allocs_per_row = -1.0;
+
+    for (size_t i = 0; i < opt->repeat; i++) {
+        double t0 = now_seconds();
+        if (fn(c, opt, r) != 0) {
+            fprintf(stderr, "csvstat-bench: %s failed\n", name);
+            return -1;
+        }
+        double dt = now_seconds() - t0;
+        if (i == 0 || dt < r->seconds) r->seconds = dt;
+    }
+    return 0;
+}
+
+static void put_json_str(FILE *out, const char *s) {
+    fputc('"', out);
+    for (const unsigned char *p = (const unsigned char *)s; *p; p++) {
+        if (*p == '"' || *p == '\\') {
+            fprintf(out, "\\%c", *p);
+        } else if (*p < 0x20) {
+            fprintf(out, "\\u%04x", *p);
+        } else {
+            fputc(*p, out);
+        }
+    }
+    fputc('"', out);
+}
+
+static void write_json(FILE *out, const BenchOptions *opt, const Corpus *c,
+                       const BenchResult *res, size_t nres) {
+    fprintf(out, "{\n  \"suite\": \"csvstat-bench\",\n  \"input\": ");
+    put_json_str(out, opt->input);
+    fprintf(out, ",\n  \"input_bytes\": %zu,\n  \"rows\": %zu,\n  \"column\": ", c->len, c->nlines);
+    put_json_str(out, opt->col);
+    fprintf(out, ",\n  \"repeat\": %zu,\n  \"results\": [", opt->repeat);
+
+    for (size_t i = 0; i < nres; i++) {
+        const BenchResult *r = &res[i];
+        double s = r->seconds > 0.0 ? r->seconds : 1e-9;
+        fprintf(out, "%s\n    {\"name\": \"%s\", \"seconds\": %.9f, \"bytes\": %llu, \"items\": %llu, "
+                     "\"gb_per_s\": %.4f, \"ns_per_item\": %.3f",
+                i ? "," : "", r->name, r->seconds, r->bytes, r->items,
+                (double)r->bytes / s / 1e9,
+                r->items ? r->seconds * 1e9 / (double)r->items : 0.0);
+        if (r->peak_rss_kib >= 0) fprintf(out, ", \"peak_rss_kib\": %ld", r->peak_rss_kib);
+        if (r->allocs_per_row >= 0) fprintf(out, ", \"allocs_per_row\": %.9f", r->allocs_per_row);
+        fputc('}', out);
+    }
+    fprintf(out, "\n  ]\n}\n");
+}
+
+int main(int argc, char **argv) {
+    BenchOptions opt;
+    int rc = parse_cli(argc, argv, &opt);
+    if (rc != 0) {
+        if (rc < 0) usage(stderr, argv[0]);
+        return rc < 0 ? 2 : 0;
+    }
+
+    static const struct {
+        const char *name;
+        BenchFn fn;
+    } benches[] = {
+        { "line_reader_next",    run_line_reader },
+        { "csv_split",           run_csv_split },
+        { "csv_split_batch",     run_csv_split_batch },
+        { "parse_double_strict", run_parse_strict },
+        { "parse_double_n",      run_parse_n },
+        { "stats_push",          run_stats_push },
+        { "stats_push_moments",  run_stats_push_moments },
+        { "stats_batch_neumaier", run_stats_neumaier },
+        { "stats_batch_pairwise", run_stats_pairwise },
+        { "comoment_push",       run_comoment_push },
+        { "corr_matrix",         run_corr_matrix },
+    };
+    enum { NBENCH = sizeof benches / sizeof benches[0] };
+
+    // end_to_end runs first, while this process is small: a spawned child's
+    // peak RSS starts from the resident set of its parent.
+    BenchResult e2e;
+    int have_e2e = 0;
+    if (opt.app && selected(&opt, "end_to_end")) {
+        Corpus pre;
+        struct stat sb;
+        memset(&pre, 0, sizeof pre);
+        if (stat(opt.input, &sb) != 0) {
+            fprintf(stderr, "csvstat-bench: %s: %s\n", opt.input, strerror(errno));
+            return 1;
+        }
+        pre.len = (size_t)sb.st_size;
+        if (bench_run("end_to_end", run_end_to_end, &pre, &opt, &e2e) != 0) return 1;
+        have_e2e = 1;
+    }
+
+    Corpus c;
+    if (corpus_load(&c, opt.input, opt.col) != 0) {
+        corpus_destroy(&c);
+        return 1;
+    }
+
+    BenchResult res[NBENCH + 1];
+    size_t nres = 0;
+    int failed = 0;
+    for (size_t i = 0; i < NBENCH && !failed; i++) {
+        if (!selected(&opt, benches[i].name)) continue;
+        if (bench_run(benches[i].name, benches[i].fn, &c, &opt, &res[nres]) != 0) {
+            failed = 1;
+            break;
+        }
+        nres++;
+    }
+    if (have_e2e) {
+        e2e.items = c.nlines;
+        res[nres++] = e2e;
+    }
+
+    if (!failed) {
+        FILE *out = stdout;
+        if (opt.out_path) {
+            out = fopen(opt.out_path, "w");
+            if (!out) {
+                fprintf(stderr, "csvstat-bench: %s: %s\n", opt.out_path, strerror(errno));
+                failed = 1;
+            }
+        }
+        if (out) {
+            write_json(out, &opt, &c, res, nres);
+            if ((out == stdout ? fflush(out) : fclose(out)) != 0) failed = 1;
+        }
+    }
+
+    corpus_destroy(&c);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,585 @@
+/*
+bench-compare: check csvstat-bench results against a stored baseline.
+
+Several result files (one per suite run) are combined per metric into a
+median and a distribution-free ~95% confidence interval for the median
+(order statistics of the sorted runs; with fewer than 6 runs the interval
+is the full range). A metric regresses when even the favourable end of its
+interval is worse than the baseline by more than the metric's threshold:
+
+    higher is better (gb_per_s):           ci_hi < baseline * (1 - threshold)
+    lower is better (peak_rss_kib, ...):   ci_lo > baseline * (1 + threshold)
+
+so one noisy run does not fail the gate, but a consistent slowdown does.
+
+Baseline format
+---------------
+    {
+      "input_bytes": 63862207,
+      "metrics": [
+        {"bench": "csv_split_batch", "metric": "gb_per_s", "value": 1.36,
+         "better": "higher", "threshold": 0.2},
+        ...
+      ]
+    }
+
+`--write-baseline` creates one from the medians of the given runs, tracking
+gb_per_s of every benchmark plus peak_rss_kib and allocs_per_row where
+reported. Edit the file to drop metrics or tune thresholds.
+
+Exit status: 0 all metrics within threshold, 1 regression or missing
+metric, 2 usage or input error.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+
+// ---- Minimal JSON reader (objects, arrays, strings, numbers, literals) ----
+
+typedef enum { JSON_NULL, JSON_BOOL, JSON_NUM, JSON_STR, JSON_ARR, JSON_OBJ } JsonType;
+
+typedef struct Json {
+    JsonType type;
+    double num;            // JSON_NUM, JSON_BOOL (0/1)
+    char *str;             // owned: JSON_STR
+    struct Json *items;    // owned: JSON_ARR elements / JSON_OBJ values
+    char **keys;           // owned: JSON_OBJ keys
+    size_t n;
+} Json;
+
+typedef struct {
+    const char *p;
+    const char *end;
+    int depth;
+} JsonCursor;
+
+#define JSON_MAX_DEPTH 64
+
+static void json_free(Json *j) {
+    if (!j) return;
+    free(j->str);
+    for (size_t i = 0; i < j->n; i++) {
+        json_free(&j->items[i]);
+        if (j->keys) free(j->keys[i]);
+    }
+    free(j->items);
+    free(j->keys);
+    memset(j, 0, sizeof *j);
+}
+
+static void json_ws(JsonCursor *c) {
+    while (c->p < c->end && (*c->p == ' ' || *c->p == '\t' || *c->p == '\n' || *c->p == '\r')) c->p++;
+}
+
+static int json_value(JsonCursor *c, Json *out);
+
+static int json_string(JsonCursor *c, char **out) {
+    if (c->p >= c->end || *c->p != '"') return -1;
+    c->p++;
+    size_t cap = 16, len = 0;
+    char *s = malloc(cap);
+    if (!s) return -1;
+
+    while (c->p < c->end && *c->p != '"') {
+        char ch = *c->p++;
+        if (ch == '\\') {
+            if (c->p >= c->end) break;
+            char e = *c->p++;
+            switch (e) {
+            case 'n': ch = '\n'; break;
+            case 't': ch = '\t'; break;
+            case 'r': ch = '\r'; break;
+            case 'b': ch = '\b'; break;
+            case 'f': ch = '\f'; break;
+            case 'u':
+                // Only names and paths are read; non-ASCII becomes '?'.
+                if (c->end - c->p < 4) goto fail;
+                {
+                    unsigned v = 0;
+                    for (int k = 0; k < 4; k++) {
+                        char h = c->p[k];
+                        v <<= 4;
+                        if (h >= '0' && h <= '9') v |= (unsigned)(h - '0');
+                        else if (h >= 'a' && h <= 'f') v |= (unsigned)(h - 'a' + 10);
+                        else if (h >= 'A' && h <= 'F') v |= (unsigned)(h - 'A' + 10);
+                        else goto fail;
+                    }
+                    c->p += 4;
+                    ch = (v < 0x80) ? (char)v : '?';
+                }
+                break;
+            default: ch = e; break;  // '"', '\\', '/'
+            }
+        }
+        if (len + 1 >= cap) {
+            char *t = realloc(s, cap * 2);
+            if (!t) goto fail;
+            s = t;
+            cap *= 2;
+        }
+        s[len++] = ch;
+    }
+    if (c->p >= c->end) goto fail;
+    c->p++;  // closing quote
+    s[len] = '\0';
+    *out = s;
+    return 0;
+
+fail:
+    free(s);
+    return -1;
+}
+
+static int json_push(Json *j, size_t *cap) {
+    if (j->n < *cap) return 0;
+    size_t n = *cap ? *cap * 2 : 8;
+    Json *items = realloc(j->items, n * sizeof *items);
+    if (!items) return -1;
+    j->items = items;
+    if (j->type == JSON_OBJ) {
+        char **keys = realloc(j->keys, n * sizeof *keys);
+        if (!keys) return -1;
+        j->keys = keys;
+    }
+    *cap = n;
+    return 0;
+}
+
+static int json_container(JsonCursor *c, Json *out, char close) {
+    size_t cap = 0;
+    c->p++;  // '[' or '{'
+    json_ws(c);
+    if (c->p < c->end && *c->p == close) {
+        c->p++;
+        return 0;
+    }
+    for (;;) {
+        if (json_push(out, &cap) != 0) return -1;
+        Json *item = &out->items[out->n];
+        memset(item, 0, sizeof *item);
+        if (out->type == JSON_OBJ) {
+            out->keys[out->n] = NULL;
+            json_ws(c);
+            if (json_string(c, &out->keys[out->n]) != 0) return -1;
+            json_ws(c);
+            if (c->p >= c->end || *c->p != ':') {
+                free(out->keys[out->n]);
+                return -1;
+            }
+            c->p++;
+        }
+        int rc = json_value(c, item);
+        out->n++;  // counted even on failure so json_free() releases it
+        if (rc != 0) return -1;
+
+        json_ws(c);
+        if (c->p < c->end && *c->p == ',') {
+            c->p++;
+            continue;
+        }
+        if (c->p < c->end && *c->p == close) {
+            c->p++;
+            return 0;
+        }
+        return -1;
+    }
+}
+
+static int json_value(JsonCursor *c, Json *out) {
+    memset(out, 0, sizeof *out);
+    json_ws(c);
+    if (c->p >= c->end) return -1;
+
+    char ch = *c->p;
+    if (ch == '{' || ch == '[') {
+        if (++c->depth > JSON_MAX_DEPTH) return -1;
+        out->type = (ch == '{') ? JSON_OBJ : JSON_ARR;
+        int rc = json_container(c, out, ch == '{' ? '}' : ']');
+        c->depth--;
+        return rc;
+    }
+    if (ch == '"') {
+        out->type = JSON_STR;
+        return json_string(c, &out->str);
+    }
+    static const struct { const char *lit; JsonType type; double num; } lits[] = {
+        { "true", JSON_BOOL, 1.0 }, { "false", JSON_BOOL, 0.0 }, { "null", JSON_NULL, 0.0 },
+    };
+    for (size_t i = 0; i < sizeof lits / sizeof lits[0]; i++) {
+        size_t n = strlen(lits[i].lit);
+        if ((size_t)(c->end - c->p) >= n && strncmp(c->p, lits[i].lit, n) == 0) {
+            c->p += n;
+            out->type = lits[i].type;
+            out->num = lits[i].num;
+            return 0;
+        }
+    }
+
+    // The buffer is NUL-terminated, so strtod cannot run past it.
+    char *end = NULL;
+    double v = strtod(c->p, &end);
+    if (end == c->p) return -1;
+    c->p = end;
+    out->type = JSON_NUM;
+    out->num = v;
+    return 0;
+}
+
+static const Json *json_get(const Json *obj, const char *key) {
+    if (!obj || obj->type != JSON_OBJ) return NULL;
+    for (size_t i = 0; i < obj->n; i++) {
+        if (strcmp(obj->keys[i], key) == 0) return &obj->items[i];
+    }
+    return NULL;
+}
+
+static const char *json_get_str(const Json *obj, const char *key) {
+    const Json *v = json_get(obj, key);
+    return (v && v->type == JSON_STR) ? v->str : NULL;
+}
+
+static int json_get_num(const Json *obj, const char *key, double *out) {
+    const Json *v = json_get(obj, key);
+    if (!v || v->type != JSON_NUM) return -1;
+    *out = v->num;
+    return 0;
+}
+
+/*
+Read and parse a whole file. Returns 0 on success; errors are reported.
+*/
+static int json_load(const char *path, Json *out) {
+    memset(out, 0, sizeof *out);
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        fprintf(stderr, "bench-compare: %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    size_t cap = 1 << 14, len = 0;
+    char *buf = malloc(cap);
+    while (buf) {
+        len += fread(buf + len, 1, cap - len - 1, fp);
+        if (len + 1 < cap) break;
+        char *t = realloc(buf, cap * 2);
+        if (!t) {
+            free(buf);
+            buf = NULL;
+            break;
+        }
+        buf = t;
+        cap *= 2;
+    }
+    int rerr = ferror(fp);
+    fclose(fp);
+    if (!buf || rerr) {
+        free(buf);
+        fprintf(stderr, "bench-compare: %s: read failed\n", path);
+        return -1;
+    }
+    buf[len] = '\0';
+
+    JsonCursor c = { buf, buf + len, 0 };
+    int rc = json_value(&c, out);
+    json_ws(&c);
+    if (rc != 0 || c.p != c.end) {
+        fprintf(stderr, "bench-compare: %s: invalid JSON near byte %zu\n", path, (size_t)(c.p - buf));
+        json_free(out);
+        rc = -1;
+    }
+    free(buf);
+    return rc;
+}
+
+// ---- Statistics over runs ----
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double median_sorted(const double *v, size_t n) {
+    return (n % 2) ? v[n / 2] : 0.5 * (v[n / 2 - 1] + v[n / 2]);
+}
+
+/*
+Distribution-free confidence interval for the median: [v[k-1], v[n-k]] for
+the largest k with P(Binomial(n, 1/2) < k) <= 2.5%, which covers the median
+with probability >= 95%. Below 6 runs no such k exists; the range is used.
+*/
+static void median_ci_sorted(const double *v, size_t n, double *lo, double *hi) {
+    size_t k = 0;
+    double tail = 0.0, term = pow(0.5, (double)n);  // P(X = 0)
+    for (size_t i = 0; i < n / 2; i++) {
+        tail += term;                               // P(X <= i)
+        if (tail > 0.025) break;
+        k = i + 1;
+        term = term * (double)(n - i) / (double)(i + 1);
+    }
+    if (k == 0) k = 1;
+    *lo = v[k - 1];
+    *hi = v[n - k];
+}
+
+// ---- Comparison ----
+
+typedef struct {
+    const char *bench;
+    const char *metric;
+    double baseline;
+    int higher_better;
+    double threshold;
+} Tracked;
+
+typedef struct {
+    const char *baseline_path;
+    const char *write_path;   // --write-baseline
+    double threshold;         // default for metrics without their own
+    const char **runs;
+    size_t nruns;
+} CompareOptions;
+
+static void usage(FILE *out, const char *prog) {
+    fprintf(out,
+        "bench-compare – compare csvstat-bench runs against a baseline\n\n"
+        "Usage:\n"
+        "  %s --baseline <json> [--threshold <f>] <run.json>...\n"
+        "  %s --write-baseline <json> [--threshold <f>] <run.json>...\n\n"
+        "Options:\n"
+        "  --baseline <path>        Baseline to compare against\n"
+        "  --write-baseline <path>  Write a baseline from the medians of the runs\n"
+        "  --threshold <f>          Allowed relative regression (default 0.2; a\n"
+        "                           metric's own \"threshold\" takes precedence)\n"
+        "  --help                   Show this help\n",
+        prog, prog);
+}
+
+static int parse_cli(int argc, char **argv, CompareOptions *opt) {
+    opt->baseline_path = NULL;
+    opt->write_path = NULL;
+    opt->threshold = 0.2;
+    opt->runs = calloc((size_t)argc, sizeof *opt->runs);
+    opt->nruns = 0;
+    if (!opt->runs) return -1;
+
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        if (strcmp(a, "--help") == 0) {
+            usage(stdout, argv[0]);
+            return 1;
+        }
+        if (a[0] != '-' || a[1] != '-') {
+            opt->runs[opt->nruns++] = a;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            fprintf(stderr, "bench-compare: missing value for %s\n", a);
+            return -1;
+        }
+        const char *v = argv[++i];
+        if (strcmp(a, "--baseline") == 0) {
+            opt->baseline_path = v;
+        } else if (strcmp(a, "--write-baseline") == 0) {
+            opt->write_path = v;
+        } else if (strcmp(a, "--threshold") == 0) {
+            char *end = NULL;
+            opt->threshold = strtod(v, &end);
+            if (end == v || *end || !(opt->threshold >= 0.0 && opt->threshold < 1.0)) {
+                fprintf(stderr, "bench-compare: invalid value for --threshold: %s\n", v);
+                return -1;
+            }
+        } else {
+            fprintf(stderr, "bench-compare: unknown option: %s\n", a);
+            return -1;
+        }
+    }
+    if (opt->nruns == 0 || (!opt->baseline_path) == (!opt->write_path)) {
+        fprintf(stderr, "bench-compare: need run files and exactly one of --baseline, --write-baseline\n");
+        return -1;
+    }
+    return 0;
+}
+
+/*
+Find `metric` of benchmark `bench` in one run. Returns 0 and sets *out, or -1.
+*/
+static int run_metric(const Json *run, const char *bench, const char *metric, double *out) {
+    const Json *res = json_get(run, "results");
+    if (!res || res->type != JSON_ARR) return -1;
+    for (size_t i = 0; i < res->n; i++) {
+        const char *name = json_get_str(&res->items[i], "name");
+        if (name && strcmp(name, bench) == 0) return json_get_num(&res->items[i], metric, out);
+    }
+    return -1;
+}
+
+static int write_baseline(const CompareOptions *opt, const Json *runs) {
+    static const struct { const char *metric; int higher_better; } known[] = {
+        { "gb_per_s", 1 }, { "peak_rss_kib", 0 }, { "allocs_per_row", 0 },
+    };
+    const Json *res = json_get(&runs[0], "results");
+    double bytes = 0.0;
+    if (!res || res->type != JSON_ARR || json_get_num(&runs[0], "input_bytes", &bytes) != 0) {
+        fprintf(stderr, "bench-compare: %s: not a csvstat-bench result\n", opt->runs[0]);
+        return 2;
+    }
+    double *v = malloc(opt->nruns * sizeof *v);
+    FILE *out = fopen(opt->write_path, "w");
+    if (!v || !out) {
+        fprintf(stderr, "bench-compare: %s: %s\n", opt->write_path, strerror(errno));
+        free(v);
+        if (out) fclose(out);
+        return 2;
+    }
+
+    fprintf(out, "{\n  \"input_bytes\": %.0f,\n  \"runs\": %zu,\n  \"metrics\": [", bytes, opt->nruns);
+    size_t written = 0;
+    for (size_t i = 0; i < res->n; i++) {
+        const char *name = json_get_str(&res->items[i], "name");
+        if (!name) continue;
+        for (size_t m = 0; m < sizeof known / sizeof known[0]; m++) {
+            size_t n = 0;
+            for (size_t r = 0; r < opt->nruns; r++) {
+                if (run_metric(&runs[r], name, known[m].metric, &v[n]) == 0) n++;
+            }
+            if (n != opt->nruns) continue;
+            qsort(v, n, sizeof *v, cmp_double);
+            fprintf(out, "%s\n    {\"bench\": \"%s\", \"metric\": \"%s\", \"value\": %.6g, "
+                         "\"better\": \"%s\", \"threshold\": %.3g}",
+                    written ? "," : "", name, known[m].metric, median_sorted(v, n),
+                    known[m].higher_better ? "higher" : "lower", opt->threshold);
+            written++;
+        }
+    }
+    fprintf(out, "\n  ]\n}\n");
+    free(v);
+    if (fclose(out) != 0) {
+        fprintf(stderr, "bench-compare: %s: write failed\n", opt->write_path);
+        return 2;
+    }
+    printf("wrote %zu metrics to %s\n", written, opt->write_path);
+    return 0;
+}
+
+static int compare(const CompareOptions *opt, const Json *runs) {
+    Json base;
+    if (json_load(opt->baseline_path, &base) != 0) return 2;
+
+    const Json *metrics = json_get(&base, "metrics");
+    double base_bytes = 0.0;
+    if (!metrics || metrics->type != JSON_ARR || json_get_num(&base, "input_bytes", &base_bytes) != 0) {
+        fprintf(stderr, "bench-compare: %s: missing \"input_bytes\" or \"metrics\"\n", opt->baseline_path);
+        json_free(&base);
+        return 2;
+    }
+    for (size_t r = 0; r < opt->nruns; r++) {
+        double bytes = -1.0;
+        json_get_num(&runs[r], "input_bytes", &bytes);
+        if (bytes != base_bytes) {
+            fprintf(stderr, "bench-compare: %s: input is %.0f bytes, baseline was measured on %.0f; "
+                            "use the same corpus or write a new baseline\n",
+                    opt->runs[r], bytes, base_bytes);
+            json_free(&base);
+            return 2;
+        }
+    }
+
+    double *v = malloc(opt->nruns * sizeof *v);
+    if (!v) {
+        json_free(&base);
+        return 2;
+    }
+
+    int status = 0;
+    printf("%-20s %-14s %12s %12s %12s %12s %8s  %s\n",
+           "bench", "metric", "baseline", "median", "ci_lo", "ci_hi", "change", "status");
+    for (size_t i = 0; i < metrics->n; i++) {
+        const Json *m = &metrics->items[i];
+        Tracked t;
+        const char *better = json_get_str(m, "better");
+        t.bench = json_get_str(m, "bench");
+        t.metric = json_get_str(m, "metric");
+        t.threshold = opt->threshold;
+        json_get_num(m, "threshold", &t.threshold);
+        if (!t.bench || !t.metric || json_get_num(m, "value", &t.baseline) != 0 ||
+            !better || (strcmp(better, "higher") != 0 && strcmp(better, "lower") != 0)) {
+            fprintf(stderr, "bench-compare: %s: metric %zu is malformed\n", opt->baseline_path, i);
+            status = 2;
+            break;
+        }
+        t.higher_better = strcmp(better, "higher") == 0;
+
+        size_t n = 0;
+        for (size_t r = 0; r < opt->nruns; r++) {
+            if (run_metric(&runs[r], t.bench, t.metric, &v[n]) == 0) n++;
+        }
+        if (n < opt->nruns) {
+            printf("%-20s %-14s %12.6g %12s %12s %12s %8s  MISSING\n",
+                   t.bench, t.metric, t.baseline, "-", "-", "-", "-");
+            status = 1;
+            continue;
+        }
+
+        qsort(v, n, sizeof *v, cmp_double);
+        double med = median_sorted(v, n), lo = 0.0, hi = 0.0;
+        median_ci_sorted(v, n, &lo, &hi);
+        double change = t.baseline != 0.0 ? (med - t.baseline) / t.baseline : 0.0;
+
+        const char *verdict = "ok";
+        if (t.higher_better) {
+            if (hi < t.baseline * (1.0 - t.threshold)) verdict = "REGRESSION";
+            else if (lo > t.baseline * (1.0 + t.threshold)) verdict = "improved";
+        } else {
+            if (lo > t.baseline * (1.0 + t.threshold)) verdict = "REGRESSION";
+            else if (hi < t.baseline * (1.0 - t.threshold)) verdict = "improved";
+        }
+        if (verdict[0] == 'R') status = 1;
+
+        printf("%-20s %-14s %12.6g %12.6g %12.6g %12.6g %+7.1f%%  %s\n",
+               t.bench, t.metric, t.baseline, med, lo, hi, change * 100.0, verdict);
+    }
+
+    if (status == 1) {
+        printf("FAIL: a metric regressed beyond its threshold or is missing\n");
+    } else if (status == 0) {
+        printf("OK: %zu metrics within threshold over %zu runs\n", metrics->n, opt->nruns);
+    }
+    free(v);
+    json_free(&base);
+    return status;
+}
+
+int main(int argc, char **argv) {
+    CompareOptions opt;
+    int rc = parse_cli(argc, argv, &opt);
+    if (rc != 0) {
+        if (rc < 0) usage(stderr, argv[0]);
+        free(opt.runs);
+        return rc < 0 ? 2 : 0;
+    }
+
+    Json *runs = calloc(opt.nruns, sizeof *runs);
+    if (!runs) {
+        free(opt.runs);
+        return 2;
+    }
+    size_t loaded = 0;
+    int status = 0;
+    for (; loaded < opt.nruns; loaded++) {
+        if (json_load(opt.runs[loaded], &runs[loaded]) != 0) {
+            status = 2;
+            break;
+        }
+    }
+
+    if (status == 0) {
+        status = opt.write_path ? write_baseline(&opt, runs) : compare(&opt, runs);
+    }
+
+    for (size_t i = 0; i < loaded; i++) json_free(&runs[i]);
+    free(runs);
+    free(opt.runs);
+    return status;
+}
@@ -0,0 +1,293 @@
+/*
+csvgen: deterministic synthetic CSV for the benchmarks.
+
+The same options and seed always produce the same bytes, so results from
+different builds or machines are measured on identical input.
+
+Columns are numeric ("num0", "num1", ...) or text ("txt0", ...), spread
+evenly across the row in the requested ratio. Numeric cells mix integers
+and two-decimal values of varying width and sign; with --invalid a share of
+them is replaced by cells csvstat rejects ("", "n/a", "12x", "-"). Text
+cells are lowercase letters whose width is chosen so that rows average
+about --line-len bytes.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+
+#define GEN_OUT_BUF (1u << 16)
+#define GEN_NUM_WIDTH 6  // rough average width of a numeric cell (bytes)
+
+typedef struct {
+    unsigned long long rows;
+    size_t cols;
+    double numeric;     // share of numeric columns, [0, 1]
+    size_t line_len;    // target average row length (bytes)
+    double invalid;     // share of numeric cells that are invalid, [0, 1]
+    int crlf;
+    uint64_t seed;
+    const char *out_path;  // NULL: stdout
+} GenOptions;
+
+static void usage(FILE *out, const char *prog) {
+    fprintf(out,
+        "csvgen – deterministic synthetic CSV for csvstat benchmarks\n\n"
+        "Usage:\n"
+        "  %s [options]\n\n"
+        "Options:\n"
+        "  --rows <n>        Data rows (default 1000000)\n"
+        "  --cols <n>        Columns (default 8)\n"
+        "  --numeric <f>     Share of numeric columns, 0..1 (default 0.75)\n"
+        "  --line-len <n>    Approximate bytes per row, set through text cell width (default 64)\n"
+        "  --invalid <f>     Share of numeric cells that are not numbers, 0..1 (default 0)\n"
+        "  --crlf            End rows with \\r\\n\n"
+        "  --seed <n>        Generator seed (default 1)\n"
+        "  -o <path>         Output file (default stdout)\n"
+        "  --help            Show this help\n",
+        prog);
+}
+
+static int parse_u64(const char *s, unsigned long long *out) {
+    if (!s || s[0] < '0' || s[0] > '9') return -1;
+    char *end = NULL;
+    errno = 0;
+    unsigned long long v = strtoull(s, &end, 10);
+    if (errno == ERANGE || *end != '\0') return -1;
+    *out = v;
+    return 0;
+}
+
+static int parse_share(const char *s, double *out) {
+    if (!s || !s[0]) return -1;
+    char *end = NULL;
+    errno = 0;
+    double v = strtod(s, &end);
+    if (errno == ERANGE || *end != '\0' || !(v >= 0.0 && v <= 1.0)) return -1;
+    *out = v;
+    return 0;
+}
+
+static int parse_cli(int argc, char **argv, GenOptions *opt) {
+    opt->rows = 1000000;
+    opt->cols = 8;
+    opt->numeric = 0.75;
+    opt->line_len = 64;
+    opt->invalid = 0.0;
+    opt->crlf = 0;
+    opt->seed = 1;
+    opt->out_path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        const char *v = (i + 1 < argc) ? argv[i + 1] : NULL;
+        unsigned long long n = 0;
+
+        if (strcmp(a, "--help") == 0) {
+            usage(stdout, argv[0]);
+            return 1;
+        } else if (strcmp(a, "--crlf") == 0) {
+            opt->crlf = 1;
+            continue;
+        } else if (!v) {
+            fprintf(stderr, "csvgen: missing value for %s\n", a);
+            return -1;
+        } else if (strcmp(a, "--rows") == 0) {
+            if (parse_u64(v, &opt->rows) != 0) goto bad;
+        } else if (strcmp(a, "--cols") == 0) {
+            if (parse_u64(v, &n) != 0 || n == 0 || n > 100000) goto bad;
+            opt->cols = (size_t)n;
+        } else if (strcmp(a, "--numeric") == 0) {
+            if (parse_share(v, &opt->numeric) != 0) goto bad;
+        } else if (strcmp(a, "--line-len") == 0) {
+            if (parse_u64(v, &n) != 0 || n == 0 || n > (1u << 20)) goto bad;
+            opt->line_len = (size_t)n;
+        } else if (strcmp(a, "--invalid") == 0) {
+            if (parse_share(v, &opt->invalid) != 0) goto bad;
+        } else if (strcmp(a, "--seed") == 0) {
+            if (parse_u64(v, &n) != 0) goto bad;
+            opt->seed = (uint64_t)n;
+        } else if (strcmp(a, "-o") == 0) {
+            opt->out_path = v;
+        } else {
+            fprintf(stderr, "csvgen: unknown option: %s\n", a);
+            return -1;
+        }
+        i++;
+        continue;
+bad:
+        fprintf(stderr, "csvgen: invalid value for %s: %s\n", a, v);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+splitmix64: small, fast and fully determined by the seed.
+*/
+static uint64_t rng_next(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// Uniform in [0, 1).
+static double rng_unit(uint64_t *state) {
+    return (double)(rng_next(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+typedef struct {
+    FILE *fp;
+    char buf[GEN_OUT_BUF];
+    size_t len;
+    int err;
+} Out;
+
+static void out_flush(Out *o) {
+    if (o->len && fwrite(o->buf, 1, o->len, o->fp) != o->len) o->err = 1;
+    o->len = 0;
+}
+
+static void out_bytes(Out *o, const char *s, size_t n) {
+    if (GEN_OUT_BUF - o->len < n) out_flush(o);
+    if (n > GEN_OUT_BUF) {
+        if (fwrite(s, 1, n, o->fp) != n) o->err = 1;
+        return;
+    }
+    memcpy(o->buf + o->len, s, n);
+    o->len += n;
+}
+
+static void out_numeric(Out *o, uint64_t *rng, double invalid) {
+    static const char *const bad[] = { "", "n/a", "12x", "-" };
+    char cell[32];
+    int n = 0;
+
+    if (invalid > 0.0 && rng_unit(rng) < invalid) {
+        const char *b = bad[rng_next(rng) & 3];
+        out_bytes(o, b, strlen(b));
+        return;
+    }
+
+    uint64_t r = rng_next(rng);
+    unsigned digits = 1 + (unsigned)(r % 7);          // 1..7 integer digits
+    unsigned long long mag = 1;
+    for (unsigned d = 0; d < digits; d++) mag *= 10;
+    unsigned long long ip = (r >> 8) % mag;
+    const char *sign = ((r >> 60) & 7) == 0 ? "-" : "";
+
+    if (((r >> 56) & 3) == 0) {
+        n = snprintf(cell, sizeof cell, "%s%llu", sign, ip);
+    } else {
+        n = snprintf(cell, sizeof cell, "%s%llu.%02u", sign, ip, (unsigned)((r >> 40) % 100));
+    }
+    out_bytes(o, cell, (size_t)n);
+}
+
+static void out_text(Out *o, uint64_t *rng, size_t width) {
+    char cell[256];
+    size_t lo = width / 2 ? width / 2 : 1;
+    size_t n = lo + (size_t)(rng_next(rng) % (width + 1));  // about width on average
+    uint64_t r = 0;
+
+    while (n > 0) {
+        size_t k = n < sizeof cell ? n : sizeof cell;
+        for (size_t i = 0; i < k; i++) {
+            if (i % 12 == 0) r = rng_next(rng);
+            cell[i] = (char)('a' + (r % 26));
+            r /= 26;
+        }
+        out_bytes(o, cell, k);
+        n -= k;
+    }
+}
+
+int main(int argc, char **argv) {
+    GenOptions opt;
+    int rc = parse_cli(argc, argv, &opt);
+    if (rc != 0) {
+        if (rc < 0) usage(stderr, argv[0]);
+        return rc < 0 ? 2 : 0;
+    }
+
+    // Column c is numeric when it falls in the first `nnum` of every `cols`
+    // slots of an evenly spread pattern (column 0 is numeric if any is).
+    size_t nnum = (size_t)(opt.numeric * (double)opt.cols + 0.5);
+    size_t ntext = opt.cols - nnum;
+    unsigned char *is_num = malloc(opt.cols);
+    if (!is_num) {
+        fprintf(stderr, "csvgen: out of memory\n");
+        return 1;
+    }
+    for (size_t c = 0; c < opt.cols; c++) {
+        is_num[c] = (unsigned char)(((unsigned long long)c * nnum) % opt.cols < nnum);
+    }
+
+    size_t fixed = nnum * GEN_NUM_WIDTH + opt.cols;  // numeric cells + delimiters/newline
+    size_t width = 1;
+    if (ntext > 0 && opt.line_len > fixed) width = (opt.line_len - fixed) / ntext;
+    if (width == 0) width = 1;
+
+    Out *o = malloc(sizeof *o);
+    if (!o) {
+        free(is_num);
+        fprintf(stderr, "csvgen: out of memory\n");
+        return 1;
+    }
+    o->len = 0;
+    o->err = 0;
+    o->fp = stdout;
+    if (opt.out_path) {
+        o->fp = fopen(opt.out_path, "wb");
+        if (!o->fp) {
+            fprintf(stderr, "csvgen: %s: %s\n", opt.out_path, strerror(errno));
+            free(o);
+            free(is_num);
+            return 1;
+        }
+    }
+
+    const char *eol = opt.crlf ? "\r\n" : "\n";
+    size_t eol_len = opt.crlf ? 2 : 1;
+    char name[32];
+    size_t num_i = 0, txt_i = 0;
+
+    for (size_t c = 0; c < opt.cols; c++) {
+        int n = snprintf(name, sizeof name, "%s%zu", is_num[c] ? "num" : "txt",
+                         is_num[c] ? num_i++ : txt_i++);
+        if (c) out_bytes(o, ",", 1);
+        out_bytes(o, name, (size_t)n);
+    }
+    out_bytes(o, eol, eol_len);
+
+    uint64_t rng = opt.seed;
+    for (unsigned long long r = 0; r < opt.rows && !o->err; r++) {
+        for (size_t c = 0; c < opt.cols; c++) {
+            if (c) out_bytes(o, ",", 1);
+            if (is_num[c]) {
+                out_numeric(o, &rng, opt.invalid);
+            } else {
+                out_text(o, &rng, width);
+            }
+        }
+        out_bytes(o, eol, eol_len);
+    }
+    out_flush(o);
+
+    int failed = o->err;
+    if (opt.out_path) {
+        if (fclose(o->fp) != 0) failed = 1;
+    } else if (fflush(stdout) != 0) {
+        failed = 1;
+    }
+    if (failed) {
+        fprintf(stderr, "csvgen: write failed: %s\n", strerror(errno));
+    }
+
+    free(o);
+    free(is_num);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,114 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+/*
+Checkpoint: a resumable snapshot of a sequential scan (--checkpoint).
+
+A checkpoint holds everything the final summary depends on: the byte offset
+of the next unread record, the row counters, the Stats fields and the
+rejected-row diagnostics (with the length of --reject-file). Doubles
+are stored as their exact bits, so a resumed run continues from precisely
+the state the interrupted one had and prints identical output.
+
+Identity
+--------
+A checkpoint is only applied to the job and input it was taken from:
+- `job`: a hash of the options and header the state depends on (column or
+  expression, filters, delimiter, quoting), computed by the caller
+- plain files: a hash of the CHECKPOINT_TAIL bytes before `offset`, and the
+  file must still reach `offset`. A file that only grew since (an
+  append-only log) still matches, so resuming processes just the new rows.
+- compressed files: size and modification time must be unchanged
+
+File layout (native byte order, like the zone-map sidecar)
+----------------------------------------------------------
+magic       8 bytes  "CSVCKPT5"
+job         u64
+compressed  u64      0 or 1
+src_size    u64
+src_mtime   i64
+tail_hash   u64
+offset      u64
+row_no      u64
+counters    6 x u64  (ScanCounters, in declaration order)
+stats       u64 n, u64 moments, u64 precision, f64 mean, f64 m2, f64 m3,
+            f64 m4, f64 min, f64 max, f64 sum, f64 sum_c, f64 m2_c
+decimal     u64 n, i64 min, i64 max, then sum and sumsq as 128-bit integers
+            (u64 low half, u64 high half each)
+diag        u64 count[DIAG_NKINDS], u64 total, u64 nfirst, u64 nsample,
+            u64 sampled, u64 rng, then DIAG_FIRST + DIAG_SAMPLE examples
+            (first, then sample), each u64 kind, u64 chunk, u64 row_no,
+            u64 len and DIAG_TEXT_MAX bytes of text
+reject_off  u64      --reject-file length (0 without one)
+
+Writes go to `<path>.tmp`, are fsync'ed and then renamed over `path`, so a
+crash leaves either the previous checkpoint or the new one, never a torn
+file.
+*/
+
+#include "scan.h"
+#include "stats.h"
+#include "decimal.h"
+#include "diag.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CHECKPOINT_TAIL 4096          // bytes hashed before the offset (plain files)
+#define CHECKPOINT_HASH_SEED 0xcbf29ce484222325ull
+
+typedef struct {
+    uint64_t job;                 // hash of the options/header the state depends on
+    int compressed;               // 1: identify the input by size/mtime
+    unsigned long long src_size;  // input file size when saved
+    long long src_mtime;          // input modification time (seconds) when saved
+    uint64_t tail_hash;           // plain input: hash of the bytes before offset
+
+    unsigned long long offset;    // byte offset of the next unread record
+    size_t row_no;                // data rows seen (for warning row numbers)
+    ScanCounters sc;
+    Stats st;
+    DecStats dec;                 // --decimal accumulator
+    Diag diag;                    // counts, examples, sampler (no reject buffer)
+    unsigned long long reject_offset; // --reject-file length, 0 without one
+} Checkpoint;
+
+/*
+FNV-1a over `n` bytes, continuing from `h` (start with CHECKPOINT_HASH_SEED).
+*/
+uint64_t checkpoint_hash(uint64_t h, const void *data, size_t n);
+
+/*
+Fill the identity fields of `cp` for the input file at `path` as of
+`cp->offset`.
+
+Returns 0 on success, -1 on I/O error (errno is set).
+*/
+int checkpoint_identify(Checkpoint *cp, const char *path, int compressed);
+
+/*
+Check whether `cp` was taken from the input at `path` (see "Identity"); the
+caller compares `job` itself.
+
+Returns 1 if it matches, 0 if not, -1 on I/O error (errno is set).
+*/
+int checkpoint_matches(const Checkpoint *cp, const char *path, int compressed);
+
+/*
+Atomically write `cp` to `path`.
+
+Returns 0 on success, -1 on I/O error (errno is set).
+*/
+int checkpoint_save(const char *path, const Checkpoint *cp);
+
+/*
+Read a checkpoint from `path`.
+
+Returns:
+- 0 on success
+- 1 if `path` does not exist (start from scratch)
+- -1 if the file cannot be read or is not a valid checkpoint
+*/
+int checkpoint_load(const char *path, Checkpoint *cp);
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef CHUNKER_H
+#define CHUNKER_H
+
+/*
+Chunker: split a byte range of a CSV file into chunks that each begin at a
+true record boundary, so they can be scanned independently.
+
+Cutting at "the next newline after offset k" is wrong once quoted fields may
+contain newlines: the newline may be inside a field. Whether it is depends on
+the quote parity of everything before it, which a worker starting mid-file
+does not know. The chunker resolves this in two passes:
+
+Pass 1 (parallel, one thread per chunk)
+    Scan the raw chunk [k_i, k_i+1) 64 bytes at a time. For each block, build
+    a bitmask of '"' bytes and of '\n' bytes; the prefix-XOR of the quote mask
+    marks the bytes inside a quoted field. The scan records:
+    - parity: the number of quotes in the chunk, mod 2
+    - first[0]: the offset just past the first newline outside quotes,
+      assuming the chunk starts outside a quoted field
+    - first[1]: the same, assuming it starts inside one
+    Both hypotheses are tracked at once (one is the complement of the other).
+
+Pass 2 (serial, O(chunks))
+    The state at the start of chunk i is the XOR of the parities of chunks
+    0..i-1 (the range itself starts at a record boundary). That picks the
+    right `first[]` for each chunk; a chunk without any record boundary is
+    merged into its successor.
+
+The quote model matches the LineReader's quote-aware mode: every '"' toggles
+the state and a '\n' only ends a record outside quotes. With quotes disabled
+only pass 2 runs, on plain newlines.
+*/
+
+#include <stddef.h>
+
+typedef struct {
+    unsigned long long start;  // byte offset of the first record
+    unsigned long long end;    // byte offset just past the last record
+} CsvChunk;
+
+/*
+Split [begin, end) of the file at `path` into `nchunks` record-aligned chunks.
+
+`begin` must be a record boundary (e.g. just past the header). On success
+`out[0].start == begin`, `out[nchunks - 1].end == end`, and chunks are
+contiguous; a chunk may be empty (start == end) when the range holds fewer
+records than chunks.
+
+If `quotes` is 0, '"' is an ordinary byte.
+
+Returns:
+- 0 on success
+- -1 on invalid input, I/O error (errno is preserved) or thread failure
+*/
+int csv_chunk_plan(const char *path, unsigned long long begin, unsigned long long end,
+                   int quotes, size_t nchunks, CsvChunk *out);
+
+#endif
@@ -0,0 +1,114 @@
+#ifndef CORR_H
+#define CORR_H
+
+/*
+Corr: covariance, correlation and least-squares fits between columns
+(--corr), in one streaming pass.
+
+CoMoment is the two-column accumulator: Welford's update extended with the
+co-moment C_xy = sum (x - mean_x)(y - mean_y), so the covariance, Pearson r
+and the regression line of y on x come out of the same numerically stable
+state. Partial states merge exactly like Stats (Chan et al.). It owns no
+heap memory and is safe to copy by value.
+
+CorrMatrix does the same for k columns at once: means plus the k x k
+co-moments (the diagonal holds each column's m2). Updating k^2/2 co-moments
+per row would re-read the whole matrix for every row, so rows are buffered
+CORR_BLOCK at a time instead and folded in as a block: deviations from the
+block means, then their cross products summed in CORR_TILE x CORR_TILE
+tiles, each tile a set of register accumulators fed one row at a time with
+contiguous runs of the row (a vectorizable outer product; the block is
+small enough to stay in cache across the tiles), and finally a Chan merge
+of the block into the running state. Pending rows are folded by
+`corr_matrix_flush()`; read or merge only flushed matrices.
+
+Ownership / Lifetime
+--------------------
+CorrMatrix owns its arrays; `corr_matrix_destroy()` is idempotent.
+*/
+
+#include <stddef.h>
+
+#define CORR_MAX_COLS 64    // columns in one --corr list
+#define CORR_BLOCK 256      // rows folded into a CorrMatrix at once
+#define CORR_TILE 4         // co-moments per tile side
+
+typedef struct {
+    size_t n;
+    double mean_x;
+    double mean_y;
+    double m2_x;    // sum of squared deviations of x
+    double m2_y;
+    double c_xy;    // co-moment: sum of (x - mean_x)(y - mean_y)
+} CoMoment;
+
+void comoment_init(CoMoment *c);
+
+/*
+Add one (x, y) pair. Returns 0 on success, -1 on invalid input.
+*/
+int comoment_push(CoMoment *c, double x, double y);
+
+/*
+Merge the pairs summarized by `src` into `dst`.
+Returns 0 on success, -1 on invalid input.
+*/
+int comoment_merge(CoMoment *dst, const CoMoment *src);
+
+/*
+Statistics of the pairs. Each returns 0 on success and -1 when undefined:
+- covariance (sample, n - 1 denominator): fewer than two pairs
+- Pearson r: either column has no spread
+- slope and intercept of the least-squares line y = slope * x + intercept:
+  x has no spread
+*/
+int comoment_covariance(const CoMoment *c, double *out);
+int comoment_pearson(const CoMoment *c, double *out);
+int comoment_slope(const CoMoment *c, double *out);
+int comoment_intercept(const CoMoment *c, double *out);
+
+typedef struct {
+    size_t k;           // columns
+    size_t kp;          // k rounded up to CORR_TILE (padding columns stay 0)
+    size_t n;           // rows folded in
+    double *mean;       // owned, k
+    double *cm;         // owned, kp x kp co-moments (row i, column j >= i)
+    double *block;      // owned, CORR_BLOCK x kp pending rows, row-major
+    size_t nblock;      // pending rows
+} CorrMatrix;
+
+/*
+Initialize a matrix over `k` columns (2 <= k <= CORR_MAX_COLS).
+
+Returns 0 on success, -1 on allocation failure or invalid input.
+*/
+int corr_matrix_init(CorrMatrix *m, size_t k);
+
+/*
+Release the owned arrays. Safe to call multiple times on the same object.
+*/
+void corr_matrix_destroy(CorrMatrix *m);
+
+/*
+Add one row of `k` values; a full block is folded in.
+*/
+void corr_matrix_push(CorrMatrix *m, const double *row);
+
+/*
+Fold the pending rows into the running state.
+*/
+void corr_matrix_flush(CorrMatrix *m);
+
+/*
+Merge the flushed `src` into the flushed `dst` (same k).
+Returns 0 on success, -1 on invalid input.
+*/
+int corr_matrix_merge(CorrMatrix *dst, const CorrMatrix *src);
+
+/*
+The CoMoment of columns `i` and `j` (x = column i), for the statistics
+above. Returns 0 on success, -1 on invalid input.
+*/
+int corr_matrix_pair(const CorrMatrix *m, size_t i, size_t j, CoMoment *out);
+
+#endif
@@ -2,15 +2,22 @@
 #define CSV_H
 
 /*
-CSV parser (v1) rules
----------------------
-- Delimiter: ','
-- No quoted fields / no escaping
-- Leading/trailing whitespace is trimmed (spaces + tabs)
+CSV parser rules
+----------------
+- Delimiter: ',' by default; any other single byte may be configured with
+  `csv_parser_set_delim()` (e.g. '\t', '|', ';')
+- Quoted fields (RFC 4180): a field starting with '"' may contain delimiters,
+  newlines and doubled quotes (`""` -> `"`); its content is not trimmed.
+  Quote handling can be disabled per parser with `csv_parser_set_quotes()`.
+- Rows without any '"' take a fast path identical to the unquoted parser.
+- Leading/trailing whitespace is trimmed (spaces + tabs; spaces only when
+  the delimiter is a tab)
 - Empty fields are preserved (e.g. a,,b gives an empty middle field)
 - Empty lines may be skipped by the caller, depending on caller policy
 - Parsing is done in-place: delimiter and trailing-whitespace bytes may be
-  replaced with '\0' terminators
+  replaced with '\0' terminators, and quoted fields are unescaped in place
+- Records spanning several lines must be assembled by the caller (see
+  `line_reader_set_quotes()`)
 
 Ownership / Lifetime
 --------------------
@@ -25,6 +32,7 @@ Ownership / Lifetime
 */
 
 #include <stddef.h>
+#include <stdint.h>
 
 /*
 A borrowed view of one parsed CSV row.
@@ -45,6 +53,9 @@ Owns a reusable scratch array used to store field pointers for the current row.
 typedef struct {
   const char **scratch; // owned scratch array storage
   size_t cap;           // capacity (#pointers)
+  char *rest;           // unsplit remainder after csv_split_n() stopped early, or NULL
+  int quotes;           // 1 if quoted fields are recognized (default)
+  char delim;           // field delimiter (default ',')
 } CsvParser;
 
 /*
@@ -74,6 +85,33 @@ Safe to call multiple times on the same object.
 */
 void csv_parser_destroy(CsvParser *p);
 
+/*
+Enable (default) or disable RFC 4180 quote handling.
+
+With quotes disabled, '"' is an ordinary byte, as in the v1 parser.
+*/
+void csv_parser_set_quotes(CsvParser *p, int enabled);
+
+/*
+Set the field delimiter.
+
+',', '\t', '|' and ';' use split loops specialized for that byte; any other
+byte uses a generic loop.
+
+Returns:
+- 0 on success
+- -1 if `delim` is '"', '\n', '\r' or '\0', or on invalid input
+*/
+int csv_parser_set_delim(CsvParser *p, char delim);
+
+/*
+Guess the delimiter of a header line.
+
+Counts ',', '\t', ';' and '|' outside quoted sections and returns the most
+frequent one; ties go to that order, and ',' is returned if none occurs.
+*/
+char csv_sniff_delim(const char *line);
+
 /*
 Split `line` into fields in-place and return a row view.
 
@@ -83,7 +121,7 @@ Requirements:
 - `out` must be a valid output pointer
 
 Effects:
-- Modifies `line` by inserting '\0' terminators
+- Modifies `line` by inserting '\0' terminators and unescaping quoted fields
 - Writes field pointers into parser-owned scratch storage
 - Sets `out->fields` and `out->nfields`
 
@@ -93,6 +131,34 @@ Returns:
 */
 int csv_split(CsvParser *p, char *line, CsvRowView *out);
 
+/*
+Like `csv_split()`, but stop after the first `max_fields` fields.
+
+Callers that only need the leading columns of a row (e.g. to evaluate a
+filter) avoid touching the rest of the line. The unsplit remainder is kept
+by the parser so `csv_split_more()` can continue where this call stopped.
+
+`out->nfields` is min(actual fields, max_fields).
+
+Returns:
+- 0 on success
+- -1 on failure (allocation failure or invalid input)
+*/
+int csv_split_n(CsvParser *p, char *line, size_t max_fields, CsvRowView *out);
+
+/*
+Continue a `csv_split_n()` row until `max_fields` fields are available.
+
+`out` must be the row view filled by the previous `csv_split_n()` call on
+the same parser and line. If that call already reached the end of the line,
+this is a no-op.
+
+Returns:
+- 0 on success
+- -1 on failure (allocation failure or invalid input)
+*/
+int csv_split_more(CsvParser *p, size_t max_fields, CsvRowView *out);
+
 /*
 Find a column index in a parsed header row.
 
@@ -102,4 +168,159 @@ Returns:
 */
 int csv_find_column(const CsvRowView *header, const char *name, size_t *out_index);
 
+#define CSV_NO_COLUMN ((size_t)-1)
+
+/*
+Batch splitting
+---------------
+`csv_split_batch()` splits many records of a read-only text block at once
+and stores, for each requested column, the (offset, length) of its field in
+every row: a column-major table that numeric conversion and stats can walk
+column by column. The block is never modified and no per-row view is built.
+
+Record and field rules are those of the line-based path (LineReader in
+quote-aware mode + `csv_split()`): records end at '\n' outside quotes, a
+trailing '\r' is dropped, blank records are skipped, fields are trimmed
+unless quoted.
+*/
+
+#define CSV_SPAN_MISSING 1u  // the row has no such field (short row)
+#define CSV_SPAN_RAW     2u  // quoted field needing unescaping; the span covers the raw bytes
+
+typedef struct {
+    size_t off;       // offset of the field bytes within the block
+    size_t len;       // number of field bytes
+    unsigned flags;   // CSV_SPAN_* flags
+} CsvSpan;
+
+typedef struct {
+    size_t *cols;       // owned: requested column indices, in request order
+    size_t ncols;
+    size_t *slot_of;    // owned: slot of column c (c < max_col), or CSV_NO_COLUMN
+    size_t max_col;     // 1 + highest requested column
+
+    size_t cap;         // max rows per batch
+    CsvSpan *spans;     // owned, ncols x cap, column-major: spans[slot * cap + row]
+    size_t *row_off;    // owned: offset of each row's first byte in the block
+    size_t nrows;       // rows in the current batch
+} CsvBatch;
+
+/*
+Return 1 if the batch satisfies its internal invariants, else 0.
+*/
+int csv_batch_is_valid(const CsvBatch *b);
+
+/*
+Initialize a batch of up to `cap` rows for the columns `cols[0..ncols)`.
+
+Returns:
+- 0 on success
+- -1 on allocation failure or invalid input
+*/
+int csv_batch_init(CsvBatch *b, const size_t *cols, size_t ncols, size_t cap);
+
+/*
+Destroy the batch and release its owned memory.
+
+Safe to call multiple times on the same object.
+*/
+void csv_batch_destroy(CsvBatch *b);
+
+/*
+Split complete records from `buf[0..len)` into `b` until the batch is full
+or the block is exhausted, using the delimiter and quote mode of `p`.
+
+A record is complete when its terminating newline is in the block, or, if
+`at_eof` is non-zero, when the block ends. `*consumed` receives the number
+of bytes taken (always a record boundary); the caller keeps the rest for the
+next call. `*consumed == 0` with `b->nrows == 0` means a single record is
+longer than the block.
+
+Returns 0 on success, -1 on invalid input.
+*/
+int csv_split_batch(const CsvParser *p, CsvBatch *b, const char *buf, size_t len,
+                    int at_eof, size_t *consumed);
+
+/*
+Copy the text of field `sp` (from block `buf`) to `dst` as a NUL-terminated
+string, unescaping CSV_SPAN_RAW fields the way `csv_split()` does.
+
+Returns the length of the field text; at most `cap - 1` bytes are written
+(like snprintf, a result >= cap means the copy was truncated).
+*/
+size_t csv_span_copy(const CsvParser *p, const char *buf, const CsvSpan *sp,
+                     char *dst, size_t cap);
+
+/*
+Hash index of header names, built once per file.
+
+`csv_find_column()` is a linear scan, which is fine for one lookup. Wide
+files (thousands of columns) queried for many names use this instead: an
+open-addressing table (FNV-1a hash, linear probing, load factor <= 1/2) of
+name -> first column index.
+
+The index owns copies of the names, so it stays valid after the header's
+line buffer is reused. Duplicate names are detected while building: lookups
+return the first occurrence, and `ndups` / `first_dup` let callers warn.
+*/
+typedef struct {
+    char *names;          // owned arena of NUL-terminated names
+    size_t *offsets;      // owned: offset of column i's name in `names`
+    uint64_t *hashes;     // owned: hash of column i's name
+    size_t ncols;
+
+    size_t *slots;        // owned table: column index + 1, or 0 if empty
+    size_t mask;          // table size - 1 (table size is a power of two)
+
+    size_t ndups;         // columns whose name repeats an earlier column
+    size_t first_dup;     // first such column, or CSV_NO_COLUMN
+} CsvHeaderIndex;
+
+/*
+Return 1 if the index satisfies its internal invariants, else 0.
+*/
+int csv_header_index_is_valid(const CsvHeaderIndex *idx);
+
+/*
+Build an index over the fields of `header`.
+
+Returns:
+- 0 on success
+- -1 on allocation failure or invalid input
+*/
+int csv_header_index_init(CsvHeaderIndex *idx, const CsvRowView *header);
+
+/*
+Destroy the index and release its owned memory.
+
+Safe to call multiple times on the same object.
+*/
+void csv_header_index_destroy(CsvHeaderIndex *idx);
+
+/*
+Return the name of column `i` (NULL if out of range).
+*/
+const char *csv_header_index_name(const CsvHeaderIndex *idx, size_t i);
+
+/*
+Look up one column by name (first occurrence if duplicated).
+
+Returns:
+- 0 on success and writes the index to `out_index`
+- -1 if not found or if inputs are invalid
+*/
+int csv_header_index_find(const CsvHeaderIndex *idx, const char *name, size_t *out_index);
+
+/*
+Resolve `n` names at once into `out_indices`; a missing name yields
+CSV_NO_COLUMN at its position.
+
+Returns:
+- 0 if every name was found
+- 1 if at least one name is missing (`out_indices` is still fully written)
+- -1 on invalid input
+*/
+int csv_header_index_resolve(const CsvHeaderIndex *idx, const char *const *names, size_t n,
+                             size_t *out_indices);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,103 @@
+#ifndef CSVSTAT_ALLOC_H
+#define CSVSTAT_ALLOC_H
+
+/*
+Allocation accounting (--alloc-stats).
+
+Every heap allocation of the library goes through `csvstat_malloc()`,
+`csvstat_calloc()`, `csvstat_realloc()` and `csvstat_free()`, tagged with
+the structure it belongs to (an AllocSite). Each block carries a small
+header with its size and site, so frees and reallocs are attributed without
+a lookup. Per site the tracker counts allocations, reallocs (growth events),
+frees, bytes requested, live bytes and their high-water mark; the process
+high-water mark is kept across all sites.
+
+Steady state: after its warm-up a thread calls `csvstat_alloc_steady(1)`,
+and from then on every allocation or realloc it makes is also counted as a
+steady-state allocation. A scan that reuses its buffers reports zero; a
+per-row allocation shows up as roughly one per row.
+
+Counters are relaxed atomics, so tracking is safe from worker and decoder
+threads. Memory from these functions must only be released with
+`csvstat_free()` (and never by the C library's free()).
+*/
+
+#include <stdio.h>
+#include <stddef.h>
+
+#define ALLOC_WARMUP_ROWS 10000  // default --alloc-warmup (rows per thread)
+
+typedef enum {
+    ALLOC_LINE_READER = 0,  // line buffer and read block
+    ALLOC_CSV_PARSER,       // field pointer scratch
+    ALLOC_CSV_BATCH,        // csv_split_batch() spans and offsets
+    ALLOC_CSV_HEADER,       // header name index
+    ALLOC_SCAN,             // scan blocks, cell scratch, parallel workers
+    ALLOC_EXPR,             // compiled programs and evaluator scratch
+    ALLOC_ZONEMAP,          // zone-map blocks and column bounds
+    ALLOC_NUMPARSE,         // copies of over-long numeric cells
+    ALLOC_SOURCE,           // decompression buffers and frames
+    ALLOC_CHUNKER,          // chunk planning buffers
+    ALLOC_PROGRESS,         // progress slots
+    ALLOC_CHECKPOINT,       // checkpoint file paths
+    ALLOC_TRACE,            // --trace rings
+    ALLOC_DIAG,             // --reject-file buffers
+    ALLOC_CORR,             // --corr matrix and row blocks
+    ALLOC_NSITES,
+} AllocSite;
+
+/*
+Counters of one site (or of all sites, see `csvstat_alloc_total()`).
+*/
+typedef struct {
+    size_t allocs;          // malloc/calloc (and realloc of NULL)
+    size_t reallocs;        // reallocs of an existing block
+    size_t frees;
+    size_t steady;          // allocs + reallocs made in steady state
+    size_t bytes_total;     // bytes requested, including realloc growth
+    size_t bytes_live;
+    size_t bytes_peak;      // high-water mark of bytes_live
+} AllocCounters;
+
+void *csvstat_malloc(AllocSite site, size_t n);
+void *csvstat_calloc(AllocSite site, size_t count, size_t size);
+
+/*
+Resize `p` (NULL allocates for `site`). The block keeps the site it was
+allocated for. On failure NULL is returned and `p` is left untouched.
+*/
+void *csvstat_realloc(AllocSite site, void *p, size_t n);
+
+/*
+Release a block from the functions above. NULL is ignored.
+*/
+void csvstat_free(void *p);
+
+/*
+Mark the calling thread as past (1) or in (0) its warm-up.
+*/
+void csvstat_alloc_steady(int on);
+
+/*
+Snapshot the counters of `site`.
+*/
+void csvstat_alloc_site(AllocSite site, AllocCounters *out);
+
+/*
+Sum of all sites; `bytes_peak` is the process-wide high-water mark.
+*/
+void csvstat_alloc_total(AllocCounters *out);
+
+/*
+Short name of `site` ("line_reader", "csv_batch", ...).
+*/
+const char *csvstat_alloc_site_name(AllocSite site);
+
+/*
+Print the per-site table and the totals to `out`. `warmup_rows` is the
+warm-up used for the steady-state count and `rows` the number of data rows
+scanned.
+*/
+void csvstat_alloc_report(FILE *out, size_t warmup_rows, size_t rows);
+
+#endif
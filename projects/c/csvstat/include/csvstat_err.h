@@ -17,6 +17,9 @@ typedef enum {
     // Memory
     CSVSTAT_ENOMEM = 6,
 
+    // Results
+    CSVSTAT_EOVERFLOW = 7,  // --decimal: an exact sum exceeds 128 bits
+
     // Internal / unexpected
     CSVSTAT_EINTERNAL = 10,
 } CsvStatErr;
@@ -0,0 +1,97 @@
+#ifndef DECIMAL_H
+#define DECIMAL_H
+
+/*
+Decimal: exact fixed-point statistics for money-like columns (--decimal).
+
+With a scale s, a cell is read as an integer number of 10^-s units: "12.34"
+at scale 2 is 1234, "-0.5" is -50. Parsing is one pass over the digits, with
+no strtod and no rounding:
+- optional sign, digits with an optional '.', an optional exponent
+  ("1.5e3"), then trailing spaces/tabs only (as for parse_double_strict())
+- a number with nonzero digits beyond the scale, or beyond int64 once
+  scaled, does not fit: it is rejected as inexact rather than rounded
+
+DecStats adds the values into a 128-bit integer and their squares into an
+unsigned 128-bit one, both overflow-checked, and keeps min/max as int64.
+Nothing is converted until output: min, max, sum and mean print as exact
+decimals (the mean rounded half to even, DECIMAL_MEAN_DIGITS places past
+the scale). Only the standard deviation, irrational in general, is
+computed in long double, from the exact integer sums.
+
+This module owns no heap memory. DecStats is a plain value type.
+*/
+
+#include "stats.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define DECIMAL_MAX_SCALE 18    // 10^18 still fits in int64
+#define DECIMAL_MEAN_DIGITS 6   // mean digits printed past the scale
+
+typedef __int128 dec128;
+typedef unsigned __int128 udec128;
+
+typedef struct {
+    size_t n;
+    int64_t min;
+    int64_t max;
+    dec128 sum;     // sum of the scaled values
+    udec128 sumsq;  // sum of their squares
+} DecStats;
+
+/*
+Parse `s[0..len)` as a decimal scaled by 10^scale.
+
+Returns:
+- 0 on success and writes to *out
+- -1 if the text is not a number
+- -2 if it is a number that does not fit `scale` exactly
+*/
+int decimal_parse(const char *s, size_t len, unsigned scale, int64_t *out);
+
+void decimal_stats_init(DecStats *d);
+
+/*
+Add one scaled value.
+
+Returns 0 on success, -1 if the sum or the sum of squares would overflow
+(the state is then unchanged).
+*/
+int decimal_stats_push(DecStats *d, int64_t v);
+
+/*
+Merge the values summarized by `src` into `dst`.
+
+Returns 0 on success, -1 on overflow (`dst` is then unchanged).
+*/
+int decimal_stats_merge(DecStats *dst, const DecStats *src);
+
+/*
+The mean scaled by 10^(scale + DECIMAL_MEAN_DIGITS), rounded half to even.
+
+Returns 0 on success, -1 if there are no values.
+*/
+int decimal_stats_mean(const DecStats *d, dec128 *out);
+
+/*
+The sample standard deviation in units (not scaled).
+
+Returns 0 on success, -1 if there are fewer than two values.
+*/
+int decimal_stats_stddev(const DecStats *d, unsigned scale, double *out);
+
+/*
+An approximate Stats with the same n, min, max, mean and m2, for code that
+only needs doubles (progress lines).
+*/
+void decimal_stats_to_stats(const DecStats *d, unsigned scale, Stats *out);
+
+/*
+Write the scaled integer `v` with `scale` fractional digits ("-0.05").
+*/
+void decimal_print(FILE *out, dec128 v, unsigned scale);
+
+#endif
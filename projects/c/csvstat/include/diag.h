@@ -0,0 +1,197 @@
+#ifndef DIAG_H
+#define DIAG_H
+
+/*
+Diag: what happened to the rows that did not yield a value, collected
+without printing anything per row.
+
+Each ScanState owns a Diag. A rejected row costs a counter increment and a
+step of a small random generator; its text is copied only while it is one
+of the first DIAG_FIRST rejects or when it is drawn into a reservoir sample
+of DIAG_SAMPLE rejects from the rest (uniform over all of them, Vitter's
+algorithm R). `diag_merge()` combines per-thread Diags in file order, so
+the examples shown do not depend on scheduling. `diag_report()` prints the
+counts per kind and the examples once, at the end:
+
+  csvstat: 300412 rejected rows (invalid_number: 299977, missing_column: 435)
+    Row 1: invalid number 'n/a'
+    Row 4: invalid number '-'
+    ...
+    sample of the other 300407:
+    Row 88211: invalid number '12x'
+    ...
+
+With --reject-file the rejected rows themselves are also written, as CSV
+with the input's header, through a DiagRejects shared by every state. Each
+state collects rows in a DIAG_REJECT_BUF buffer and writes it whole, so
+the file costs one write() per buffer, not per row. Rows rejected after a
+batched --expr evaluation are counted but not written; their text is gone
+by then.
+
+Under --checkpoint the Diag is saved with the rest of the scan state, and
+the reject file is synced first so its length can be saved too; a resumed
+scan restores the Diag and reopens the file at that length
+(`diag_rejects_resume()`), so both come out as in an uninterrupted run.
+*/
+
+#include "csv.h"
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#define DIAG_FIRST 5                // first rejects kept as examples
+#define DIAG_SAMPLE 5               // reservoir sample of the rest
+#define DIAG_TEXT_MAX 80            // bytes of a rejected cell kept per example
+#define DIAG_REJECT_BUF (1u << 18)  // per-state --reject-file buffer (bytes)
+
+typedef enum {
+    DIAG_INVALID_NUMBER = 0,    // stats cell is not a number
+    DIAG_MISSING_COLUMN,        // row has fewer fields than needed
+    DIAG_NOT_FINITE,            // --expr result is NaN or infinite
+    DIAG_NOT_EXACT,             // --decimal: number does not fit the scale
+    DIAG_NKINDS,
+} DiagKind;
+
+/*
+One rejected row kept as an example.
+*/
+typedef struct {
+    DiagKind kind;
+    size_t chunk;               // parallel range, or SCAN_NO_CHUNK ((size_t)-1)
+    size_t row_no;
+    size_t len;                 // full length of the cell (text may be cut)
+    char text[DIAG_TEXT_MAX];   // the cell, not NUL-terminated
+} DiagExample;
+
+/*
+--reject-file: the output file, shared by every state of a scan. Writes are
+serialized by `lock`; the first write error is kept and reported by
+`diag_rejects_close()`, and nothing more is written after it.
+*/
+typedef struct {
+    FILE *out;
+    pthread_mutex_t lock;
+    char delim;                 // dialect used to re-encode split rows
+    int quotes;
+    int failed;
+    int saved_errno;
+} DiagRejects;
+
+typedef struct {
+    size_t count[DIAG_NKINDS];
+    size_t total;
+
+    DiagExample first[DIAG_FIRST];
+    size_t nfirst;
+
+    DiagExample sample[DIAG_SAMPLE];
+    size_t nsample;             // min(DIAG_SAMPLE, sampled)
+    size_t sampled;             // rejects after the first DIAG_FIRST
+    uint64_t rng;
+
+    DiagRejects *rejects;       // borrowed, or NULL without --reject-file
+    char *rbuf;                 // owned: rows waiting for the next write
+    size_t rlen;
+    size_t rcap;
+} Diag;
+
+/*
+Initialize `d`. `seed` selects the sample (states of one scan use distinct
+seeds); `rejects` may be NULL.
+*/
+void diag_init(Diag *d, DiagRejects *rejects, uint64_t seed);
+
+/*
+Release the reject buffer. Rows not yet flushed are dropped; call
+`diag_flush()` first. Safe to call multiple times on the same object.
+*/
+void diag_destroy(Diag *d);
+
+/*
+Replace the counts, examples and sampler state of `d` with those of `saved`
+(e.g. read from a checkpoint). The reject buffer and file of `d` are kept.
+*/
+void diag_restore(Diag *d, const Diag *saved);
+
+/*
+Count a rejected row and consider it as an example. `text[0..len)` is the
+offending cell (NULL for kinds without one). `chunk` and `row_no` identify
+the row as in the scan's warnings.
+*/
+void diag_add(Diag *d, DiagKind kind, size_t chunk, size_t row_no, const char *text, size_t len);
+
+/*
+--reject-file: queue one raw row `row[0..len)`, copied verbatim except for
+trailing line breaks and blanks, which are replaced by one '\n'.
+*/
+void diag_reject_raw(Diag *d, const char *row, size_t len);
+
+/*
+--reject-file: queue a row split in place by `csv_split_n()`: the fields of
+`row`, then the parser's unsplit remainder `rest` (or NULL) as it stands.
+Fields are quoted again where the dialect needs it.
+*/
+void diag_reject_fields(Diag *d, const CsvRowView *row, const char *rest);
+
+/*
+Write the queued rows. Errors are kept in the DiagRejects.
+*/
+void diag_flush(Diag *d);
+
+/*
+Add the counts and examples of `src` to `dst`; `src` covers the rows after
+those of `dst`. Reject rows are not moved (flush `src` instead).
+*/
+void diag_merge(Diag *dst, const Diag *src);
+
+/*
+Print the counts and examples to `out`; nothing if no row was rejected.
+`col_name` names the stats column in missing-column messages (NULL when
+the value is an expression).
+*/
+void diag_report(FILE *out, const Diag *d, const char *col_name);
+
+/*
+Name of `kind` as printed in the report ("invalid_number", ...).
+*/
+const char *diag_kind_name(DiagKind kind);
+
+/*
+Create `path` for --reject-file and write `header` as its first row.
+
+Returns 0 on success, -1 on I/O error (errno is set).
+*/
+int diag_rejects_open(DiagRejects *rj, const char *path, const CsvRowView *header,
+                      char delim, int quotes);
+
+/*
+Reopen an existing --reject-file at `path` to continue a resumed scan: the
+file is truncated to `offset` (its length when the checkpoint was taken, see
+`diag_rejects_sync()`) and further rows are appended.
+
+Returns:
+- 0 on success
+- 1 if `path` does not exist or is shorter than `offset` (start over)
+- -1 on I/O error (errno is set)
+*/
+int diag_rejects_resume(DiagRejects *rj, const char *path, unsigned long long offset,
+                        char delim, int quotes);
+
+/*
+Write out everything flushed to `rj` so far, fsync it and store the file
+length in `*offset`. Flush the states first (`diag_flush()`).
+
+Returns 0 on success, -1 if a write failed (errno is set).
+*/
+int diag_rejects_sync(DiagRejects *rj, unsigned long long *offset);
+
+/*
+Close the file. Call once every state has been flushed.
+
+Returns 0 on success, -1 if any write failed (errno is set).
+*/
+int diag_rejects_close(DiagRejects *rj);
+
+#endif
@@ -0,0 +1,201 @@
+#ifndef EXPR_H
+#define EXPR_H
+
+/*
+Expr: a small expression language compiled once into flat bytecode and then
+evaluated against parsed CSV rows.
+
+Language
+--------
+- Numbers:      42, 3.5, 1e3
+- Strings:      "apple" or 'apple' (only as an operand of == / != against a column)
+- Columns:      bare names (price, unit_qty) or `quoted name` in backticks
+- Arithmetic:   + - * / and unary -
+- Comparison:   < <= > >= == !=
+- Logic:        && || ! (short-circuit; results are 1 or 0)
+- Conditional:  cond ? a : b
+- Functions:    abs(x) log(x) sqrt(x) exp(x)
+- Grouping:     ( ... )
+
+Column names are resolved against the header index once, at compile time,
+and stored as column indices. At evaluation time only the referenced cells are
+converted, lazily and at most once per row.
+
+Missing cells and cells that are not valid numbers evaluate to NaN, so every
+ordered comparison against them is false. For string comparisons a missing
+cell compares as "".
+
+Ownership / Lifetime
+--------------------
+- ExprProgram owns its bytecode, string constants and column tables. It is
+  immutable after `expr_compile()` and may be shared by several evaluators.
+- ExprEval owns the per-evaluation scratch (value stack and cell cache).
+- ExprBatch owns the column-major input batch, registers and results used by
+  vector-mode programs.
+
+Evaluation modes
+----------------
+- EXPR_SCALAR programs run one row at a time (`expr_eval_row()`), with
+  short-circuit jumps. Used for row filters.
+- EXPR_VECTOR programs run over a batch of rows stored column by column
+  (`expr_batch_eval()`), one tight loop per opcode. Used for derived numeric
+  columns. String comparisons are rejected in this mode.
+*/
+
+#include "csv.h"
+
+#include <stddef.h>
+
+#define EXPR_BATCH 1024  // rows per vector-mode batch
+
+typedef enum {
+    EXPR_SCALAR,
+    EXPR_VECTOR,
+} ExprMode;
+
+typedef struct {
+    unsigned char op;  // ExprOp (see expr.c)
+    unsigned arg;      // jump target or column slot
+    unsigned arg2;     // string constant index (string comparisons)
+    double imm;        // constant operand
+} ExprInsn;
+
+/*
+A per-column interval implied by the top-level `&&` chain of a filter, e.g.
+`price > 1000 && qty <= 5`. Bounds are inclusive and conservative: every row
+that can pass the filter has its cell inside [lo, hi].
+*/
+typedef struct {
+    size_t col;
+    double lo;
+    double hi;
+} ExprBound;
+
+typedef struct {
+    ExprInsn *code;     // owned bytecode
+    size_t ncode;
+
+    char **strs;        // owned string constants
+    size_t nstrs;
+
+    size_t *slot_cols;  // owned: column index for each slot
+    size_t nslots;
+
+    ExprBound *bounds;  // owned: column intervals implied by the filter
+    size_t nbounds;
+
+    size_t max_stack;   // evaluation stack depth required
+    size_t max_col;     // 1 + highest referenced column index (0 if none)
+    ExprMode mode;
+} ExprProgram;
+
+typedef struct {
+    double *stack;          // owned, max_stack entries
+    double *vals;           // owned, per-slot cached numeric value
+    unsigned char *have;    // owned, per-slot "cached for this row" flag
+    size_t nslots;
+} ExprEval;
+
+typedef struct {
+    double *cols;          // owned, nslots x EXPR_BATCH input values (column-major)
+    double *regs;          // owned, depth x EXPR_BATCH registers
+    const double **src;    // owned, depth operand pointers
+    double *out;           // owned, EXPR_BATCH results
+    size_t nslots;
+    size_t depth;
+    size_t n;              // rows currently buffered
+} ExprBatch;
+
+/*
+Compile `src` against the header index for the given evaluation mode.
+
+On failure a human-readable message is written to `err` (if `errcap > 0`).
+
+Returns:
+- 0 on success
+- -1 on syntax error, unknown column, type error or allocation failure
+*/
+int expr_compile(ExprProgram *prog, const char *src, const CsvHeaderIndex *header,
+                 ExprMode mode, char *err, size_t errcap);
+
+/*
+Destroy a compiled program.
+
+Safe to call multiple times on the same object.
+*/
+void expr_destroy(ExprProgram *prog);
+
+/*
+Initialize evaluation scratch for `prog`.
+
+Returns 0 on success, -1 on allocation failure or invalid input.
+*/
+int expr_eval_init(ExprEval *ev, const ExprProgram *prog);
+
+/*
+Destroy evaluation scratch.
+
+Safe to call multiple times on the same object.
+*/
+void expr_eval_destroy(ExprEval *ev);
+
+/*
+Evaluate `prog` against one row.
+
+`row` must contain at least `prog->max_col` fields or be a complete row;
+cells past `row->nfields` are treated as missing.
+
+Returns 0 on success and writes the result to `out`, -1 on invalid input.
+*/
+int expr_eval_row(const ExprProgram *prog, ExprEval *ev, const CsvRowView *row, double *out);
+
+/*
+Evaluate `prog` as a predicate: return 1 if the row passes, 0 if it does
+not (including on error). A result passes when it is non-zero and not NaN.
+*/
+int expr_test_row(const ExprProgram *prog, ExprEval *ev, const CsvRowView *row);
+
+/*
+Initialize batch buffers for a vector-mode program.
+
+Returns 0 on success, -1 on allocation failure or if `prog` is not EXPR_VECTOR.
+*/
+int expr_batch_init(ExprBatch *b, const ExprProgram *prog);
+
+/*
+Destroy batch buffers.
+
+Safe to call multiple times on the same object.
+*/
+void expr_batch_destroy(ExprBatch *b);
+
+/*
+Append one row to the batch: each referenced cell is parsed with
+`parse_double_strict()` into its column array (NaN if missing or invalid).
+
+The caller evaluates and resets the batch (`b->n = 0`) once `b->n` reaches
+EXPR_BATCH.
+
+Returns 0 on success, -1 if the batch is full or inputs are invalid.
+*/
+int expr_batch_add_row(ExprBatch *b, const ExprProgram *prog, const CsvRowView *row);
+
+/*
+Evaluate the buffered rows and write `b->n` results to `b->out`.
+
+Returns 0 on success, -1 on invalid input.
+*/
+int expr_batch_eval(ExprBatch *b, const ExprProgram *prog);
+
+/*
+Evaluate a vector-mode program over caller-provided column arrays.
+
+`cols[slot]` must point to `n` values for column `prog->slot_cols[slot]`;
+`n` must not exceed EXPR_BATCH. `b` provides the registers.
+
+Returns 0 on success and writes `n` results to `out`, -1 on invalid input.
+*/
+int expr_eval_columns(const ExprProgram *prog, ExprBatch *b,
+                      const double *const *cols, size_t n, double *out);
+
+#endif
@@ -30,6 +30,23 @@ Return code convention
 - 1  : EOF reached, no line was read
 - -1 : error (I/O error or allocation failure)
 
+Quoted records
+--------------
+With `line_reader_set_quotes(lr, 1)`, a '\n' that appears after an odd number
+of '"' characters in the current line does not end it: the returned "line" is
+then a whole RFC 4180 record whose quoted fields contain embedded newlines.
+
+Read-ahead
+----------
+The reader pulls input in blocks of LINE_READER_BLOCK bytes and searches
+them with memchr(), so the underlying stream is usually ahead of the last
+returned line. `line_reader_tell()` still reports the logical offset, and
+`line_reader_read_raw()` hands out the buffered bytes before reading more,
+so callers can switch from lines to raw blocks mid-stream.
+
+Input can be a FILE* or a Source (see source.h); a Source is how csvstat
+reads compressed files.
+
 Newline normalization
 ---------------------
 `line_reader_next()` strips:
@@ -37,15 +54,28 @@ Newline normalization
 - optional trailing '\r' (Windows CRLF)
 */
 
+#include "source.h"
+
 #include <stdio.h>   // FILE
 #include <stddef.h>  // size_t
 
+#define LINE_READER_BLOCK (1u << 16)  // read-ahead block size (bytes)
+
 typedef struct LineReader {
-    FILE    *fp;      // input stream (NOT owned; caller manages fopen/fclose)
+    FILE    *fp;      // input stream (NOT owned; caller manages fopen/fclose), or NULL
+    Source  *src;     // input source (NOT owned; caller manages source_close), or NULL
     char    *buf;     // owned internal buffer
     size_t  len;      // current line length (after stripping newline/CR)
     size_t  cap;      // buffer capacity in bytes
+    char    *blk;     // owned read-ahead block (LINE_READER_BLOCK bytes)
+    size_t  blen;     // bytes in blk
+    size_t  bpos;     // next unread byte in blk
     int     saw_eof;  // sticky EOF: once EOF is seen, further reads return EOF
+    int     quotes;   // 1: newlines inside "..." do not end a line
+    int     hold;     // 1: keep an unterminated last line until it is completed
+    size_t  held;     // bytes of a held partial line (kept in buf)
+    int     held_quotes; // quote parity of the held bytes
+    unsigned long long pos; // offset of the next byte not yet handed out
 } LineReader;
 
 
@@ -70,6 +100,18 @@ Returns:
 */
 int line_reader_init(LineReader *lr, FILE *fp);
 
+/*
+Initialize a LineReader bound to an open Source.
+
+The caller retains ownership of `src` and must eventually call
+`source_close()`. Offsets reported by the reader are decoded offsets.
+
+Returns:
+- 0 on success
+- -1 on error (invalid input or allocation failure)
+*/
+int line_reader_init_source(LineReader *lr, Source *src);
+
 /*
 Destroy the LineReader and release its owned resources.
 
@@ -96,4 +138,59 @@ Lifetime:
 */
 int line_reader_next(LineReader *lr, const char **out_line, size_t *out_len);
 
+/*
+Read up to `cap` raw bytes following the last returned line.
+
+Buffered read-ahead bytes are returned first; after that this reads the
+stream directly. Mixing with `line_reader_next()` is allowed: lines resume
+after the last raw byte.
+
+Returns:
+- 0 on success; `*got` is the number of bytes read, 0 only at end of input
+- -1 on error (invalid input or I/O error)
+*/
+int line_reader_read_raw(LineReader *lr, char *dst, size_t cap, size_t *got);
+
+/*
+Enable or disable (default) quote-aware line splitting (see "Quoted records").
+*/
+void line_reader_set_quotes(LineReader *lr, int enabled);
+
+/*
+Enable or disable (default) holding of partial lines, for files that are
+still being written.
+
+When enabled, a last line without its '\n' (or still inside a quoted field)
+is not returned at EOF: `line_reader_next()` returns 1 and keeps the bytes.
+EOF is not sticky, so a later call reads whatever was appended since and
+completes the line. `line_reader_tell()` excludes held bytes.
+*/
+void line_reader_set_hold_partial(LineReader *lr, int enabled);
+
+/*
+Report the byte offset of the next unread line.
+
+This is the offset just past the newline of the last line returned by
+`line_reader_next()` (or the stream position at init/seek time). The reader
+counts consumed bytes itself, so this is O(1) and works on pipes too.
+
+Returns:
+- 0 on success and writes the offset to `out_off`
+- -1 on invalid input
+*/
+int line_reader_tell(LineReader *lr, unsigned long long *out_off);
+
+/*
+Reposition the reader so the next `line_reader_next()` starts at `off`.
+
+`off` should be a line start previously obtained from `line_reader_tell()`.
+Clears the sticky EOF flag.
+
+Returns:
+- 0 on success
+- -1 on error (invalid input or non-seekable stream; a compressed Source
+  only seeks forward)
+*/
+int line_reader_seek(LineReader *lr, unsigned long long off);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,45 @@
+#ifndef NUMPARSE_H
+#define NUMPARSE_H
+
+/*
+Strict numeric parsing shared by the CLI and by modules that need to
+interpret CSV cells as numbers (zone maps, filters, expressions).
+
+Rules
+-----
+- rejects empty strings
+- uses strtod
+- allows trailing spaces/tabs only
+- rejects junk suffix (e.g., "12abc")
+- rejects overflow/underflow (ERANGE) and NaN / +/-Inf
+*/
+
+#include <stddef.h>
+
+/*
+Parse a NUL-terminated string as a finite double.
+
+Returns:
+- 0 on success and writes to *out
+- -1 on failure (*out is left unchanged)
+*/
+int parse_double_strict(const char *s, double *out);
+
+/*
+Parse `s[0..len)` (not necessarily NUL-terminated) as a finite double, with
+the same rules and results as `parse_double_strict()`.
+
+Plain decimals with at most 19 significant digits whose value is exactly
+representable after one scaling by a power of ten (mantissa <= 2^53,
+|exponent| <= 22) are converted directly; the single multiplication or
+division is correctly rounded, so the result equals strtod's. Anything else
+(long mantissas, large exponents, hex, "inf"/"nan", ...) falls back to
+strtod on a bounded copy.
+
+Returns:
+- 0 on success and writes to *out
+- -1 on failure (*out is left unchanged)
+*/
+int parse_double_n(const char *s, size_t len, double *out);
+
+#endif
@@ -0,0 +1,192 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+/*
+Profile: where a scan's time goes (--profile).
+
+The scan is divided into phases: reading input, splitting records, --where
+and --expr evaluation, number parsing and accumulation. Timers are the CPU
+timestamp counter on x86-64 (`rdtsc`, converted to seconds against the
+monotonic clock at report time) and the monotonic clock elsewhere; neither
+is a system call.
+
+Per-row phases are sampled: on the line path runs of PROFILE_ROW_BURST
+consecutive rows, one row in PROFILE_SAMPLE_EVERY overall (a run keeps the
+timed code warm, so a lone cold row does not inflate the estimate); on the
+batch path every row of one batch in PROFILE_SAMPLE_EVERY. Sampled time is
+scaled by units seen / units sampled, which is unbiased because rows are
+picked regardless of which phases they reach. Per-block phases (block
+reads, batch splits, batched --expr evaluation) are timed every time. The
+sampling decision is made once per row or batch into a local flag, so
+untimed work pays one predictable branch per phase.
+
+The instrumentation only exists when built with CSVSTAT_PROFILE (`make
+PROFILE=1`, the default). Without it `PROFILE_ON()` is the constant 0 and
+the compiler removes every timing site.
+
+A Profile lives in each ScanState; parallel results are summed with
+`profile_merge()`.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#if defined(CSVSTAT_PROFILE) && defined(__x86_64__) && defined(__GNUC__)
+#include <x86intrin.h>
+#define PROFILE_HAVE_TSC 1
+#endif
+
+#define PROFILE_SAMPLE_EVERY 256  // one timed row (or batch) in this many
+#define PROFILE_ROW_BURST 16      // consecutive timed rows on the line path
+#define PROFILE_SAMPLE_CAP_US 50  // longest believable sampled call
+
+typedef enum {
+    PROF_READ = 0,   // line_reader_next() / block reads
+    PROF_SPLIT,      // csv_split_n() / csv_split_batch()
+    PROF_EVAL,       // --where and --expr
+    PROF_PARSE,      // number parsing
+    PROF_ACCUM,      // range check and stats_push()
+    PROF_NPHASES,
+} ProfPhase;
+
+typedef struct {
+    int on;                          // enabled for this scan
+    int timed;                       // the current line is sampled (see scan_row())
+    uint32_t countdown;              // rows or batches until the next sample
+    uint32_t burst;                  // timed rows left in the current run
+    uint64_t cap;                    // longer samples were interrupted: dropped
+    uint64_t seen;                   // rows or batches passed to profile_sample()
+    uint64_t sampled;                // ... of which were timed
+
+    uint64_t ticks[PROF_NPHASES];    // per-block phases: ticks, bytes and calls
+    uint64_t bytes[PROF_NPHASES];
+    uint64_t calls[PROF_NPHASES];
+    uint64_t sticks[PROF_NPHASES];   // sampled per-row phases: the same
+    uint64_t sbytes[PROF_NPHASES];
+    uint64_t scalls[PROF_NPHASES];
+} Profile;
+
+/*
+Wall-clock reference taken when profiling starts, used to convert ticks to
+seconds.
+*/
+typedef struct {
+    uint64_t ticks;
+    unsigned long long ns;
+    uint64_t overhead;  // ticks a timed call adds by itself (subtracted per call)
+} ProfileMark;
+
+#ifdef CSVSTAT_PROFILE
+#define PROFILE_ON(p) ((p)->on)
+#else
+#define PROFILE_ON(p) 0
+#endif
+
+/*
+Monotonic clock in nanoseconds (the fallback timer).
+*/
+unsigned long long profile_clock_ns(void);
+
+static inline uint64_t profile_now(void) {
+#ifdef PROFILE_HAVE_TSC
+    return (uint64_t)__rdtsc();
+#else
+    return (uint64_t)profile_clock_ns();
+#endif
+}
+
+/*
+Advance to the next row (`burst` = PROFILE_ROW_BURST) or batch (`burst` =
+1); returns 1 (and sets `timed`) if it is sampled. Only call with profiling
+on.
+*/
+static inline int profile_sample(Profile *p, uint32_t burst) {
+    p->seen++;
+    if (p->burst > 0) {
+        p->burst--;
+    } else if (--p->countdown != 0) {
+        p->timed = 0;
+        return 0;
+    } else {
+        p->countdown = PROFILE_SAMPLE_EVERY * burst;
+        p->burst = burst - 1;
+    }
+    p->sampled++;
+    p->timed = 1;
+    return 1;
+}
+
+/*
+Account a timed call of `ph` that started at `t0` (see `profile_now()`);
+`sampled` marks per-row phases. A sampled call longer than
+PROFILE_SAMPLE_CAP_US was almost certainly descheduled or interrupted and
+is dropped, since scaling would amplify it.
+*/
+static inline void profile_add(Profile *p, ProfPhase ph, uint64_t t0, uint64_t bytes,
+                               int sampled) {
+    uint64_t d = profile_now() - t0;
+    if (sampled) {
+        if (d > p->cap) return;
+        p->sticks[ph] += d;
+        p->sbytes[ph] += bytes;
+        p->scalls[ph]++;
+    } else {
+        p->ticks[ph] += d;
+        p->bytes[ph] += bytes;
+        p->calls[ph]++;
+    }
+}
+
+/*
+Time a phase when `timed` (a local flag: `profile_sample()` for per-row
+phases, `PROFILE_ON(p)` for per-block ones):
+
+    uint64_t t0 = 0;
+    PROFILE_START(timed, t0);
+    ... phase ...
+    PROFILE_STOP(timed, p, PROF_PARSE, t0, len, 1);
+
+`nbytes` is only evaluated when timed; `sampled` is 1 for per-row phases.
+*/
+#define PROFILE_START(timed, t0)                                                  \
+    do {                                                                          \
+        if (timed) (t0) = profile_now();                                          \
+    } while (0)
+
+#define PROFILE_STOP(timed, p, ph, t0, nbytes, sampled)                           \
+    do {                                                                          \
+        if (timed) profile_add((p), (ph), (t0), (uint64_t)(nbytes), (sampled));   \
+    } while (0)
+
+/*
+Reset `p` and set whether it is enabled. Enabling calibrates the timer
+once (about 0.2 ms).
+*/
+void profile_init(Profile *p, int on);
+
+/*
+Add the counters of `src` to `dst`.
+*/
+void profile_merge(Profile *dst, const Profile *src);
+
+/*
+Record the start of a profiled run and measure the timer's own cost.
+*/
+void profile_mark(ProfileMark *m);
+
+/*
+Name of the timer in use ("tsc" or "monotonic").
+*/
+const char *profile_timer_name(void);
+
+/*
+Print the phase table for `p` to `out`: estimated seconds per phase, their
+share of `nthreads` x the wall time since `start`, bytes, rows/s and MB/s,
+followed by the unattributed rest and the peak resident set size. `rows` is
+the number of data rows scanned.
+*/
+void profile_report(FILE *out, const Profile *p, const ProfileMark *start,
+                    size_t nthreads, size_t rows);
+
+#endif
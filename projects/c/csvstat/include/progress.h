@@ -0,0 +1,87 @@
+#ifndef PROGRESS_H
+#define PROGRESS_H
+
+/*
+Progress: periodic NDJSON snapshots of a running scan (--progress-interval).
+
+Scans report through their tick hook (see `scan_tick()`), so the clock is
+only read once every PROGRESS_SAMPLE_ROWS rows, never per row. When at least
+`interval` seconds have passed since the last line, one JSON object is
+written and flushed:
+
+  {"elapsed_s":12.004,"bytes":402653184,"rows":11534336,
+   "rows_per_s":960868.6,"mb_per_s":33.54,"n":11534330,
+   "min":0.5,"max":1800,"mean":434.26,"stddev":675.97,"done":false}
+
+`bytes` counts decoded input consumed by this run, `rows` the non-empty
+data rows seen (including rows restored from a checkpoint); the rates cover
+this run only. Statistics that are not defined yet are null. A last line
+with "done":true is written by `progress_finish()`.
+
+Parallel scans give every worker its own slot (indexed by `ScanState.chunk`)
+and a snapshot merges the slots in file order, so updates from worker
+threads only take a lock at tick time.
+*/
+
+#include "scan.h"
+#include "stats.h"
+
+#include <stdio.h>
+#include <stddef.h>
+#include <pthread.h>
+
+#define PROGRESS_SAMPLE_ROWS 16384  // rows between clock reads
+
+typedef struct {
+    Stats st;
+    ScanCounters sc;
+    unsigned long long bytes;     // bytes this slot has consumed
+} ProgressSlot;
+
+typedef struct {
+    FILE *out;                    // stderr or an owned file
+    int own_out;
+    unsigned long long interval_ns;
+    unsigned long long t0_ns;     // monotonic start time
+    unsigned long long next_ns;   // next line is due at this time
+    size_t base_rows;             // rows already counted when the run started
+
+    ProgressSlot *slots;          // owned, one per concurrent scanner
+    size_t nslots;
+    pthread_mutex_t lock;
+} Progress;
+
+/*
+Start reporting every `interval_s` seconds to `path` (NULL for stderr), for
+up to `nslots` concurrent scan states. `base_rows` is the row count the scan
+starts from (non-zero after resuming a checkpoint).
+
+Returns 0 on success, -1 on invalid input or failure to open `path` (errno
+is set).
+*/
+int progress_init(Progress *p, const char *path, double interval_s, size_t nslots,
+                  size_t base_rows);
+
+/*
+Close the output (if owned) and release the slots.
+
+Safe to call multiple times on the same object.
+*/
+void progress_destroy(Progress *p);
+
+/*
+Record the state of `ss`, which has consumed `bytes` bytes so far, and write
+a line if one is due. Thread-safe across distinct states.
+
+Returns 0 on success, -1 on a write error (errno is set).
+*/
+int progress_update(Progress *p, const ScanState *ss, unsigned long long bytes);
+
+/*
+Write the final line for the merged result `ss` after `bytes` bytes.
+
+Returns 0 on success, -1 on a write error (errno is set).
+*/
+int progress_finish(Progress *p, const ScanState *ss, unsigned long long bytes);
+
+#endif
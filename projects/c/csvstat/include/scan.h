@@ -0,0 +1,260 @@
+#ifndef SCAN_H
+#define SCAN_H
+
+/*
+Scan: the per-row work of csvstat (filter, split, parse, accumulate), shared
+by the sequential scan in main.c and by parallel byte-range workers.
+
+With --decimal, values are parsed by `decimal_parse()` into a DecStats
+instead; --expr and --range need doubles and are not available there.
+
+With --corr, every row that passes --where also feeds the listed columns to
+a CoMoment (two columns) or a CorrMatrix (more), independently of the stats
+value: a row missing any of them, or with a non-number there, is counted in
+`corr_skipped` and left out of the correlation only.
+
+Rows reach a state in one of two ways:
+- `scan_row()`: one line at a time from a LineReader (filters, derived
+  values, zone maps)
+- `scan_stream()`: blocks of raw text split by `csv_split_batch()` and
+  converted column by column; used when only a column's stats are needed
+  (see `scan_can_batch()`)
+
+A ScanConfig holds the read-only settings and compiled programs; it may be
+shared by any number of ScanStates. Each ScanState owns everything a single
+thread mutates: parser, evaluator scratch, Stats and counters. Parallel
+results are combined with `scan_merge()`.
+
+Ownership / Lifetime
+--------------------
+- ScanConfig borrows the compiled programs and the --reject-file sink; they
+  must outlive every state.
+- ScanState owns its parser, evaluator scratch and accumulators.
+- Row views produced while scanning point into the caller's line buffer and
+  are not retained past `scan_row()`.
+*/
+
+#include "csv.h"
+#include "stats.h"
+#include "decimal.h"
+#include "corr.h"
+#include "expr.h"
+#include "zonemap.h"
+#include "line_reader.h"
+#include "profile.h"
+#include "trace.h"
+#include "diag.h"
+#include "csvstat_err.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SCAN_NO_CHUNK ((size_t)-1)
+#define SCAN_BLOCK_SIZE (1u << 20)  // initial read block for scan_stream() (bytes)
+#define SCAN_BATCH_ROWS 1024        // rows per csv_split_batch() call
+
+typedef struct {
+    size_t col_index;           // stats column (unused when expr != NULL)
+    const char *col_name;       // for warnings
+    const ExprProgram *where;   // optional row filter (EXPR_SCALAR)
+    const ExprProgram *expr;    // optional derived value (EXPR_VECTOR)
+
+    int has_range;              // value-range filter (inclusive bounds)
+    double range_lo;
+    double range_hi;
+
+    DiagRejects *rejects;       // optional --reject-file, shared by every state
+    int quotes;                 // RFC 4180 quoted fields
+    char delim;                 // field delimiter
+    int split_all;              // split every field (needed to build zone maps)
+    int moments;                // also track m3/m4 (skewness, kurtosis)
+    StatsPrecision precision;   // accumulation mode (see stats.h)
+    int decimal;                // --decimal: exact DecStats instead of Stats
+    unsigned scale;             // --decimal scale
+    const size_t *corr_cols;    // --corr columns, or NULL
+    size_t ncorr;               // 0, or 2..CORR_MAX_COLS
+} ScanConfig;
+
+/*
+Per-scan row and value counters reported in the summary.
+*/
+typedef struct {
+    size_t rows_seen;       // rows we attempted to process (non-empty)
+    size_t numeric_ok;      // successfully parsed numbers
+    size_t numeric_bad;     // missing/invalid numbers
+    size_t missing_col;     // rows with fewer fields than header
+    size_t range_rejected;  // valid numbers outside --range
+    size_t where_rejected;  // rows rejected by --where
+    size_t corr_skipped;    // rows left out of --corr
+} ScanCounters;
+
+typedef struct ScanState ScanState;
+
+/*
+Periodic callback (see `scan_tick()`): `offset` is the byte offset of the
+next unread record, so state and offset together describe a resumable point.
+The callback may flush `ss->diag` (a checkpoint writes out the queued
+--reject-file rows). Returns 0 to continue, -1 to abort the scan with
+CSVSTAT_EIO (errno set).
+*/
+typedef int (*ScanTickFn)(void *ctx, ScanState *ss, unsigned long long offset);
+
+struct ScanState {
+    const ScanConfig *cfg;
+
+    CsvParser parser;
+    CsvRowView row;
+    ExprEval where_ev;
+    ExprBatch expr_batch;
+    size_t *expr_rows;      // owned: row number of each buffered --expr row
+
+    CsvBatch batch;         // batch path only (scan_can_batch())
+    double *vals;           // owned: the batch's parsed values, accumulated together
+    char *buf;              // owned read block
+    size_t bufcap;
+    char *cell;             // owned scratch for materializing one field
+    size_t cellcap;
+
+    Stats st;
+    DecStats dec;           // --decimal accumulator (st stays empty)
+    CoMoment co;            // --corr with two columns
+    CorrMatrix cm;          // --corr with more (flushed by scan_finish())
+    double corr_row[CORR_MAX_COLS]; // --corr: the current row's values
+    ScanCounters sc;
+    Diag diag;              // rejected rows: counts, examples, --reject-file
+
+    size_t row_no;          // data rows seen by this state (for warnings)
+    size_t chunk;           // chunk id for warnings, or SCAN_NO_CHUNK
+    size_t first_fields;    // fields split before the filter runs
+    size_t need_fields;     // fields needed once the row passes
+
+    ScanTickFn tick;        // optional periodic callback
+    void *tick_ctx;
+    size_t tick_every;      // rows between callbacks
+    size_t tick_row;        // row_no at the last callback
+    unsigned long long tick_origin; // offset this state started reading at
+
+    Profile prof;           // --profile phase timers (off unless enabled)
+    uint64_t trace_t0;      // --trace: start of the current run of rows (line path)
+    size_t trace_rows;      // rows in that run
+
+    int where_init;
+    int expr_init;
+    int batch_init;
+    int cm_init;
+};
+
+/*
+Return 1 for empty or whitespace-only lines (spaces and tabs), which are
+skipped everywhere: before the header and between data rows.
+*/
+int scan_is_empty_line(const char *s);
+
+/*
+Return 1 if rows for `cfg` can take the batch path (`scan_stream()`): no row
+filter, no derived value and no zone map to build.
+*/
+int scan_can_batch(const ScanConfig *cfg);
+
+/*
+Initialize a state for `cfg`.
+
+Returns 0 on success, -1 on allocation failure or invalid input.
+*/
+int scan_state_init(ScanState *ss, const ScanConfig *cfg);
+
+/*
+Destroy a state and release its owned memory.
+
+Safe to call multiple times on the same object.
+*/
+void scan_state_destroy(ScanState *ss);
+
+/*
+Process one non-empty data row. `line` is split in place.
+
+With profiling on, callers reading lines themselves call `profile_sample()`
+once per line before reading it, so the read and the row's phases are
+sampled together.
+
+If `zm` is not NULL the full row is also recorded in the zone map, with
+`row_off` as its byte offset (see `zonemap_add_row()`).
+
+Returns CSVSTAT_OK, or the error that should abort the scan.
+*/
+CsvStatErr scan_row(ScanState *ss, char *line, ZoneMap *zm, unsigned long long row_off);
+
+/*
+Read data rows from the current position of `lr` until EOF or until `limit`
+bytes have been consumed, and process them on the batch path. The reader's
+buffered bytes are used first (see `line_reader_read_raw()`), so this can
+follow a header read with `line_reader_next()`.
+
+The reader must be positioned at a record boundary; `limit` must end at one
+(or be ULLONG_MAX to read to EOF). Requires `scan_can_batch(ss->cfg)`.
+Call `scan_finish()` afterwards as for `scan_row()`.
+
+On I/O failure `*saved_errno` receives errno.
+
+Returns CSVSTAT_OK, or the error that should abort the scan.
+*/
+CsvStatErr scan_stream(ScanState *ss, LineReader *lr, unsigned long long limit, int *saved_errno);
+
+/*
+Call `ss->tick` if at least `tick_every` rows were seen since the last call.
+Buffered --expr rows are flushed first so the state passed to the callback
+covers every row before `offset`. `scan_stream()` calls this after each
+batch; line-by-line callers call it after each row (the check is one
+comparison).
+
+Returns CSVSTAT_OK, or the error that should abort the scan.
+*/
+CsvStatErr scan_tick(ScanState *ss, unsigned long long offset);
+
+/*
+Flush rows still buffered for batch evaluation, pending --corr matrix rows
+and queued --reject-file rows. Call once after the last row (or before
+reading the state, as --follow does).
+
+Returns CSVSTAT_OK, or the error that should abort the scan.
+*/
+CsvStatErr scan_finish(ScanState *ss);
+
+/*
+Add the counters, samples and rejected-row examples of `src` to `dst`.
+
+Returns 0 on success, -1 if the stats merge fails (with --decimal: the
+exact sums overflow).
+*/
+int scan_merge(ScanState *dst, const ScanState *src);
+
+/*
+The statistics of `ss` as a Stats: a copy of `ss->st`, or with --decimal a
+double approximation of the exact accumulator (see
+`decimal_stats_to_stats()`).
+*/
+void scan_stats(const ScanState *ss, Stats *out);
+
+/*
+Scan the data rows in [begin, end) of the file at `path` with `nthreads`
+workers and merge their results into `out` (an initialized state).
+
+Workers profile when `out->prof.on` is set; their profiles are merged into
+`out->prof`. If `out->tick` is set, every worker calls it with its own state (`chunk` is
+the worker index, `tick_origin` its first byte), concurrently, so the
+callback must be thread-safe.
+
+`begin` must be a record boundary (just past the header). The range is split
+with `csv_chunk_plan()`, so quoted fields spanning newlines never straddle
+two workers. Each worker opens its own Source. Results are merged in file
+order, so the output does not depend on thread scheduling.
+
+On I/O failure `*saved_errno` receives errno.
+
+Returns CSVSTAT_OK, or the first error reported by a worker.
+*/
+CsvStatErr scan_parallel(const ScanConfig *cfg, const char *path,
+                         unsigned long long begin, unsigned long long end,
+                         size_t nthreads, ScanState *out, int *saved_errno);
+
+#endif
@@ -0,0 +1,121 @@
+#ifndef SOURCE_H
+#define SOURCE_H
+
+/*
+Source: the byte stream csvstat parses.
+
+A Source is opened from a path, or "-" for stdin, and delivers bytes in
+large reads with no stdio in between. The format is detected from the first
+bytes of the input, not from its name:
+
+- plain text:  read() straight from the file descriptor
+- gzip (1f 8b): inflated by a background thread (needs zlib,
+  CSVSTAT_HAVE_ZLIB); concatenated members are decoded in sequence
+- zstd (28 b5 2f fd): decoded on background threads (needs libzstd,
+  CSVSTAT_HAVE_ZSTD). Multi-frame files whose frames record their size
+  (e.g. the seekable format, or `zstd -B`/`--rsyncable` style exports) have
+  their frames decoded in parallel; other files are streamed by one thread.
+
+Decoder threads write into a small ring of blocks that the reader drains in
+order, so decompression of the next blocks overlaps parsing of this one.
+
+Seeking
+-------
+Plain regular files seek in O(1). Compressed sources and stdin seek forward
+only, by reading and discarding; seeking backwards fails with ESPIPE.
+
+Pipes
+-----
+stdin is read with plain read() calls as large as the caller asks for.
+`source_set_pipe_size()` can grow the pipe buffer (Linux F_SETPIPE_SZ) so a
+bursty producer blocks less often. `wait_ns` accumulates the time reads
+spend blocked, which tells a slow producer apart from a slow consumer.
+
+Ownership / Lifetime
+--------------------
+- Source owns its file descriptor and decoder threads.
+- `source_close()` stops the decoder, joins its threads and closes the file;
+  it is safe to call twice.
+*/
+
+#include <stddef.h>
+
+typedef enum {
+    SOURCE_PLAIN = 0,
+    SOURCE_GZIP,
+    SOURCE_ZSTD,
+} SourceKind;
+
+typedef struct SourceDecoder SourceDecoder;  // opaque, see source.c
+
+typedef struct {
+    SourceKind kind;
+    int fd;                   // owned file descriptor, -1 when closed
+    unsigned long long pos;   // bytes delivered so far (decoded offset)
+    SourceDecoder *dec;       // owned decoder for compressed kinds, else NULL
+    int stream;               // 1: read-once input (stdin), no random access
+    unsigned char head[4];    // format-detection bytes of a plain stream
+    size_t head_len;          // valid bytes in head
+    size_t head_pos;          // head bytes already delivered
+    unsigned long long wait_ns; // time source_read() spent blocked on input
+} Source;
+
+/*
+Open `path` ("-" for stdin) and detect its format.
+
+`threads` bounds the decoder threads used for parallel zstd frames (0 or 1
+means one decoder thread).
+
+Returns:
+- 0 on success
+- -1 on failure; errno is preserved (ENOTSUP for a compressed format this
+  build does not support)
+*/
+int source_open(Source *src, const char *path, size_t threads);
+
+/*
+Close the source, stopping any decoder threads.
+
+Safe to call multiple times on the same object.
+*/
+void source_close(Source *src);
+
+/*
+Read up to `cap` bytes into `buf`.
+
+Returns:
+- 0 on success; `*got` is the number of bytes read, 0 only at end of input
+- -1 on I/O or decoding error (errno is set)
+*/
+int source_read(Source *src, char *buf, size_t cap, size_t *got);
+
+/*
+Move to decoded offset `off`.
+
+Returns 0 on success, -1 on failure (errno is set; ESPIPE when a compressed
+source would have to move backwards).
+*/
+int source_seek(Source *src, unsigned long long off);
+
+/*
+Return 1 if the source supports random access (plain regular files), so it
+can be split into byte ranges for parallel scans, else 0.
+*/
+int source_is_seekable(const Source *src);
+
+/*
+Ask the kernel for a pipe buffer of at least `bytes` when the source is a
+pipe.
+
+Returns 0 on success, -1 on failure (errno is set: ENOTSUP when the input
+is not a pipe or the platform cannot resize pipes, EPERM above the system
+limit for unprivileged users).
+*/
+int source_set_pipe_size(Source *src, size_t bytes);
+
+/*
+Short name of a source kind ("plain", "gzip", "zstd").
+*/
+const char *source_kind_name(SourceKind kind);
+
+#endif
@@ -9,13 +9,53 @@ Stats accumulator for streaming numeric data.
 This module owns no heap memory.
 `Stats` is a plain value-type object that is safe to allocate on the stack
 and safe to copy by value.
+
+Higher moments are opt-in (`stats_init_moments()`): the third and fourth
+central sums are then updated on every push with Pébay's one-pass formulas,
+which keep the numerical stability of Welford's update, and merged with
+their pairwise counterparts. Accumulators initialized with `stats_init()`
+leave m3/m4 at 0 and pay one predictable branch per push.
+
+Precision
+---------
+Welford's running mean takes one rounding per value; over billions of values
+of large magnitude the errors add up. `stats_set_precision()` selects a
+block mode instead: `stats_push_batch()` summarizes STATS_BLOCK values at a
+time (their sum, then the central sums around the block mean, in
+STATS_LANES independent lanes the compiler vectorizes) and merges each block
+into the running state. The running sum of values and m2 are carried as
+Neumaier-compensated pairs, and the mean is derived from the sum, so its
+error no longer grows with n. The modes differ in how a block is summed:
+- STATS_NEUMAIER: lane-wise Neumaier-compensated sums
+- STATS_PAIRWISE: pairwise (cascade) sums down to STATS_PAIRWISE_BASE values
+A single `stats_push()` is a block of one (a compensated Welford step). m3
+and m4 are merged as usual, without compensation; a sum that overflows
+fails the push even where Welford's mean would not.
 */
+#define STATS_BLOCK 1024         // values per block in the precision modes
+#define STATS_LANES 8            // independent partial sums per block
+#define STATS_PAIRWISE_BASE 64   // STATS_PAIRWISE: values summed directly
+
+typedef enum {
+    STATS_WELFORD = 0,           // per-value Welford update (default)
+    STATS_NEUMAIER,
+    STATS_PAIRWISE,
+    STATS_NPRECISIONS,
+} StatsPrecision;
+
 typedef struct {
     size_t n;     // number of valid samples
     double mean;  // running mean
     double m2;    // running sum of squares of differences from the mean (Welford)
+    double m3;    // sum of cubed differences from the mean (moments only)
+    double m4;    // sum of fourth powers of differences from the mean (moments only)
     double min;
     double max;
+    int moments;  // 1 if m3/m4 are tracked
+    int precision;  // StatsPrecision
+    double sum;     // sum of the values (precision modes only)
+    double sum_c;   // Neumaier compensation of sum
+    double m2_c;    // Neumaier compensation of m2
 } Stats;
 
 int stats_is_valid(const Stats *st);
@@ -40,6 +80,27 @@ After initialization:
 */
 void stats_init(Stats *s);
 
+/*
+Initialize a Stats accumulator that also tracks m3 and m4, for skewness and
+kurtosis. Pushes cost about three times as much as without.
+*/
+void stats_init_moments(Stats *s);
+
+/*
+Select the precision mode of an empty accumulator (see above).
+
+Returns 0 on success, -1 if `s` already holds samples or `p` is unknown.
+*/
+int stats_set_precision(Stats *s, StatsPrecision p);
+
+/*
+Name of `p` as accepted by --precision ("welford", "neumaier", "pairwise"),
+and the reverse lookup. `stats_precision_parse()` returns 0 on success, -1
+for an unknown name.
+*/
+const char *stats_precision_name(StatsPrecision p);
+int stats_precision_parse(const char *name, StatsPrecision *out);
+
 /*
 Add one sample to the accumulator.
 
@@ -49,6 +110,33 @@ Returns:
 */
 int stats_push(Stats *s, double x);
 
+/*
+Add `n` samples. In STATS_WELFORD mode this is `stats_push()` in a loop; in
+the precision modes the values are summarized in blocks (see above), so
+callers that already hold values in an array should prefer it.
+
+Returns:
+- 0 on success
+- -1 on invalid input or if the update would produce an invalid state; with
+  a precision mode nothing is added if any value is NaN or infinite
+*/
+int stats_push_batch(Stats *s, const double *x, size_t n);
+
+/*
+Merge the samples summarized by `src` into `dst` (Chan et al. pairwise update,
+extended to m3/m4 by Pébay when both track moments).
+
+Used to combine accumulators filled independently, e.g. by worker threads.
+The result equals pushing both sample sets into one accumulator, up to
+floating-point rounding.
+
+Returns:
+- 0 on success
+- -1 on invalid input, count overflow, non-finite result, or if two
+  non-empty accumulators differ in moments or precision mode
+*/
+int stats_merge(Stats *dst, const Stats *src);
+
 /*
 Derived quantities
 ------------------
@@ -56,6 +144,13 @@ Derived quantities
 Requirements:
 - `stats_mean`, `stats_min`, `stats_max` require `n > 0`
 - `stats_variance_sample`, `stats_stddev_sample` require `n >= 2`
+- skewness and kurtosis require moments, a nonzero variance, and `n >= 3`
+  (sample skewness) or `n >= 4` (sample kurtosis)
+
+Kurtosis is excess kurtosis (0 for a normal distribution). The population
+variants are the moment ratios g1 = sqrt(n) m3 / m2^1.5 and
+g2 = n m4 / m2^2 - 3; the sample variants are the adjusted G1 and G2 used by
+most statistics packages (e.g. Excel's SKEW and KURT).
 
 On failure:
 - output is set to 0
@@ -66,5 +161,9 @@ int stats_min(const Stats *s, double *out_min);
 int stats_max(const Stats *s, double *out_max);
 int stats_variance_sample(const Stats *s, double *out_var); // sample variance
 int stats_stddev_sample(const Stats *s, double *out_std);   // sqrt(sample variance)
+int stats_skewness_population(const Stats *s, double *out);  // g1
+int stats_skewness_sample(const Stats *s, double *out);      // G1
+int stats_kurtosis_population(const Stats *s, double *out);  // g2 (excess)
+int stats_kurtosis_sample(const Stats *s, double *out);      // G2 (excess)
 
 #endif
\ No newline at end of file
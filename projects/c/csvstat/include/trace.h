@@ -0,0 +1,89 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+/*
+Trace: a timeline of the scan's threads for chrome://tracing or Perfetto
+(--trace FILE).
+
+Work is recorded as spans ("complete" trace events) per block or batch,
+never per row: block reads, batch splits, number parsing, accumulation,
+--expr evaluation, runs of rows on the line path, parallel chunks and their
+merge, and decompression on decoder threads. Each thread appends to its own
+ring buffer of TRACE_RING_EVENTS spans, so recording takes no lock and the
+memory is bounded however long the scan runs; once a ring is full the
+oldest spans are overwritten and counted as dropped. `trace_close()` writes
+every ring to the file as trace-event JSON:
+
+  {"traceEvents":[
+    {"name":"thread_name","ph":"M","pid":4711,"tid":1,"args":{"name":"main"}},
+    {"name":"split","cat":"scan","ph":"X","ts":1520.114,"dur":38.902,
+     "pid":4711,"tid":1,"args":{"rows":1024,"bytes":65398}},
+    ...],
+   "displayTimeUnit":"ms","otherData":{"dropped_events":0}}
+
+Timestamps are microseconds since `trace_open()`. Tracing is process-wide;
+when it is off every recording site is one predictable branch.
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define TRACE_RING_EVENTS 16384  // spans kept per thread (most recent)
+
+extern int trace_enabled;
+
+#define TRACE_ON() (trace_enabled)
+
+/*
+Start recording and create `path` for the output.
+
+Returns 0 on success, -1 if the file cannot be created (errno is set).
+*/
+int trace_open(const char *path);
+
+/*
+Write the recorded spans, close the file and release the rings. Call once
+every traced thread has finished.
+
+Returns 0 on success, -1 on a write error (errno is set). Nothing happens
+if tracing is off.
+*/
+int trace_close(void);
+
+/*
+Name the calling thread in the trace ("main", "worker 2", "decoder").
+*/
+void trace_thread_name(const char *name);
+
+/*
+Monotonic clock in nanoseconds.
+*/
+uint64_t trace_now(void);
+
+/*
+Record a span `name` (a string literal) on the calling thread from `t0`
+(see `trace_now()`) to now, with optional row and byte counts (0 = none).
+*/
+void trace_span(const char *name, uint64_t t0, uint64_t rows, uint64_t bytes);
+
+/*
+Time a span when tracing is on:
+
+    uint64_t t0 = 0;
+    TRACE_START(t0);
+    ... work ...
+    TRACE_SPAN("split", t0, nrows, nbytes);
+
+`rows` and `bytes` are only evaluated when tracing is on.
+*/
+#define TRACE_START(t0)                                                           \
+    do {                                                                          \
+        if (TRACE_ON()) (t0) = trace_now();                                       \
+    } while (0)
+
+#define TRACE_SPAN(name, t0, rows, bytes)                                         \
+    do {                                                                          \
+        if (TRACE_ON()) trace_span((name), (t0), (uint64_t)(rows), (uint64_t)(bytes)); \
+    } while (0)
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef WATCH_H
+#define WATCH_H
+
+/*
+FileWatch: wait until a file changes (used by --follow).
+
+On Linux the watch is an inotify descriptor on the file, so a wait returns as
+soon as data is appended and costs nothing while the file is idle. Elsewhere
+(or if inotify is unavailable) a wait simply sleeps for its timeout and
+reports a possible change, i.e. the caller polls.
+
+The watch only says "look again"; callers still read to find out what (if
+anything) was appended.
+*/
+
+typedef struct {
+    int fd;  // inotify descriptor, or -1 when polling
+    int wd;  // watch on the file, or -1
+} FileWatch;
+
+/*
+Start watching `path` for writes, truncation and removal.
+
+Returns:
+- 0 on success (possibly in polling mode)
+- -1 on invalid input
+*/
+int file_watch_init(FileWatch *fw, const char *path);
+
+/*
+Release the watch.
+
+Safe to call multiple times on the same object.
+*/
+void file_watch_destroy(FileWatch *fw);
+
+/*
+Wait up to `timeout_ms` milliseconds for a change.
+
+Returns:
+- 1 if the file may have changed (always, after the timeout, when polling)
+- 0 on timeout or when interrupted by a signal
+- -1 on error (errno is set)
+*/
+int file_watch_wait(FileWatch *fw, int timeout_ms);
+
+#endif
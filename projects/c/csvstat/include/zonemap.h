@@ -0,0 +1,155 @@
+#ifndef ZONEMAP_H
+#define ZONEMAP_H
+
+/*
+ZoneMap: per-block summaries of every column, used to skip blocks of rows
+that cannot satisfy a value-range predicate.
+
+Model
+-----
+- Data rows (after the header) are grouped into blocks of `block_rows`
+  non-empty rows. A block covers the byte range [start, end) of the source.
+- For every block and every header column we record:
+  - min / max of the cells that parse as numbers
+  - count: number of numeric cells
+  - nulls: number of missing (short row) or non-numeric cells
+- The map is persisted as a binary sidecar file next to the data. It stores
+  the source size and modification time so a stale map is never used.
+
+A block may be skipped for a predicate `lo <= x <= hi` on column `c` when
+its numeric range for `c` does not intersect [lo, hi] (or it has no numeric
+cells at all).
+
+Ownership / Lifetime
+--------------------
+- ZoneMap owns its column names, block table and per-block column stats.
+- `zonemap_destroy()` releases everything and is safe to call twice.
+*/
+
+#include "csv.h"
+
+#include <stddef.h>
+
+typedef struct {
+    double min;    // meaningful only when count > 0
+    double max;    // meaningful only when count > 0
+    size_t count;  // numeric cells
+    size_t nulls;  // missing or non-numeric cells
+} ZoneColStats;
+
+typedef struct {
+    unsigned long long start;  // byte offset of the first row in the block
+    unsigned long long end;    // byte offset just past the last row
+    size_t rows;               // non-empty data rows in the block
+} ZoneBlock;
+
+/*
+Identity of the data file a zone map was built from.
+*/
+typedef struct {
+    unsigned long long size;
+    long long mtime;
+} ZoneSource;
+
+typedef struct {
+    size_t ncols;          // number of header columns
+    char **names;          // owned copies of the header names
+    size_t block_rows;     // target rows per block
+
+    ZoneBlock *blocks;     // owned block table
+    ZoneColStats *cols;    // owned, cap * ncols entries (block-major)
+    size_t nblocks;        // number of blocks (including an open one)
+    size_t cap;            // capacity of blocks (in blocks)
+
+    int open;              // 1 while the last block is still accumulating
+} ZoneMap;
+
+/*
+Return 1 if the ZoneMap satisfies its internal invariants, else 0.
+
+This is mainly intended for internal/debug validation.
+*/
+int zonemap_is_valid(const ZoneMap *zm);
+
+/*
+Initialize an empty zone map for the columns of `header`.
+
+If `block_rows` is 0, a default block size is used.
+
+Returns:
+- 0 on success
+- -1 on allocation failure or invalid input
+*/
+int zonemap_init(ZoneMap *zm, const CsvRowView *header, size_t block_rows);
+
+/*
+Destroy the zone map and release its owned memory.
+
+Safe to call multiple times on the same object.
+*/
+void zonemap_destroy(ZoneMap *zm);
+
+/*
+Read the size and modification time of the file at `path`.
+
+Returns 0 on success, -1 on error (errno is preserved from stat()).
+*/
+int zonemap_source_stat(const char *path, ZoneSource *out);
+
+/*
+Return 1 if the next row passed to `zonemap_add_row()` opens a new block.
+
+The caller uses this to fetch the (comparatively expensive) byte offset only
+at block boundaries instead of once per row.
+*/
+int zonemap_at_block_start(const ZoneMap *zm);
+
+/*
+Record one non-empty data row.
+
+`row_start` must be the byte offset of the row whenever
+`zonemap_at_block_start()` reports 1; it is ignored otherwise. Opening a new
+block closes the previous one at `row_start`. Every field of `row` is parsed
+with `parse_double_strict()`.
+
+Returns:
+- 0 on success
+- -1 on allocation failure or invalid input
+*/
+int zonemap_add_row(ZoneMap *zm, unsigned long long row_start, const CsvRowView *row);
+
+/*
+Close the block that is currently being accumulated (if any).
+
+`end` is the byte offset just past the last row.
+*/
+void zonemap_finish(ZoneMap *zm, unsigned long long end);
+
+/*
+Persist the map to `path`, tagged with the identity `src` of the data file.
+
+The file is written to `path` + ".tmp" first and renamed into place.
+
+Returns 0 on success, -1 on I/O error.
+*/
+int zonemap_save(const ZoneMap *zm, const char *path, const ZoneSource *src);
+
+/*
+Load a map from `path` and check that it matches `src` and `header`.
+
+Returns:
+- 0 on success (zm is initialized and owned by the caller)
+- 1 if the file does not exist or is stale (zm is left destroyed)
+- -1 on I/O, format or allocation error (zm is left destroyed)
+*/
+int zonemap_load(ZoneMap *zm, const char *path, const ZoneSource *src,
+                 const CsvRowView *header);
+
+/*
+Return 1 if block `b` may contain a value of column `col` within [lo, hi]
+(inclusive), else 0.
+*/
+int zonemap_block_may_match(const ZoneMap *zm, size_t b, size_t col,
+                            double lo, double hi);
+
+#endif
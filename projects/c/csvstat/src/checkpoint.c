@@ -0,0 +1,356 @@
+#define _POSIX_C_SOURCE 200809L  // pread(), fsync(), fileno()
+
+#include "checkpoint.h"
+#include "csvstat_alloc.h"
+
+#include <stdio.h>     // FILE, fopen, fwrite, fread, rename, remove
+#include <string.h>    // memcpy, memcmp, strlen, strrchr
+#include <errno.h>
+#include <fcntl.h>     // open
+#include <unistd.h>    // pread, fsync, close
+#include <sys/stat.h>  // stat
+
+#define CHECKPOINT_MAGIC "CSVCKPT5"
+
+uint64_t checkpoint_hash(uint64_t h, const void *data, size_t n) {
+    const unsigned char *p = (const unsigned char *)data;
+    for (size_t i = 0; i < n; i++) {
+        h ^= p[i];
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+/*
+Hash of the (up to) CHECKPOINT_TAIL bytes before `offset` in the file at
+`path`. Returns 0 on success, 1 if the file is shorter than `offset`, -1 on
+I/O error.
+*/
+static int tail_hash(const char *path, unsigned long long offset, uint64_t *out) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+
+    unsigned char buf[CHECKPOINT_TAIL];
+    size_t want = (offset < CHECKPOINT_TAIL) ? (size_t)offset : CHECKPOINT_TAIL;
+    off_t at = (off_t)(offset - want);
+
+    size_t have = 0;
+    while (have < want) {
+        ssize_t n = pread(fd, buf + have, want - have, at + (off_t)have);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            int saved = errno;
+            close(fd);
+            errno = saved;
+            return -1;
+        }
+        if (n == 0) break;
+        have += (size_t)n;
+    }
+    close(fd);
+
+    if (have < want) return 1;
+    *out = checkpoint_hash(CHECKPOINT_HASH_SEED, buf, have);
+    return 0;
+}
+
+int checkpoint_identify(Checkpoint *cp, const char *path, int compressed) {
+    if (!cp || !path) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    struct stat sb;
+    if (stat(path, &sb) != 0) return -1;
+
+    cp->compressed = compressed ? 1 : 0;
+    cp->src_size = (unsigned long long)sb.st_size;
+    cp->src_mtime = (long long)sb.st_mtime;
+    cp->tail_hash = 0;
+
+    // Decoded offsets do not map to file bytes; size/mtime must do there.
+    if (compressed) return 0;
+
+    int rc = tail_hash(path, cp->offset, &cp->tail_hash);
+    if (rc > 0) errno = EIO;  // the file shrank under us
+    return rc == 0 ? 0 : -1;
+}
+
+int checkpoint_matches(const Checkpoint *cp, const char *path, int compressed) {
+    if (!cp || !path) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (cp->compressed != (compressed ? 1 : 0)) return 0;
+
+    struct stat sb;
+    if (stat(path, &sb) != 0) return -1;
+
+    if (compressed) {
+        return (cp->src_size == (unsigned long long)sb.st_size &&
+                cp->src_mtime == (long long)sb.st_mtime) ? 1 : 0;
+    }
+
+    uint64_t h = 0;
+    int rc = tail_hash(path, cp->offset, &h);
+    if (rc < 0) return -1;
+    return (rc == 0 && h == cp->tail_hash) ? 1 : 0;
+}
+
+static int write_u64(FILE *fp, uint64_t v) {
+    return (fwrite(&v, sizeof v, 1, fp) == 1) ? 0 : -1;
+}
+
+static int write_f64(FILE *fp, double v) {
+    return (fwrite(&v, sizeof v, 1, fp) == 1) ? 0 : -1;
+}
+
+static int read_u64(FILE *fp, uint64_t *v) {
+    return (fread(v, sizeof *v, 1, fp) == 1) ? 0 : -1;
+}
+
+static int read_f64(FILE *fp, double *v) {
+    return (fread(v, sizeof *v, 1, fp) == 1) ? 0 : -1;
+}
+
+static int write_body(const Checkpoint *cp, FILE *fp) {
+    if (fwrite(CHECKPOINT_MAGIC, 1, 8, fp) != 8) return -1;
+    if (write_u64(fp, cp->job) != 0) return -1;
+    if (write_u64(fp, (uint64_t)cp->compressed) != 0) return -1;
+    if (write_u64(fp, cp->src_size) != 0) return -1;
+    if (write_u64(fp, (uint64_t)cp->src_mtime) != 0) return -1;
+    if (write_u64(fp, cp->tail_hash) != 0) return -1;
+    if (write_u64(fp, cp->offset) != 0) return -1;
+    if (write_u64(fp, cp->row_no) != 0) return -1;
+
+    const ScanCounters *sc = &cp->sc;
+    if (write_u64(fp, sc->rows_seen) != 0) return -1;
+    if (write_u64(fp, sc->numeric_ok) != 0) return -1;
+    if (write_u64(fp, sc->numeric_bad) != 0) return -1;
+    if (write_u64(fp, sc->missing_col) != 0) return -1;
+    if (write_u64(fp, sc->range_rejected) != 0) return -1;
+    if (write_u64(fp, sc->where_rejected) != 0) return -1;
+
+    const Stats *st = &cp->st;
+    if (write_u64(fp, st->n) != 0) return -1;
+    if (write_u64(fp, (uint64_t)st->moments) != 0) return -1;
+    if (write_u64(fp, (uint64_t)st->precision) != 0) return -1;
+    if (write_f64(fp, st->mean) != 0) return -1;
+    if (write_f64(fp, st->m2) != 0) return -1;
+    if (write_f64(fp, st->m3) != 0) return -1;
+    if (write_f64(fp, st->m4) != 0) return -1;
+    if (write_f64(fp, st->min) != 0) return -1;
+    if (write_f64(fp, st->max) != 0) return -1;
+    if (write_f64(fp, st->sum) != 0) return -1;
+    if (write_f64(fp, st->sum_c) != 0) return -1;
+    if (write_f64(fp, st->m2_c) != 0) return -1;
+
+    const DecStats *dec = &cp->dec;
+    if (write_u64(fp, dec->n) != 0) return -1;
+    if (write_u64(fp, (uint64_t)dec->min) != 0) return -1;
+    if (write_u64(fp, (uint64_t)dec->max) != 0) return -1;
+    if (write_u64(fp, (uint64_t)dec->sum) != 0) return -1;
+    if (write_u64(fp, (uint64_t)((udec128)dec->sum >> 64)) != 0) return -1;
+    if (write_u64(fp, (uint64_t)dec->sumsq) != 0) return -1;
+    if (write_u64(fp, (uint64_t)(dec->sumsq >> 64)) != 0) return -1;
+
+    const Diag *dg = &cp->diag;
+    for (int k = 0; k < DIAG_NKINDS; k++) {
+        if (write_u64(fp, dg->count[k]) != 0) return -1;
+    }
+    if (write_u64(fp, dg->total) != 0) return -1;
+    if (write_u64(fp, dg->nfirst) != 0) return -1;
+    if (write_u64(fp, dg->nsample) != 0) return -1;
+    if (write_u64(fp, dg->sampled) != 0) return -1;
+    if (write_u64(fp, dg->rng) != 0) return -1;
+    for (size_t i = 0; i < DIAG_FIRST + DIAG_SAMPLE; i++) {
+        const DiagExample *e = (i < DIAG_FIRST) ? &dg->first[i] : &dg->sample[i - DIAG_FIRST];
+        if (write_u64(fp, (uint64_t)e->kind) != 0) return -1;
+        if (write_u64(fp, e->chunk) != 0) return -1;
+        if (write_u64(fp, e->row_no) != 0) return -1;
+        if (write_u64(fp, e->len) != 0) return -1;
+        if (fwrite(e->text, 1, DIAG_TEXT_MAX, fp) != DIAG_TEXT_MAX) return -1;
+    }
+
+    if (write_u64(fp, cp->reject_offset) != 0) return -1;
+    return 0;
+}
+
+/*
+Read the diag section of a checkpoint into `dg` (see the layout in
+checkpoint.h). Returns 0 on success, -1 if it is short or inconsistent.
+*/
+static int read_diag(FILE *fp, Diag *dg) {
+    *dg = (Diag){0};
+
+    uint64_t v[DIAG_NKINDS + 5];
+    for (size_t i = 0; i < sizeof v / sizeof v[0]; i++) {
+        if (read_u64(fp, &v[i]) != 0) return -1;
+    }
+    uint64_t sum = 0;
+    for (int k = 0; k < DIAG_NKINDS; k++) {
+        dg->count[k] = (size_t)v[k];
+        sum += v[k];
+    }
+    dg->total = (size_t)v[DIAG_NKINDS];
+    dg->nfirst = (size_t)v[DIAG_NKINDS + 1];
+    dg->nsample = (size_t)v[DIAG_NKINDS + 2];
+    dg->sampled = (size_t)v[DIAG_NKINDS + 3];
+    dg->rng = v[DIAG_NKINDS + 4];
+    if (sum != dg->total || dg->nfirst > DIAG_FIRST || dg->nsample > DIAG_SAMPLE ||
+        dg->nsample > dg->sampled || dg->rng == 0) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < DIAG_FIRST + DIAG_SAMPLE; i++) {
+        DiagExample *e = (i < DIAG_FIRST) ? &dg->first[i] : &dg->sample[i - DIAG_FIRST];
+        uint64_t f[4];
+        for (size_t j = 0; j < 4; j++) {
+            if (read_u64(fp, &f[j]) != 0) return -1;
+        }
+        if (f[0] >= DIAG_NKINDS) return -1;
+        e->kind = (DiagKind)f[0];
+        e->chunk = (size_t)f[1];
+        e->row_no = (size_t)f[2];
+        e->len = (size_t)f[3];
+        if (fread(e->text, 1, DIAG_TEXT_MAX, fp) != DIAG_TEXT_MAX) return -1;
+    }
+    return 0;
+}
+
+/*
+fsync the directory holding `path` so the rename itself is durable.
+*/
+static void sync_parent_dir(const char *path) {
+    const char *slash = strrchr(path, '/');
+    char *dir = NULL;
+
+    if (!slash) {
+        dir = csvstat_malloc(ALLOC_CHECKPOINT, 2);
+        if (dir) memcpy(dir, ".", 2);
+    } else {
+        size_t n = (slash == path) ? 1 : (size_t)(slash - path);
+        dir = csvstat_malloc(ALLOC_CHECKPOINT, n + 1);
+        if (dir) {
+            memcpy(dir, path, n);
+            dir[n] = '\0';
+        }
+    }
+    if (!dir) return;
+
+    int fd = open(dir, O_RDONLY);
+    if (fd >= 0) {
+        (void)fsync(fd);  // best effort: not every filesystem allows it
+        close(fd);
+    }
+    csvstat_free(dir);
+}
+
+int checkpoint_save(const char *path, const Checkpoint *cp) {
+    if (!path || !cp) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    size_t plen = strlen(path);
+    char *tmp = (char *)csvstat_malloc(ALLOC_CHECKPOINT, plen + 5);
+    if (!tmp) {
+        errno = ENOMEM;
+        return -1;
+    }
+    memcpy(tmp, path, plen);
+    memcpy(tmp + plen, ".tmp", 5);
+
+    FILE *fp = fopen(tmp, "wb");
+    if (!fp) {
+        csvstat_free(tmp);
+        return -1;
+    }
+
+    int rc = write_body(cp, fp);
+    if (rc == 0 && (fflush(fp) != 0 || fsync(fileno(fp)) != 0)) rc = -1;
+    int saved = errno;
+    if (fclose(fp) != 0 && rc == 0) {
+        rc = -1;
+        saved = errno;
+    }
+
+    // Only a completely written, synced file replaces the previous one.
+    if (rc == 0 && rename(tmp, path) != 0) {
+        rc = -1;
+        saved = errno;
+    }
+    if (rc != 0) remove(tmp);
+    if (rc == 0) sync_parent_dir(path);
+
+    csvstat_free(tmp);
+    if (rc != 0) errno = saved;
+    return rc;
+}
+
+int checkpoint_load(const char *path, Checkpoint *cp) {
+    if (!path || !cp) return -1;
+
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return (errno == ENOENT) ? 1 : -1;
+
+    int rc = -1;
+    char magic[8];
+    uint64_t v[16];
+    double d[9];
+    uint64_t w[7];
+    uint64_t reject_offset = 0;
+
+    if (fread(magic, 1, 8, fp) != 8 || memcmp(magic, CHECKPOINT_MAGIC, 8) != 0) goto done;
+    for (size_t i = 0; i < sizeof v / sizeof v[0]; i++) {
+        if (read_u64(fp, &v[i]) != 0) goto done;
+    }
+    for (size_t i = 0; i < sizeof d / sizeof d[0]; i++) {
+        if (read_f64(fp, &d[i]) != 0) goto done;
+    }
+    for (size_t i = 0; i < sizeof w / sizeof w[0]; i++) {
+        if (read_u64(fp, &w[i]) != 0) goto done;
+    }
+    if (read_diag(fp, &cp->diag) != 0) goto done;
+    if (read_u64(fp, &reject_offset) != 0) goto done;
+    if (fgetc(fp) != EOF) goto done;  // trailing bytes: not ours
+    if (v[1] > 1 || v[14] > 1 || v[15] >= STATS_NPRECISIONS) goto done;
+
+    cp->job = v[0];
+    cp->compressed = (int)v[1];
+    cp->src_size = v[2];
+    cp->src_mtime = (long long)v[3];
+    cp->tail_hash = v[4];
+    cp->offset = v[5];
+    cp->row_no = (size_t)v[6];
+    cp->sc.rows_seen = (size_t)v[7];
+    cp->sc.numeric_ok = (size_t)v[8];
+    cp->sc.numeric_bad = (size_t)v[9];
+    cp->sc.missing_col = (size_t)v[10];
+    cp->sc.range_rejected = (size_t)v[11];
+    cp->sc.where_rejected = (size_t)v[12];
+    cp->st.n = (size_t)v[13];
+    cp->st.moments = (int)v[14];
+    cp->st.precision = (int)v[15];
+    cp->st.mean = d[0];
+    cp->st.m2 = d[1];
+    cp->st.m3 = d[2];
+    cp->st.m4 = d[3];
+    cp->st.min = d[4];
+    cp->st.max = d[5];
+    cp->st.sum = d[6];
+    cp->st.sum_c = d[7];
+    cp->st.m2_c = d[8];
+    cp->dec.n = (size_t)w[0];
+    cp->dec.min = (int64_t)w[1];
+    cp->dec.max = (int64_t)w[2];
+    cp->dec.sum = (dec128)(((udec128)w[4] << 64) | w[3]);
+    cp->dec.sumsq = ((udec128)w[6] << 64) | w[5];
+    cp->reject_offset = reject_offset;
+
+    rc = (stats_is_valid(&cp->st) && cp->dec.min <= cp->dec.max) ? 0 : -1;
+
+done:
+    fclose(fp);
+    return rc;
+}
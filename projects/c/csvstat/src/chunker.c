@@ -0,0 +1,261 @@
+#define _POSIX_C_SOURCE 200809L  // pread()
+
+#include "chunker.h"
+#include "csvstat_alloc.h"
+
+#include <string.h>    // memcpy, memset
+#include <stdint.h>    // uint64_t
+#include <errno.h>
+#include <fcntl.h>     // open
+#include <unistd.h>    // pread, close
+#include <pthread.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__PCLMUL__)
+#include <wmmintrin.h>
+#endif
+
+#define CHUNK_READ_SIZE (1u << 20)  // pass-1 read size (bytes), multiple of 64
+#define CHUNK_NONE ((unsigned long long)-1)
+
+/*
+Bitmasks of '"' and '\n' bytes in a 64-byte block (bit i = byte i).
+*/
+static void block_masks(const unsigned char *p, uint64_t *quote, uint64_t *nl) {
+#if defined(__SSE2__)
+    const __m128i vq = _mm_set1_epi8('"');
+    const __m128i vn = _mm_set1_epi8('\n');
+    uint64_t q = 0, n = 0;
+    for (int k = 0; k < 4; k++) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(const void *)(p + 16 * k));
+        q |= (uint64_t)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, vq)) << (16 * k);
+        n |= (uint64_t)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, vn)) << (16 * k);
+    }
+    *quote = q;
+    *nl = n;
+#else
+    uint64_t q = 0, n = 0;
+    for (int i = 0; i < 64; i++) {
+        q |= (uint64_t)(p[i] == '"') << i;
+        n |= (uint64_t)(p[i] == '\n') << i;
+    }
+    *quote = q;
+    *nl = n;
+#endif
+}
+
+/*
+Prefix XOR: bit i of the result is the XOR of bits 0..i of `x`, i.e. 1 for
+every byte after an odd number of quotes (an opening quote counts as inside).
+A carry-less multiply by all-ones computes it in one instruction; otherwise a
+log-step shift cascade does.
+*/
+static uint64_t prefix_xor(uint64_t x) {
+#if defined(__PCLMUL__)
+    __m128i v = _mm_clmulepi64_si128(_mm_set_epi64x(0, (long long)x),
+                                     _mm_set1_epi8((char)0xFF), 0);
+    return (uint64_t)_mm_cvtsi128_si64(v);
+#else
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+#endif
+}
+
+static unsigned lowest_bit(uint64_t x) {
+#if defined(__GNUC__)
+    return (unsigned)__builtin_ctzll(x);
+#else
+    unsigned i = 0;
+    while (!(x & 1)) { x >>= 1; i++; }
+    return i;
+#endif
+}
+
+static unsigned parity64(uint64_t x) {
+#if defined(__GNUC__)
+    return (unsigned)__builtin_parityll(x);
+#else
+    x ^= x >> 32; x ^= x >> 16; x ^= x >> 8;
+    x ^= x >> 4;  x ^= x >> 2;  x ^= x >> 1;
+    return (unsigned)(x & 1);
+#endif
+}
+
+/*
+Pass-1 work item for one raw chunk.
+*/
+typedef struct {
+    int fd;
+    int quotes;
+    unsigned long long lo;        // raw chunk range [lo, hi)
+    unsigned long long hi;
+
+    unsigned parity;              // quotes in the chunk, mod 2
+    unsigned long long first[2];  // first record start for start state 0 / 1
+    int err;                      // errno on failure, else 0
+} ChunkScan;
+
+static void *chunk_scan(void *arg) {
+    ChunkScan *cs = arg;
+
+    cs->parity = 0;
+    cs->first[0] = CHUNK_NONE;
+    cs->first[1] = CHUNK_NONE;
+    cs->err = 0;
+
+    unsigned char *buf = csvstat_malloc(ALLOC_CHUNKER, CHUNK_READ_SIZE + 64);
+    if (!buf) {
+        cs->err = ENOMEM;
+        return NULL;
+    }
+
+    uint64_t inside = 0;  // all-ones when hypothesis 0 is inside quotes at the block start
+    unsigned long long off = cs->lo;
+
+    while (off < cs->hi) {
+        size_t want = CHUNK_READ_SIZE;
+        if (cs->hi - off < want) want = (size_t)(cs->hi - off);
+
+        ssize_t got = pread(cs->fd, buf, want, (off_t)off);
+        if (got < 0) {
+            if (errno == EINTR) continue;
+            cs->err = errno;
+            break;
+        }
+        if (got == 0) break;  // file shrank: treat as end
+
+        size_t n = (size_t)got;
+        memset(buf + n, 0, 64);  // pad the tail block
+
+        for (size_t i = 0; i < n; i += 64) {
+            uint64_t q = 0, nl = 0;
+            block_masks(buf + i, &q, &nl);
+            if (n - i < 64) nl &= ((uint64_t)1 << (n - i)) - 1;
+            if (!cs->quotes) q = 0;
+
+            uint64_t in0 = prefix_xor(q) ^ inside;  // inside-quote bytes, hypothesis 0
+            uint64_t out0 = nl & ~in0;
+            uint64_t out1 = nl & in0;               // hypothesis 1 is the complement
+
+            if (cs->first[0] == CHUNK_NONE && out0) {
+                cs->first[0] = off + i + lowest_bit(out0) + 1;
+            }
+            if (cs->first[1] == CHUNK_NONE && out1) {
+                cs->first[1] = off + i + lowest_bit(out1) + 1;
+            }
+
+            cs->parity ^= parity64(q);
+            inside = (uint64_t)0 - (in0 >> 63);  // broadcast the last byte's state
+        }
+
+        // Without quotes the parity is 0 and only the first newline matters.
+        if (!cs->quotes && cs->first[0] != CHUNK_NONE) break;
+
+        off += n;
+    }
+
+    csvstat_free(buf);
+    return NULL;
+}
+
+int csv_chunk_plan(const char *path, unsigned long long begin, unsigned long long end,
+                   int quotes, size_t nchunks, CsvChunk *out) {
+    if (!path || !out || nchunks == 0 || begin > end) return -1;
+
+    if (nchunks == 1 || end - begin < nchunks) {
+        // Too small to split: one chunk takes everything.
+        for (size_t i = 0; i < nchunks; i++) {
+            out[i].start = (i == 0) ? begin : end;
+            out[i].end = end;
+        }
+        return 0;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+
+    ChunkScan *cs = csvstat_calloc(ALLOC_CHUNKER, nchunks, sizeof *cs);
+    pthread_t *tids = csvstat_calloc(ALLOC_CHUNKER, nchunks, sizeof *tids);
+    if (!cs || !tids) {
+        csvstat_free(cs);
+        csvstat_free(tids);
+        close(fd);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    // ---- Pass 1: per-chunk parity and candidate boundaries ----
+    unsigned long long span = (end - begin) / nchunks;
+    size_t started = 0;
+    int rc = 0;
+
+    for (size_t i = 0; i < nchunks; i++) {
+        cs[i].fd = fd;
+        cs[i].quotes = quotes;
+        cs[i].lo = begin + span * i;
+        cs[i].hi = (i + 1 == nchunks) ? end : begin + span * (i + 1);
+    }
+    // Chunk 0 starts at `begin` by contract and needs no scan.
+    for (size_t i = 1; i < nchunks; i++) {
+        if (pthread_create(&tids[i], NULL, chunk_scan, &cs[i]) != 0) {
+            rc = -1;
+            break;
+        }
+        started = i;
+    }
+    if (quotes) {
+        chunk_scan(&cs[0]);  // parity of chunk 0 is needed; run it on this thread
+    }
+    for (size_t i = 1; i <= started; i++) {
+        pthread_join(tids[i], NULL);
+    }
+
+    int saved = 0;
+    if (quotes && cs[0].err) saved = cs[0].err;
+    for (size_t i = 1; i < nchunks && rc == 0; i++) {
+        if (cs[i].err) {
+            saved = cs[i].err;
+            break;
+        }
+    }
+    if (rc == 0 && saved) rc = -1;
+
+    // ---- Pass 2: resolve each chunk's start state and first record ----
+    if (rc == 0) {
+        unsigned state = quotes ? cs[0].parity : 0;
+        out[0].start = begin;
+
+        for (size_t i = 1; i < nchunks; i++) {
+            // Walk forward until some chunk contains a boundary for its state.
+            unsigned long long start = end;
+            unsigned s = state;
+            for (size_t j = i; j < nchunks; j++) {
+                if (cs[j].first[s] != CHUNK_NONE) {
+                    start = cs[j].first[s];
+                    break;
+                }
+                s ^= cs[j].parity;
+            }
+            if (start < out[i - 1].start) start = out[i - 1].start;
+
+            out[i].start = start;
+            out[i - 1].end = start;
+            state ^= cs[i].parity;
+        }
+        out[nchunks - 1].end = end;
+    }
+
+    csvstat_free(cs);
+    csvstat_free(tids);
+    close(fd);
+
+    if (saved) errno = saved;
+    return rc;
+}
@@ -0,0 +1,215 @@
+#include "corr.h"
+#include "csvstat_alloc.h"
+
+#include <math.h>
+#include <string.h>
+
+void comoment_init(CoMoment *c) {
+    if (!c) return;
+    *c = (CoMoment){0};
+}
+
+int comoment_push(CoMoment *c, double x, double y) {
+    if (!c) return -1;
+
+    c->n++;
+    double dx = x - c->mean_x;
+    double dy = y - c->mean_y;
+    c->mean_x += dx / (double)c->n;
+    c->mean_y += dy / (double)c->n;
+
+    // One old and one new deviation per product, as in Welford's m2.
+    double dy2 = y - c->mean_y;
+    c->m2_x += dx * (x - c->mean_x);
+    c->m2_y += dy * dy2;
+    c->c_xy += dx * dy2;
+    return 0;
+}
+
+int comoment_merge(CoMoment *dst, const CoMoment *src) {
+    if (!dst || !src) return -1;
+    if (src->n == 0) return 0;
+    if (dst->n == 0) {
+        *dst = *src;
+        return 0;
+    }
+
+    double na = (double)dst->n;
+    double nb = (double)src->n;
+    double n = na + nb;
+    double dx = src->mean_x - dst->mean_x;
+    double dy = src->mean_y - dst->mean_y;
+    double f = na * nb / n;
+
+    dst->mean_x += dx * nb / n;
+    dst->mean_y += dy * nb / n;
+    dst->m2_x += src->m2_x + dx * dx * f;
+    dst->m2_y += src->m2_y + dy * dy * f;
+    dst->c_xy += src->c_xy + dx * dy * f;
+    dst->n += src->n;
+    return 0;
+}
+
+int comoment_covariance(const CoMoment *c, double *out) {
+    if (!c || !out || c->n < 2) return -1;
+    *out = c->c_xy / (double)(c->n - 1);
+    return 0;
+}
+
+int comoment_pearson(const CoMoment *c, double *out) {
+    if (!c || !out || !(c->m2_x > 0.0) || !(c->m2_y > 0.0)) return -1;
+
+    double r = c->c_xy / sqrt(c->m2_x * c->m2_y);
+    // Rounding can push a perfect fit just past +-1.
+    if (r > 1.0) r = 1.0;
+    if (r < -1.0) r = -1.0;
+    *out = r;
+    return 0;
+}
+
+int comoment_slope(const CoMoment *c, double *out) {
+    if (!c || !out || !(c->m2_x > 0.0)) return -1;
+    *out = c->c_xy / c->m2_x;
+    return 0;
+}
+
+int comoment_intercept(const CoMoment *c, double *out) {
+    double slope = 0.0;
+    if (!out || comoment_slope(c, &slope) != 0) return -1;
+    *out = c->mean_y - slope * c->mean_x;
+    return 0;
+}
+
+int corr_matrix_init(CorrMatrix *m, size_t k) {
+    if (!m) return -1;
+
+    *m = (CorrMatrix){0};
+    if (k < 2 || k > CORR_MAX_COLS) return -1;
+
+    size_t kp = (k + CORR_TILE - 1) / CORR_TILE * CORR_TILE;
+    m->mean = csvstat_calloc(ALLOC_CORR, k, sizeof *m->mean);
+    m->cm = csvstat_calloc(ALLOC_CORR, kp * kp, sizeof *m->cm);
+    m->block = csvstat_calloc(ALLOC_CORR, kp * CORR_BLOCK, sizeof *m->block);
+    if (!m->mean || !m->cm || !m->block) {
+        corr_matrix_destroy(m);
+        return -1;
+    }
+    m->k = k;
+    m->kp = kp;
+    return 0;
+}
+
+void corr_matrix_destroy(CorrMatrix *m) {
+    if (!m) return;
+
+    csvstat_free(m->mean);
+    csvstat_free(m->cm);
+    csvstat_free(m->block);
+    *m = (CorrMatrix){0};
+}
+
+void corr_matrix_push(CorrMatrix *m, const double *row) {
+    memcpy(m->block + m->nblock * m->kp, row, m->k * sizeof *row);
+    if (++m->nblock == CORR_BLOCK) corr_matrix_flush(m);
+}
+
+/*
+Add the cross products of columns I..I+CORR_TILE and J..J+CORR_TILE of the
+(centered) block to `acc`, summed over its `nb` rows of `kp` values. Each row
+contributes an outer product: one x times a contiguous run of y, which the
+compiler turns into vector multiply-adds.
+*/
+static void tile_products(const double *restrict block, size_t kp, size_t I, size_t J,
+                          size_t nb, double acc[CORR_TILE][CORR_TILE]) {
+    double s[CORR_TILE][CORR_TILE] = {{0}};
+    for (size_t r = 0; r < nb; r++) {
+        const double *x = block + r * kp + I;
+        const double *y = block + r * kp + J;
+        for (size_t a = 0; a < CORR_TILE; a++) {
+            for (size_t b = 0; b < CORR_TILE; b++) s[a][b] += x[a] * y[b];
+        }
+    }
+    memcpy(acc, s, sizeof s);
+}
+
+void corr_matrix_flush(CorrMatrix *m) {
+    if (!m || m->nblock == 0) return;
+
+    size_t nb = m->nblock;
+    double na = (double)m->n;
+    double n = na + (double)nb;
+    double delta[CORR_MAX_COLS];
+
+    // Center each column on its block mean; the padding columns stay 0.
+    double mb[CORR_MAX_COLS] = {0};
+    for (size_t r = 0; r < nb; r++) {
+        const double *row = m->block + r * m->kp;
+        for (size_t i = 0; i < m->kp; i++) mb[i] += row[i];
+    }
+    for (size_t i = 0; i < m->kp; i++) mb[i] /= (double)nb;
+    for (size_t r = 0; r < nb; r++) {
+        double *row = m->block + r * m->kp;
+        for (size_t i = 0; i < m->kp; i++) row[i] -= mb[i];
+    }
+    for (size_t i = 0; i < m->k; i++) {
+        delta[i] = mb[i] - m->mean[i];
+        m->mean[i] += delta[i] * (double)nb / n;
+    }
+
+    // Block co-moments tile by tile, then the Chan correction for the
+    // shift between the block means and the running means.
+    double f = na * (double)nb / n;
+    for (size_t I = 0; I < m->kp; I += CORR_TILE) {
+        for (size_t J = I; J < m->kp; J += CORR_TILE) {
+            double acc[CORR_TILE][CORR_TILE];
+            tile_products(m->block, m->kp, I, J, nb, acc);
+            for (size_t a = 0; a < CORR_TILE && I + a < m->k; a++) {
+                for (size_t b = 0; b < CORR_TILE && J + b < m->k; b++) {
+                    size_t i = I + a, j = J + b;
+                    if (j < i) continue;
+                    m->cm[i * m->kp + j] += acc[a][b] + delta[i] * delta[j] * f;
+                }
+            }
+        }
+    }
+
+    m->n += nb;
+    m->nblock = 0;
+}
+
+int corr_matrix_merge(CorrMatrix *dst, const CorrMatrix *src) {
+    if (!dst || !src || dst->k != src->k || dst->nblock || src->nblock) return -1;
+    if (src->n == 0) return 0;
+
+    double na = (double)dst->n;
+    double nb = (double)src->n;
+    double n = na + nb;
+    double f = na * nb / n;
+    double delta[CORR_MAX_COLS];
+
+    for (size_t i = 0; i < dst->k; i++) {
+        delta[i] = src->mean[i] - dst->mean[i];
+        dst->mean[i] += delta[i] * nb / n;
+    }
+    for (size_t i = 0; i < dst->k; i++) {
+        for (size_t j = i; j < dst->k; j++) {
+            dst->cm[i * dst->kp + j] += src->cm[i * src->kp + j] + delta[i] * delta[j] * f;
+        }
+    }
+    dst->n += src->n;
+    return 0;
+}
+
+int corr_matrix_pair(const CorrMatrix *m, size_t i, size_t j, CoMoment *out) {
+    if (!m || !out || i >= m->k || j >= m->k) return -1;
+
+    size_t lo = i < j ? i : j;
+    size_t hi = i < j ? j : i;
+    out->n = m->n;
+    out->mean_x = m->mean[i];
+    out->mean_y = m->mean[j];
+    out->m2_x = m->cm[i * m->kp + i];
+    out->m2_y = m->cm[j * m->kp + j];
+    out->c_xy = m->cm[lo * m->kp + hi];
+    return 0;
+}
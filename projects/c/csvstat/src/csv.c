@@ -1,10 +1,10 @@
 #include "csv.h"
 #include "csvstat_assert.h"
+#include "csvstat_alloc.h"
 
-#include <stdlib.h>  // malloc, realloc, free
-#include <string.h>  // strcmp
+#include <string.h>  // strcmp, strchr
 #include <ctype.h>   // isspace
-#include <limits.h>  // SIZE_MAX
+#include <stdint.h>  // SIZE_MAX
 
 /*
 CsvParser invariants:
@@ -31,7 +31,7 @@ static int ensure_ptr_capacity(CsvParser *p, size_t needed) {
         new_cap *= 2;
     } 
 
-    const char **tmp = (const char **)realloc((void *)p->scratch, new_cap * sizeof(const char *));
+    const char **tmp = (const char **)csvstat_realloc(ALLOC_CSV_PARSER, (void *)p->scratch, new_cap * sizeof(const char *));
     if (!tmp) return -1;
 
     p->scratch = tmp;
@@ -46,10 +46,13 @@ int csv_parser_init(CsvParser *p, size_t initial_capacity) {
 
     p->scratch = NULL;
     p->cap = 0;
+    p->rest = NULL;
+    p->quotes = 1;
+    p->delim = ',';
 
     if (initial_capacity == 0) initial_capacity = 16;
 
-    p->scratch = (const char **)malloc(initial_capacity * sizeof(const char *));
+    p->scratch = (const char **)csvstat_malloc(ALLOC_CSV_PARSER, initial_capacity * sizeof(const char *));
     if (!p->scratch) return -1;
 
     p->cap = initial_capacity;
@@ -61,43 +64,254 @@ int csv_parser_init(CsvParser *p, size_t initial_capacity) {
 void csv_parser_destroy(CsvParser *p) {
     if (!p) return;
     
-    free((void *)p->scratch);
+    csvstat_free((void *)p->scratch);
     p->scratch = NULL;
     p->cap = 0;
+    p->rest = NULL;
 
     CSVSTAT_ASSERT(csv_parser_is_valid(p));
 }
 
+void csv_parser_set_quotes(CsvParser *p, int enabled) {
+    if (!p) return;
+    p->quotes = enabled ? 1 : 0;
+}
+
+int csv_parser_set_delim(CsvParser *p, char delim) {
+    if (!p) return -1;
+    if (delim == '"' || delim == '\n' || delim == '\r' || delim == '\0') return -1;
+
+    p->delim = delim;
+    return 0;
+}
+
+char csv_sniff_delim(const char *line) {
+    static const char cand[] = { ',', '\t', ';', '|' };
+    size_t counts[sizeof cand] = {0};
+    int in_quotes = 0;
+
+    if (!line) return ',';
+
+    for (const char *s = line; *s; s++) {
+        if (*s == '"') {
+            in_quotes = !in_quotes;
+            continue;
+        }
+        if (in_quotes) continue;
+        for (size_t i = 0; i < sizeof cand; i++) {
+            if (*s == cand[i]) counts[i]++;
+        }
+    }
+
+    size_t best = 0;
+    for (size_t i = 1; i < sizeof cand; i++) {
+        if (counts[i] > counts[best]) best = i;
+    }
+    return cand[best];
+}
+
 /*
-Trim leading and trailing whitespace in-place by:
-- advancing start pointer over leading whitespace
-- writing '\0' to cut trailing whitespace
+Trim leading and trailing blanks in-place by:
+- advancing start pointer over leading blanks
+- writing '\0' to cut trailing blanks
 Return spointer to trimmed start.
+
+`IS_BLANK` is a compile-time choice: spaces and tabs, or spaces only when
+tabs are the delimiter (a tab is then never part of a field's padding).
 */
-static char *trim_in_place(char *s) {
-    while (*s && (*s == ' ' || *s == '\t')) {
-        s++;
+#define IS_BLANK_WS(c) ((c) == ' ' || (c) == '\t')
+#define IS_BLANK_SP(c) ((c) == ' ')
+
+#define DEFINE_TRIM(NAME, IS_BLANK)                                             \
+static char *NAME(char *s) {                                                    \
+    while (*s && IS_BLANK(*s)) {                                                \
+        s++;                                                                    \
+    }                                                                           \
+                                                                                \
+    /* Trim trailing blanks by walking from end. */                             \
+    size_t n = 0;                                                               \
+    while (s[n] != '\0') n++;                                                   \
+                                                                                \
+    while (n > 0 && IS_BLANK(s[n - 1])) {                                       \
+        s[n - 1] = '\0';                                                        \
+        n--;                                                                    \
+    }                                                                           \
+                                                                                \
+    return s;                                                                   \
+}
+
+DEFINE_TRIM(trim_in_place, IS_BLANK_WS)
+DEFINE_TRIM(trim_in_place_sp, IS_BLANK_SP)
+
+/*
+Split fields starting at `s`, appending to the `field_count` fields already
+stored in scratch, until the end of the line or until `max_fields` fields
+have been stored. Records the unsplit remainder in `p->rest` (NULL when the
+whole line was consumed).
+
+This is the fast path for rows without any '"'. One copy is generated per
+common delimiter so the byte loop compares against a constant; `DELIM` of
+`p->delim` gives the generic copy for any other byte.
+
+Returns the new field count, or (size_t)-1 on allocation failure.
+*/
+#define DEFINE_SPLIT_PLAIN(NAME, DELIM, TRIM)                                   \
+static size_t NAME(CsvParser *p, char *s, size_t field_count, size_t max_fields) { \
+    const char delim = (DELIM);                                                 \
+    p->rest = NULL;                                                             \
+                                                                                \
+    if (field_count >= max_fields) {                                            \
+        p->rest = s;                                                            \
+        return field_count;                                                     \
+    }                                                                           \
+                                                                                \
+    char *field_start = s;                                                      \
+                                                                                \
+    for (;;) {                                                                  \
+        char c = *s;                                                            \
+                                                                                \
+        if (c == delim || c == '\0') {                                          \
+            /* Terminate current field in-place (if delimiter). */              \
+            if (c == delim) {                                                   \
+                *s = '\0';                                                      \
+            }                                                                   \
+                                                                                \
+            if (ensure_ptr_capacity(p, field_count + 1) != 0) {                 \
+                return (size_t)-1;                                              \
+            }                                                                   \
+                                                                                \
+            p->scratch[field_count] = TRIM(field_start);                        \
+            field_count++;                                                      \
+                                                                                \
+            if (c == '\0') {                                                    \
+                break; /* end of line */                                        \
+            }                                                                   \
+                                                                                \
+            /* Stop early: the rest stays untouched for csv_split_more(). */   \
+            if (field_count >= max_fields) {                                    \
+                p->rest = s + 1;                                                \
+                break;                                                          \
+            }                                                                   \
+                                                                                \
+            field_start = s + 1;                                                \
+        }                                                                       \
+                                                                                \
+        s++;                                                                    \
+    }                                                                           \
+                                                                                \
+    return field_count;                                                         \
+}
+
+DEFINE_SPLIT_PLAIN(split_plain, ',', trim_in_place)
+DEFINE_SPLIT_PLAIN(split_plain_tab, '\t', trim_in_place_sp)
+DEFINE_SPLIT_PLAIN(split_plain_pipe, '|', trim_in_place)
+DEFINE_SPLIT_PLAIN(split_plain_semicolon, ';', trim_in_place)
+DEFINE_SPLIT_PLAIN(split_plain_any, p->delim, trim_in_place)
+
+/*
+Quote-aware variant of `split_plain()` (same contract).
+
+A field whose first non-blank byte is '"' is quoted: delimiters and newlines
+inside it are data, `""` stands for one '"', and the content is not trimmed.
+Fields are unescaped in place; the write cursor never passes the read
+cursor because unescaping only shrinks a field.
+
+Malformed input is accepted leniently, like most CSV readers:
+- a '"' in the middle of an unquoted field is an ordinary character
+- bytes between a closing quote and the next delimiter are appended
+- an unterminated quoted field runs to the end of the line
+*/
+static size_t split_quoted(CsvParser *p, char *s, size_t field_count, size_t max_fields) {
+    const char delim = p->delim;
+    const int tab_blank = (delim != '\t');  // a tab delimiter is never padding
+    p->rest = NULL;
+
+    if (field_count >= max_fields) {
+        p->rest = s;
+        return field_count;
     }
 
-    // Trim trailing spaces/tabs by walking from end.
-    // We can safely do this because `s` points inside a NUL-terminated field.
-    size_t n = 0;
-    while (s[n] != '\0') n++;
+    char *r = s;  // read cursor
 
-    while (n > 0) {
-        char c = s[n - 1];
-        if (c == ' ' || c == '\t') {
-            s[n - 1] = '\0';
-            n--;
-        } else {
+    for (;;) {
+        while (*r == ' ' || (tab_blank && *r == '\t')) r++;
+
+        char *start = r;  // unescaped field is written from here
+        char *w = r;      // write cursor
+        char *keep = r;   // trailing trim must not cut quoted content
+
+        if (*r == '"') {
+            r++;
+            for (;;) {
+                char c = *r;
+                if (c == '\0') break;
+                if (c == '"') {
+                    if (r[1] == '"') {
+                        *w++ = '"';
+                        r += 2;
+                        continue;
+                    }
+                    r++; // closing quote
+                    break;
+                }
+                *w++ = c;
+                r++;
+            }
+            keep = w;
+        }
+
+        // Unquoted field (or lenient tail after a closing quote).
+        while (*r != delim && *r != '\0') *w++ = *r++;
+
+        char end = *r;
+        while (w > keep && (w[-1] == ' ' || (tab_blank && w[-1] == '\t'))) w--;
+        *w = '\0'; // may overwrite the delimiter at r; `end` remembers it
+
+        if (ensure_ptr_capacity(p, field_count + 1) != 0) {
+            return (size_t)-1;
+        }
+        p->scratch[field_count] = start;
+        field_count++;
+
+        if (end == '\0') {
+            break; // end of line
+        }
+
+        r++; // skip delimiter
+
+        if (field_count >= max_fields) {
+            p->rest = r;
             break;
         }
     }
 
-    return s;
+    return field_count;
+}
+
+/*
+Dispatch to the plain fast path unless the remaining text contains a quote.
+`strchr` is vectorized by the C library, so the probe costs far less than
+the byte loop it guards. The delimiter is switched on once per call, never
+inside the byte loop.
+*/
+static size_t split_fields(CsvParser *p, char *s, size_t field_count, size_t max_fields) {
+    if (p->quotes && strchr(s, '"') != NULL) {
+        return split_quoted(p, s, field_count, max_fields);
+    }
+    switch (p->delim) {
+        case ',':  return split_plain(p, s, field_count, max_fields);
+        case '\t': return split_plain_tab(p, s, field_count, max_fields);
+        case '|':  return split_plain_pipe(p, s, field_count, max_fields);
+        case ';':  return split_plain_semicolon(p, s, field_count, max_fields);
+        default:   return split_plain_any(p, s, field_count, max_fields);
+    }
 }
 
 int csv_split(CsvParser *p, char *line, CsvRowView *out) {
+    return csv_split_n(p, line, SIZE_MAX, out);
+}
+
+int csv_split_n(CsvParser *p, char *line, size_t max_fields, CsvRowView *out) {
     if (!p || !line || !out) return -1;
 
     CSVSTAT_ASSERT(csv_parser_is_valid(p));
@@ -107,41 +321,26 @@ int csv_split(CsvParser *p, char *line, CsvRowView *out) {
 
     // Worst case: "a,b,c" has fields_count = commas + 1.
     // We'll grow as needed.
-    size_t field_count = 0;
+    size_t field_count = split_fields(p, line, 0, max_fields);
+    if (field_count == (size_t)-1) return -1;
 
-    char *s = line;
-    char *field_start = s;
-
-    for (;;) {
-        char c = *s;
-
-        if (c == ',' || c == '\0') {
-            // Terminate current field in-place (if comma).
-            if (c == ',') {
-                *s = '\0';
-            }
+    out->fields = p->scratch;
+    out->nfields = field_count;
 
-            // Ensure room in scratch for this field pointer
-            if (ensure_ptr_capacity(p, field_count + 1) != 0) {
-                return -1;
-            }
+    CSVSTAT_ASSERT(csv_parser_is_valid(p));
+    return 0;
+}
 
-            // Trim field and store pointer
-            char *trimmed = trim_in_place(field_start);
-            p->scratch[field_count] = trimmed;
-            field_count++;
+int csv_split_more(CsvParser *p, size_t max_fields, CsvRowView *out) {
+    if (!p || !out) return -1;
 
-            if (c == '\0') {
-                break; // end of line
-            }
+    CSVSTAT_ASSERT(csv_parser_is_valid(p));
 
-            // Next field starts rigth after the '\0' we just wrote
-            field_start = s + 1;
-        }
+    // Nothing left to split: the row view is already complete.
+    if (!p->rest) return 0;
 
-        if (c == '\0') break;
-        s++;
-    }
+    size_t field_count = split_fields(p, p->rest, out->nfields, max_fields);
+    if (field_count == (size_t)-1) return -1;
 
     out->fields = p->scratch;
     out->nfields = field_count;
@@ -161,4 +360,473 @@ int csv_find_column(const CsvRowView *header, const char *name, size_t *out_inde
         }
     }
     return -1; // Header not found
-}
\ No newline at end of file
+}
+
+/*
+64-bit FNV-1a over a NUL-terminated string.
+*/
+static uint64_t fnv1a(const char *s) {
+    uint64_t h = 14695981039346656037ULL;
+    for (; *s; s++) {
+        h ^= (unsigned char)*s;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+/*
+CsvHeaderIndex invariants:
+- ncols == 0 implies every owned pointer is NULL
+- ncols > 0 implies names, offsets, hashes and slots are non-NULL
+- the table holds more than 2 * ncols - 1 slots (load factor <= 1/2)
+- ndups == 0 iff first_dup == CSV_NO_COLUMN
+*/
+int csv_header_index_is_valid(const CsvHeaderIndex *idx) {
+    if (!idx) return 0;
+
+    if (idx->ncols == 0) {
+        if (idx->names || idx->offsets || idx->hashes || idx->slots) return 0;
+    } else {
+        if (!idx->names || !idx->offsets || !idx->hashes || !idx->slots) return 0;
+        if (idx->mask + 1 < 2 * idx->ncols) return 0;
+    }
+    if ((idx->ndups == 0) != (idx->first_dup == CSV_NO_COLUMN)) return 0;
+
+    return 1;
+}
+
+/*
+Probe for `name` (with precomputed hash `h`). Returns the table slot that
+holds it, or the empty slot where it would be inserted.
+*/
+static size_t index_probe(const CsvHeaderIndex *idx, const char *name, uint64_t h) {
+    size_t i = (size_t)h & idx->mask;
+    for (;;) {
+        size_t v = idx->slots[i];
+        if (v == 0) return i;
+
+        size_t col = v - 1;
+        if (idx->hashes[col] == h && strcmp(idx->names + idx->offsets[col], name) == 0) {
+            return i;
+        }
+        i = (i + 1) & idx->mask;
+    }
+}
+
+int csv_header_index_init(CsvHeaderIndex *idx, const CsvRowView *header) {
+    if (!idx) return -1;
+
+    idx->names = NULL;
+    idx->offsets = NULL;
+    idx->hashes = NULL;
+    idx->ncols = 0;
+    idx->slots = NULL;
+    idx->mask = 0;
+    idx->ndups = 0;
+    idx->first_dup = CSV_NO_COLUMN;
+
+    if (!header || (header->nfields > 0 && !header->fields)) return -1;
+    if (header->nfields == 0) return 0;
+
+    size_t n = header->nfields;
+    if (n > SIZE_MAX / 4) return -1;
+
+    size_t bytes = 0;
+    for (size_t i = 0; i < n; i++) {
+        size_t len = strlen(header->fields[i]) + 1;
+        if (bytes > SIZE_MAX - len) return -1;
+        bytes += len;
+    }
+
+    size_t tsize = 16;
+    while (tsize < 2 * n) tsize *= 2;
+
+    idx->names = csvstat_malloc(ALLOC_CSV_HEADER, bytes);
+    idx->offsets = csvstat_malloc(ALLOC_CSV_HEADER, n * sizeof *idx->offsets);
+    idx->hashes = csvstat_malloc(ALLOC_CSV_HEADER, n * sizeof *idx->hashes);
+    idx->slots = csvstat_calloc(ALLOC_CSV_HEADER, tsize, sizeof *idx->slots);
+    if (!idx->names || !idx->offsets || !idx->hashes || !idx->slots) {
+        csv_header_index_destroy(idx);
+        return -1;
+    }
+    idx->ncols = n;
+    idx->mask = tsize - 1;
+
+    size_t off = 0;
+    for (size_t i = 0; i < n; i++) {
+        const char *name = header->fields[i];
+        size_t len = strlen(name) + 1;
+
+        memcpy(idx->names + off, name, len);
+        idx->offsets[i] = off;
+        idx->hashes[i] = fnv1a(name);
+        off += len;
+
+        size_t slot = index_probe(idx, name, idx->hashes[i]);
+        if (idx->slots[slot] != 0) {
+            // Keep the first occurrence; remember that the name repeats.
+            if (idx->ndups == 0) idx->first_dup = i;
+            idx->ndups++;
+            continue;
+        }
+        idx->slots[slot] = i + 1;
+    }
+
+    CSVSTAT_ASSERT(csv_header_index_is_valid(idx));
+    return 0;
+}
+
+void csv_header_index_destroy(CsvHeaderIndex *idx) {
+    if (!idx) return;
+
+    csvstat_free(idx->names);
+    csvstat_free(idx->offsets);
+    csvstat_free(idx->hashes);
+    csvstat_free(idx->slots);
+
+    idx->names = NULL;
+    idx->offsets = NULL;
+    idx->hashes = NULL;
+    idx->slots = NULL;
+    idx->ncols = 0;
+    idx->mask = 0;
+    idx->ndups = 0;
+    idx->first_dup = CSV_NO_COLUMN;
+
+    CSVSTAT_ASSERT(csv_header_index_is_valid(idx));
+}
+
+const char *csv_header_index_name(const CsvHeaderIndex *idx, size_t i) {
+    if (!idx || i >= idx->ncols) return NULL;
+    return idx->names + idx->offsets[i];
+}
+
+int csv_header_index_find(const CsvHeaderIndex *idx, const char *name, size_t *out_index) {
+    if (!idx || !name || !out_index) return -1;
+    if (idx->ncols == 0) return -1;
+
+    CSVSTAT_ASSERT(csv_header_index_is_valid(idx));
+
+    size_t v = idx->slots[index_probe(idx, name, fnv1a(name))];
+    if (v == 0) return -1;
+
+    *out_index = v - 1;
+    return 0;
+}
+
+int csv_header_index_resolve(const CsvHeaderIndex *idx, const char *const *names, size_t n,
+                             size_t *out_indices) {
+    if (!idx || (n > 0 && (!names || !out_indices))) return -1;
+
+    int missing = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (csv_header_index_find(idx, names[i], &out_indices[i]) != 0) {
+            out_indices[i] = CSV_NO_COLUMN;
+            missing = 1;
+        }
+    }
+    return missing;
+}
+
+/*
+CsvBatch invariants:
+- ncols == 0 implies every owned pointer is NULL and cap == 0
+- ncols > 0 implies cols, slot_of, spans and row_off are non-NULL
+- nrows <= cap
+*/
+int csv_batch_is_valid(const CsvBatch *b) {
+    if (!b) return 0;
+
+    if (b->ncols == 0) {
+        if (b->cols || b->slot_of || b->spans || b->row_off || b->cap) return 0;
+    } else {
+        if (!b->cols || !b->slot_of || !b->spans || !b->row_off) return 0;
+    }
+    if (b->nrows > b->cap) return 0;
+
+    return 1;
+}
+
+int csv_batch_init(CsvBatch *b, const size_t *cols, size_t ncols, size_t cap) {
+    if (!b) return -1;
+
+    *b = (CsvBatch){0};
+    if (!cols || ncols == 0 || cap == 0) return -1;
+    if (ncols > SIZE_MAX / sizeof(CsvSpan) / cap) return -1;
+
+    size_t max_col = 0;
+    for (size_t i = 0; i < ncols; i++) {
+        if (cols[i] == CSV_NO_COLUMN) return -1;
+        if (cols[i] + 1 > max_col) max_col = cols[i] + 1;
+    }
+
+    b->cols = csvstat_malloc(ALLOC_CSV_BATCH, ncols * sizeof *b->cols);
+    b->slot_of = csvstat_malloc(ALLOC_CSV_BATCH, max_col * sizeof *b->slot_of);
+    b->spans = csvstat_malloc(ALLOC_CSV_BATCH, ncols * cap * sizeof *b->spans);
+    b->row_off = csvstat_malloc(ALLOC_CSV_BATCH, cap * sizeof *b->row_off);
+    if (!b->cols || !b->slot_of || !b->spans || !b->row_off) {
+        csvstat_free(b->cols);
+        csvstat_free(b->slot_of);
+        csvstat_free(b->spans);
+        csvstat_free(b->row_off);
+        *b = (CsvBatch){0};
+        return -1;
+    }
+
+    for (size_t c = 0; c < max_col; c++) b->slot_of[c] = CSV_NO_COLUMN;
+    for (size_t i = 0; i < ncols; i++) {
+        b->cols[i] = cols[i];
+        if (b->slot_of[cols[i]] == CSV_NO_COLUMN) b->slot_of[cols[i]] = i;
+    }
+
+    b->ncols = ncols;
+    b->max_col = max_col;
+    b->cap = cap;
+
+    CSVSTAT_ASSERT(csv_batch_is_valid(b));
+    return 0;
+}
+
+void csv_batch_destroy(CsvBatch *b) {
+    if (!b) return;
+
+    csvstat_free(b->cols);
+    csvstat_free(b->slot_of);
+    csvstat_free(b->spans);
+    csvstat_free(b->row_off);
+    *b = (CsvBatch){0};
+
+    CSVSTAT_ASSERT(csv_batch_is_valid(b));
+}
+
+/*
+Find the end of the record starting at `s` (the '\n' outside quotes), or
+NULL if the block ends first. Rows without '"' cost two memchr calls.
+*/
+static const char *record_end(const char *s, const char *end, int quotes) {
+    const char *nl = memchr(s, '\n', (size_t)(end - s));
+    if (!quotes) return nl;
+
+    const char *limit = nl ? nl : end;
+    if (!memchr(s, '"', (size_t)(limit - s))) return nl;
+
+    // Quote parity decides, as in LineReader: every '"' toggles the state.
+    int in_quotes = 0;
+    for (const char *q = s; q < end; q++) {
+        if (*q == '"') {
+            in_quotes = !in_quotes;
+        } else if (*q == '\n' && !in_quotes) {
+            return q;
+        }
+    }
+    return NULL;
+}
+
+/*
+One field of a read-only record, as located by `scan_field()`.
+*/
+typedef struct {
+    const char *ptr;   // field text (CsvSpan contents)
+    size_t len;
+    unsigned flags;    // 0 or CSV_SPAN_RAW (ptr/len then cover the raw field)
+    const char *next;  // first byte after the field (its delimiter, or end)
+} FieldScan;
+
+/*
+Locate the field starting at `r` in the record [r, end) without modifying
+it. Rules match `split_quoted()` / `split_plain()`: blanks around unquoted
+fields are trimmed, quoted content is kept as is, and a quoted field that
+contains "" or a non-blank tail after its closing quote is reported raw.
+*/
+static void scan_field(const CsvParser *p, const char *r, const char *end, FieldScan *fs) {
+    const char delim = p->delim;
+    const int tab_blank = (delim != '\t');
+
+    while (r < end && (*r == ' ' || (tab_blank && *r == '\t'))) r++;
+
+    if (p->quotes && r < end && *r == '"') {
+        // Quoted: content up to the closing quote; "" is an escaped quote.
+        const char *start = r;
+        const char *q = r + 1;
+        unsigned flags = 0;
+
+        while (q < end) {
+            if (*q == '"') {
+                if (q + 1 < end && q[1] == '"') {
+                    flags = CSV_SPAN_RAW;
+                    q += 2;
+                    continue;
+                }
+                break;
+            }
+            q++;
+        }
+        const char *content_end = q;
+        if (q < end) q++;  // closing quote
+
+        // Lenient tail after the closing quote, up to the delimiter.
+        const char *d = (q < end) ? memchr(q, delim, (size_t)(end - q)) : NULL;
+        const char *fend = d ? d : end;
+        for (const char *t = q; t < fend; t++) {
+            if (*t != ' ' && !(tab_blank && *t == '\t')) {
+                flags = CSV_SPAN_RAW;
+                break;
+            }
+        }
+
+        if (flags & CSV_SPAN_RAW) {
+            fs->ptr = start;
+            fs->len = (size_t)(fend - start);
+        } else {
+            fs->ptr = start + 1;
+            fs->len = (size_t)(content_end - (start + 1));
+        }
+        fs->flags = flags;
+        fs->next = fend;
+        return;
+    }
+
+    const char *d = (r < end) ? memchr(r, delim, (size_t)(end - r)) : NULL;
+    const char *fend = d ? d : end;
+    const char *content_end = fend;
+    while (content_end > r && (content_end[-1] == ' ' || (tab_blank && content_end[-1] == '\t'))) {
+        content_end--;
+    }
+
+    fs->ptr = r;
+    fs->len = (size_t)(content_end - r);
+    fs->flags = 0;
+    fs->next = fend;
+}
+
+/*
+Unescape a raw quoted field [r, end) (see CSV_SPAN_RAW) into `dst`, the way
+`split_quoted()` does: "" becomes ", the lenient tail is appended and only
+the tail's trailing blanks are trimmed. Writes at most `cap - 1` bytes plus
+a NUL (if cap > 0) and returns the full unescaped length.
+*/
+static size_t unquote_raw(const CsvParser *p, const char *r, const char *end,
+                          char *dst, size_t cap) {
+    const int tab_blank = (p->delim != '\t');
+    size_t n = 0;
+
+#define RAW_PUT(c)                           \
+    do {                                     \
+        if (n + 1 < cap) dst[n] = (c);       \
+        n++;                                 \
+    } while (0)
+
+    r++;  // opening quote
+    while (r < end) {
+        if (*r == '"') {
+            if (r + 1 < end && r[1] == '"') {
+                RAW_PUT('"');
+                r += 2;
+                continue;
+            }
+            r++;  // closing quote
+            break;
+        }
+        RAW_PUT(*r);
+        r++;
+    }
+    while (end > r && (end[-1] == ' ' || (tab_blank && end[-1] == '\t'))) end--;
+    for (; r < end; r++) RAW_PUT(*r);
+
+#undef RAW_PUT
+
+    if (dst && cap > 0) dst[n < cap ? n : cap - 1] = '\0';
+    return n;
+}
+
+/*
+Split the fields of one record [s, end) into row `row` of the batch, stopping
+after the last requested column.
+*/
+static void split_record_spans(const CsvParser *p, CsvBatch *b, size_t row,
+                               const char *base, const char *s, const char *end) {
+    for (size_t i = 0; i < b->ncols; i++) {
+        b->spans[i * b->cap + row] = (CsvSpan){ 0, 0, CSV_SPAN_MISSING };
+    }
+
+    size_t f = 0;
+    const char *r = s;
+
+    for (;;) {
+        FieldScan fs;
+        scan_field(p, r, end, &fs);
+
+        if (f < b->max_col && b->slot_of[f] != CSV_NO_COLUMN) {
+            CsvSpan *sp = &b->spans[b->slot_of[f] * b->cap + row];
+            *sp = (CsvSpan){ (size_t)(fs.ptr - base), fs.len, fs.flags };
+
+            // A column requested twice shares one slot in slot_of; fill the others too.
+            for (size_t i = b->slot_of[f] + 1; i < b->ncols; i++) {
+                if (b->cols[i] == f) b->spans[i * b->cap + row] = *sp;
+            }
+        }
+
+        f++;
+        if (f >= b->max_col || fs.next >= end) break;
+        r = fs.next + 1;
+    }
+}
+
+int csv_split_batch(const CsvParser *p, CsvBatch *b, const char *buf, size_t len,
+                    int at_eof, size_t *consumed) {
+    if (!p || !b || (!buf && len > 0) || !consumed || b->ncols == 0) return -1;
+
+    CSVSTAT_ASSERT(csv_batch_is_valid(b));
+
+    const char *s = buf;
+    const char *end = buf + len;
+    b->nrows = 0;
+
+    while (s < end && b->nrows < b->cap) {
+        const char *nl = record_end(s, end, p->quotes);
+        if (!nl && !at_eof) break;  // incomplete record: leave it for the next call
+
+        const char *rend = nl ? nl : end;
+        const char *next = nl ? nl + 1 : end;
+
+        // Strip a CRLF '\r', as LineReader does.
+        if (rend > s && rend[-1] == '\r') rend--;
+
+        // Skip blank records (spaces/tabs only).
+        const char *t = s;
+        while (t < rend && (*t == ' ' || *t == '\t')) t++;
+        if (t < rend) {
+            b->row_off[b->nrows] = (size_t)(s - buf);
+            split_record_spans(p, b, b->nrows, buf, s, rend);
+            b->nrows++;
+        }
+
+        s = next;
+    }
+
+    *consumed = (size_t)(s - buf);
+
+    CSVSTAT_ASSERT(csv_batch_is_valid(b));
+    return 0;
+}
+
+size_t csv_span_copy(const CsvParser *p, const char *buf, const CsvSpan *sp,
+                     char *dst, size_t cap) {
+    if (!p || !buf || !sp || (sp->flags & CSV_SPAN_MISSING)) {
+        if (dst && cap > 0) dst[0] = '\0';
+        return 0;
+    }
+
+    const char *r = buf + sp->off;
+
+    if (sp->flags & CSV_SPAN_RAW) {
+        return unquote_raw(p, r, r + sp->len, dst, cap);
+    }
+
+    if (dst && cap > 0) {
+        size_t n = (sp->len < cap) ? sp->len : cap - 1;
+        memcpy(dst, r, n);
+        dst[n] = '\0';
+    }
+    return sp->len;
+}
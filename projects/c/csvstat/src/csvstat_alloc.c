@@ -0,0 +1,208 @@
+#include "csvstat_alloc.h"
+
+#include <stdlib.h>     // malloc, calloc, realloc, free
+#include <stdint.h>     // SIZE_MAX
+#include <string.h>     // memset
+#include <errno.h>
+#include <stdalign.h>   // alignof
+#include <stdatomic.h>
+
+/*
+Block header, padded so the user pointer keeps malloc's alignment.
+*/
+typedef struct {
+    size_t size;
+    unsigned site;
+} AllocHead;
+
+#define ALLOC_ALIGN alignof(max_align_t)
+#define ALLOC_HEAD_SIZE ((sizeof(AllocHead) + ALLOC_ALIGN - 1) / ALLOC_ALIGN * ALLOC_ALIGN)
+
+typedef struct {
+    atomic_size_t allocs;
+    atomic_size_t reallocs;
+    atomic_size_t frees;
+    atomic_size_t steady;
+    atomic_size_t bytes_total;
+    atomic_size_t bytes_live;
+    atomic_size_t bytes_peak;
+} SiteCounters;
+
+static SiteCounters sites[ALLOC_NSITES];
+static atomic_size_t live_all;
+static atomic_size_t peak_all;
+
+static _Thread_local int steady_on = 0;
+
+static const char *const site_names[ALLOC_NSITES] = {
+    "line_reader", "csv_parser", "csv_batch", "csv_header", "scan", "expr",
+    "zonemap", "numparse", "source", "chunker", "progress", "checkpoint", "trace",
+    "diag", "corr",
+};
+
+static void raise_peak(atomic_size_t *peak, size_t v) {
+    size_t cur = atomic_load_explicit(peak, memory_order_relaxed);
+    while (v > cur &&
+           !atomic_compare_exchange_weak_explicit(peak, &cur, v, memory_order_relaxed,
+                                                  memory_order_relaxed)) {
+    }
+}
+
+static void add_live(SiteCounters *c, size_t n) {
+    size_t live = atomic_fetch_add_explicit(&c->bytes_live, n, memory_order_relaxed) + n;
+    raise_peak(&c->bytes_peak, live);
+    size_t all = atomic_fetch_add_explicit(&live_all, n, memory_order_relaxed) + n;
+    raise_peak(&peak_all, all);
+}
+
+static void sub_live(SiteCounters *c, size_t n) {
+    atomic_fetch_sub_explicit(&c->bytes_live, n, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&live_all, n, memory_order_relaxed);
+}
+
+static void bump(atomic_size_t *a, size_t n) {
+    atomic_fetch_add_explicit(a, n, memory_order_relaxed);
+}
+
+/*
+Account a new block of `n` bytes for `site` and return its user pointer.
+*/
+static void *track_new(AllocHead *h, AllocSite site, size_t n) {
+    SiteCounters *c = &sites[site];
+
+    h->size = n;
+    h->site = (unsigned)site;
+    bump(&c->allocs, 1);
+    bump(&c->bytes_total, n);
+    if (steady_on) bump(&c->steady, 1);
+    add_live(c, n);
+    return (char *)h + ALLOC_HEAD_SIZE;
+}
+
+static AllocHead *head_of(void *p) {
+    return (AllocHead *)(void *)((char *)p - ALLOC_HEAD_SIZE);
+}
+
+void *csvstat_malloc(AllocSite site, size_t n) {
+    if ((unsigned)site >= ALLOC_NSITES || n > SIZE_MAX - ALLOC_HEAD_SIZE) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    AllocHead *h = malloc(ALLOC_HEAD_SIZE + n);
+    if (!h) return NULL;
+    return track_new(h, site, n);
+}
+
+void *csvstat_calloc(AllocSite site, size_t count, size_t size) {
+    if ((unsigned)site >= ALLOC_NSITES ||
+        (size != 0 && count > (SIZE_MAX - ALLOC_HEAD_SIZE) / size)) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    size_t n = count * size;
+    AllocHead *h = calloc(1, ALLOC_HEAD_SIZE + n);
+    if (!h) return NULL;
+    return track_new(h, site, n);
+}
+
+void *csvstat_realloc(AllocSite site, void *p, size_t n) {
+    if (!p) return csvstat_malloc(site, n);
+    if (n > SIZE_MAX - ALLOC_HEAD_SIZE) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    AllocHead *h = head_of(p);
+    size_t old = h->size;
+    SiteCounters *c = &sites[h->site];
+
+    h = realloc(h, ALLOC_HEAD_SIZE + n);
+    if (!h) return NULL;
+    h->size = n;
+
+    bump(&c->reallocs, 1);
+    if (steady_on) bump(&c->steady, 1);
+    if (n > old) {
+        bump(&c->bytes_total, n - old);
+        add_live(c, n - old);
+    } else {
+        sub_live(c, old - n);
+    }
+    return (char *)h + ALLOC_HEAD_SIZE;
+}
+
+void csvstat_free(void *p) {
+    if (!p) return;
+
+    AllocHead *h = head_of(p);
+    SiteCounters *c = &sites[h->site];
+    bump(&c->frees, 1);
+    sub_live(c, h->size);
+    free(h);
+}
+
+void csvstat_alloc_steady(int on) {
+    steady_on = on;
+}
+
+void csvstat_alloc_site(AllocSite site, AllocCounters *out) {
+    if (!out) return;
+    memset(out, 0, sizeof *out);
+    if ((unsigned)site >= ALLOC_NSITES) return;
+
+    const SiteCounters *c = &sites[site];
+    out->allocs = atomic_load_explicit(&c->allocs, memory_order_relaxed);
+    out->reallocs = atomic_load_explicit(&c->reallocs, memory_order_relaxed);
+    out->frees = atomic_load_explicit(&c->frees, memory_order_relaxed);
+    out->steady = atomic_load_explicit(&c->steady, memory_order_relaxed);
+    out->bytes_total = atomic_load_explicit(&c->bytes_total, memory_order_relaxed);
+    out->bytes_live = atomic_load_explicit(&c->bytes_live, memory_order_relaxed);
+    out->bytes_peak = atomic_load_explicit(&c->bytes_peak, memory_order_relaxed);
+}
+
+void csvstat_alloc_total(AllocCounters *out) {
+    if (!out) return;
+    memset(out, 0, sizeof *out);
+
+    for (int s = 0; s < ALLOC_NSITES; s++) {
+        AllocCounters c;
+        csvstat_alloc_site((AllocSite)s, &c);
+        out->allocs += c.allocs;
+        out->reallocs += c.reallocs;
+        out->frees += c.frees;
+        out->steady += c.steady;
+        out->bytes_total += c.bytes_total;
+        out->bytes_live += c.bytes_live;
+    }
+    out->bytes_peak = atomic_load_explicit(&peak_all, memory_order_relaxed);
+}
+
+const char *csvstat_alloc_site_name(AllocSite site) {
+    return (unsigned)site < ALLOC_NSITES ? site_names[site] : "?";
+}
+
+void csvstat_alloc_report(FILE *out, size_t warmup_rows, size_t rows) {
+    if (!out) return;
+
+    fprintf(out, "%-12s %9s %9s %9s %9s %14s %12s\n",
+            "site", "allocs", "reallocs", "frees", "steady", "bytes", "peak_bytes");
+    for (int s = 0; s < ALLOC_NSITES; s++) {
+        AllocCounters c;
+        csvstat_alloc_site((AllocSite)s, &c);
+        if (c.allocs == 0) continue;  // structure not used by this run
+
+        fprintf(out, "%-12s %9zu %9zu %9zu %9zu %14zu %12zu\n", site_names[s],
+                c.allocs, c.reallocs, c.frees, c.steady, c.bytes_total, c.bytes_peak);
+    }
+
+    AllocCounters t;
+    csvstat_alloc_total(&t);
+    fprintf(out, "alloc_count: %zu\n", t.allocs);
+    fprintf(out, "alloc_reallocs: %zu\n", t.reallocs);
+    fprintf(out, "alloc_peak_bytes: %zu\n", t.bytes_peak);
+    fprintf(out, "alloc_live_bytes: %zu\n", t.bytes_live);
+    fprintf(out, "allocs_per_row: %.9f\n",
+            rows ? (double)(t.allocs + t.reallocs) / (double)rows : 0.0);
+    fprintf(out, "alloc_warmup_rows: %zu\n", warmup_rows);
+    fprintf(out, "alloc_steady: %zu\n", t.steady);
+}
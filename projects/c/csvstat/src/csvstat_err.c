@@ -8,6 +8,7 @@ const char *csvstat_err_str(CsvStatErr e) {
         case CSVSTAT_EFORMAT:   return "invalid CSV format";
         case CSVSTAT_ENOCOL:    return "column not found";
         case CSVSTAT_ENOMEM:    return "out of memory";
+        case CSVSTAT_EOVERFLOW: return "exact sum overflows 128 bits";
         case CSVSTAT_EINTERNAL: return "internal error";
         default:                return "unknown error";
     }
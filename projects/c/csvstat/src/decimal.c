@@ -0,0 +1,233 @@
+#include "decimal.h"
+
+#include <math.h>   // sqrtl
+
+static const uint64_t pow10_u64[20] = {
+    1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull,
+    100000000ull, 1000000000ull, 10000000000ull, 100000000000ull, 1000000000000ull,
+    10000000000000ull, 100000000000000ull, 1000000000000000ull, 10000000000000000ull,
+    100000000000000000ull, 1000000000000000000ull, 10000000000000000000ull,
+};
+
+/*
+m = m * 10 + d. Returns 0 (and leaves m alone) if that would overflow.
+*/
+static int push_digit(uint64_t *m, unsigned d) {
+    if (*m > (UINT64_MAX - d) / 10) return 0;
+    *m = *m * 10 + d;
+    return 1;
+}
+
+int decimal_parse(const char *s, size_t len, unsigned scale, int64_t *out) {
+    if (!s || !out || scale > DECIMAL_MAX_SCALE) return -1;
+
+    const char *p = s;
+    const char *end = s + len;
+
+    // Trailing spaces/tabs are allowed, as for parse_double_strict().
+    while (end > p && (end[-1] == ' ' || end[-1] == '\t')) end--;
+
+    int neg = 0;
+    if (p < end && (*p == '-' || *p == '+')) {
+        neg = (*p == '-');
+        p++;
+    }
+
+    uint64_t m = 0;
+    int fits = 1;       // m has not overflowed
+    int any = 0;        // at least one digit seen
+    long frac = 0;      // fractional digits in m
+    long zeros = 0;     // fractional zeros not yet in m (trailing ones never are)
+
+    for (; p < end && *p >= '0' && *p <= '9'; p++) {
+        any = 1;
+        fits &= push_digit(&m, (unsigned)(*p - '0'));
+    }
+    if (p < end && *p == '.') {
+        p++;
+        for (; p < end && *p >= '0' && *p <= '9'; p++) {
+            any = 1;
+            if (*p == '0') {
+                zeros++;
+                continue;
+            }
+            for (; zeros > 0 && fits; zeros--, frac++) fits &= push_digit(&m, 0);
+            fits &= push_digit(&m, (unsigned)(*p - '0'));
+            frac++;
+        }
+    }
+    if (!any) return -1;
+
+    long exp10 = 0;
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        int eneg = 0;
+        if (p < end && (*p == '-' || *p == '+')) {
+            eneg = (*p == '-');
+            p++;
+        }
+        if (p >= end || *p < '0' || *p > '9') return -1;
+        for (; p < end && *p >= '0' && *p <= '9'; p++) {
+            if (exp10 < 100000) exp10 = exp10 * 10 + (*p - '0');
+        }
+        if (eneg) exp10 = -exp10;
+    }
+    if (p != end) return -1;
+
+    if (!fits) return -2;
+    if (m == 0) {
+        *out = 0;
+        return 0;
+    }
+
+    // value = m * 10^shift units; m < 10^20, so |shift| >= 20 never fits.
+    long shift = (long)scale - frac + exp10;
+    if (shift <= -20 || shift >= 20) return -2;
+    if (shift < 0) {
+        uint64_t p10 = pow10_u64[-shift];
+        if (m % p10 != 0) return -2;
+        m /= p10;
+    } else if (shift > 0) {
+        uint64_t p10 = pow10_u64[shift];
+        if (m > UINT64_MAX / p10) return -2;
+        m *= p10;
+    }
+    if (m > (uint64_t)INT64_MAX) return -2;
+
+    *out = neg ? -(int64_t)m : (int64_t)m;
+    return 0;
+}
+
+void decimal_stats_init(DecStats *d) {
+    if (!d) return;
+    d->n = 0;
+    d->min = 0;
+    d->max = 0;
+    d->sum = 0;
+    d->sumsq = 0;
+}
+
+int decimal_stats_push(DecStats *d, int64_t v) {
+    if (!d || d->n == (size_t)-1) return -1;
+
+    dec128 sum;
+    udec128 sumsq;
+    udec128 sq = (udec128)((dec128)v * v);  // < 2^126
+    if (__builtin_add_overflow(d->sum, (dec128)v, &sum)) return -1;
+    if (__builtin_add_overflow(d->sumsq, sq, &sumsq)) return -1;
+
+    if (d->n == 0 || v < d->min) d->min = v;
+    if (d->n == 0 || v > d->max) d->max = v;
+    d->n++;
+    d->sum = sum;
+    d->sumsq = sumsq;
+    return 0;
+}
+
+int decimal_stats_merge(DecStats *dst, const DecStats *src) {
+    if (!dst || !src) return -1;
+    if (src->n == 0) return 0;
+    if (dst->n == 0) {
+        *dst = *src;
+        return 0;
+    }
+
+    dec128 sum;
+    udec128 sumsq;
+    if (dst->n > (size_t)-1 - src->n) return -1;
+    if (__builtin_add_overflow(dst->sum, src->sum, &sum)) return -1;
+    if (__builtin_add_overflow(dst->sumsq, src->sumsq, &sumsq)) return -1;
+
+    if (src->min < dst->min) dst->min = src->min;
+    if (src->max > dst->max) dst->max = src->max;
+    dst->n += src->n;
+    dst->sum = sum;
+    dst->sumsq = sumsq;
+    return 0;
+}
+
+int decimal_stats_mean(const DecStats *d, dec128 *out) {
+    if (!d || !out) return -1;
+    if (d->n == 0) {
+        *out = 0;
+        return -1;
+    }
+
+    // Long division of |sum| by n, digit by digit past the scale. The
+    // quotient is at most max |v| * 10^DECIMAL_MEAN_DIGITS and r < n, so
+    // nothing overflows.
+    udec128 n = d->n;
+    int neg = d->sum < 0;
+    udec128 a = neg ? -(udec128)d->sum : (udec128)d->sum;
+    udec128 q = a / n;
+    udec128 r = a % n;
+    for (int i = 0; i < DECIMAL_MEAN_DIGITS; i++) {
+        r *= 10;
+        q = q * 10 + r / n;
+        r %= n;
+    }
+    if (2 * r > n || (2 * r == n && (q & 1))) q++;
+
+    *out = neg ? -(dec128)q : (dec128)q;
+    return 0;
+}
+
+int decimal_stats_stddev(const DecStats *d, unsigned scale, double *out) {
+    if (!d || !out) return -1;
+    if (d->n < 2) {
+        *out = 0.0;
+        return -1;
+    }
+
+    // m2 = sumsq - sum^2/n. With |sum| = q*n + r that is
+    // sumsq - (q*q*n + 2*q*r) - r*r/n: the subtracted integer part is at
+    // most sum^2/n <= sumsq (Cauchy-Schwarz), so it is computed exactly,
+    // and only r*r/n < n is fractional.
+    udec128 n = d->n;
+    udec128 a = d->sum < 0 ? -(udec128)d->sum : (udec128)d->sum;
+    udec128 q = a / n;
+    udec128 r = a % n;
+    udec128 m2i = d->sumsq - (q * q * n + 2 * q * r);
+
+    long double m2 = (long double)m2i - (long double)r * (long double)r / (long double)n;
+    if (m2 < 0.0L) m2 = 0.0L;
+    long double unit = (long double)pow10_u64[scale];  // exact: 10^18 < 2^64
+    *out = (double)(sqrtl(m2 / (long double)(n - 1)) / unit);
+    return 0;
+}
+
+void decimal_stats_to_stats(const DecStats *d, unsigned scale, Stats *out) {
+    if (!d || !out) return;
+
+    stats_init(out);
+    if (d->n == 0) return;
+
+    long double unit = (long double)pow10_u64[scale];
+    out->n = d->n;
+    out->min = (double)((long double)d->min / unit);
+    out->max = (double)((long double)d->max / unit);
+    out->mean = (double)((long double)d->sum / (long double)d->n / unit);
+    double sd = 0.0;
+    if (decimal_stats_stddev(d, scale, &sd) == 0) out->m2 = sd * sd * (double)(d->n - 1);
+}
+
+void decimal_print(FILE *out, dec128 v, unsigned scale) {
+    if (!out) return;
+
+    // 2^127 has 39 digits; keep room for the leading "0." of small values.
+    char buf[64];
+    size_t i = sizeof buf;
+    udec128 a = v < 0 ? -(udec128)v : (udec128)v;
+    unsigned digits = 0;
+
+    buf[--i] = '\0';
+    do {
+        if (digits == scale && scale > 0) buf[--i] = '.';
+        buf[--i] = (char)('0' + (int)(a % 10));
+        a /= 10;
+        digits++;
+    } while (a != 0 || digits <= scale);
+    if (v < 0) buf[--i] = '-';
+
+    fputs(buf + i, out);
+}
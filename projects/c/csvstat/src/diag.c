@@ -0,0 +1,447 @@
+#define _POSIX_C_SOURCE 200809L  // fileno(), fsync(), ftruncate(), fseeko()
+
+#include "diag.h"
+#include "csvstat_alloc.h"
+
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>  // fsync, ftruncate
+
+#define NO_CHUNK ((size_t)-1)  // SCAN_NO_CHUNK
+
+static const char *const kind_names[DIAG_NKINDS] = {
+    "invalid_number", "missing_column", "not_finite", "not_exact",
+};
+
+/*
+xorshift64*: the reservoir only needs cheap, reproducible draws.
+*/
+static uint64_t next_rand(uint64_t *s) {
+    uint64_t x = *s;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *s = x;
+    return x * 0x2545F4914F6CDD1Dull;
+}
+
+void diag_init(Diag *d, DiagRejects *rejects, uint64_t seed) {
+    if (!d) return;
+
+    *d = (Diag){0};
+    d->rejects = rejects;
+    d->rng = (seed ^ 0x9E3779B97F4A7C15ull) | 1;  // xorshift needs a nonzero state
+}
+
+void diag_destroy(Diag *d) {
+    if (!d) return;
+
+    csvstat_free(d->rbuf);
+    d->rbuf = NULL;
+    d->rlen = 0;
+    d->rcap = 0;
+}
+
+void diag_restore(Diag *d, const Diag *saved) {
+    if (!d || !saved) return;
+
+    DiagRejects *rejects = d->rejects;
+    char *rbuf = d->rbuf;
+    size_t rlen = d->rlen, rcap = d->rcap;
+
+    *d = *saved;
+    d->rejects = rejects;
+    d->rbuf = rbuf;
+    d->rlen = rlen;
+    d->rcap = rcap;
+}
+
+static void set_example(DiagExample *e, DiagKind kind, size_t chunk, size_t row_no,
+                        const char *text, size_t len) {
+    e->kind = kind;
+    e->chunk = chunk;
+    e->row_no = row_no;
+    e->len = text ? len : 0;
+    if (e->len) memcpy(e->text, text, e->len < DIAG_TEXT_MAX ? e->len : DIAG_TEXT_MAX);
+}
+
+void diag_add(Diag *d, DiagKind kind, size_t chunk, size_t row_no, const char *text, size_t len) {
+    d->count[kind]++;
+    d->total++;
+
+    if (d->nfirst < DIAG_FIRST) {
+        set_example(&d->first[d->nfirst++], kind, chunk, row_no, text, len);
+        return;
+    }
+
+    // Algorithm R: the n-th candidate replaces a random slot with
+    // probability DIAG_SAMPLE / n.
+    size_t n = ++d->sampled;
+    if (d->nsample < DIAG_SAMPLE) {
+        set_example(&d->sample[d->nsample++], kind, chunk, row_no, text, len);
+        return;
+    }
+    uint64_t j = next_rand(&d->rng) % n;
+    if (j < DIAG_SAMPLE) set_example(&d->sample[j], kind, chunk, row_no, text, len);
+}
+
+static void rejects_fail(DiagRejects *rj, int errnum) {
+    pthread_mutex_lock(&rj->lock);
+    if (!rj->failed) {
+        rj->failed = 1;
+        rj->saved_errno = errnum;
+    }
+    pthread_mutex_unlock(&rj->lock);
+}
+
+void diag_flush(Diag *d) {
+    if (!d || !d->rejects || d->rlen == 0) return;
+
+    DiagRejects *rj = d->rejects;
+    pthread_mutex_lock(&rj->lock);
+    if (!rj->failed && fwrite(d->rbuf, 1, d->rlen, rj->out) != d->rlen) {
+        rj->failed = 1;
+        rj->saved_errno = errno ? errno : EIO;
+    }
+    pthread_mutex_unlock(&rj->lock);
+    d->rlen = 0;
+}
+
+/*
+Make room for `n` more bytes in the reject buffer, writing out the rows
+queued so far if they do not leave enough. Rows are always queued whole,
+so concurrent states never interleave within a row.
+Returns 0 on success, -1 on allocation failure (recorded in the DiagRejects).
+*/
+static int reserve(Diag *d, size_t n) {
+    if (d->rcap - d->rlen >= n) return 0;
+
+    diag_flush(d);
+    if (n <= d->rcap) return 0;
+
+    size_t cap = n > DIAG_REJECT_BUF ? n : DIAG_REJECT_BUF;
+    char *tmp = csvstat_realloc(ALLOC_DIAG, d->rbuf, cap);
+    if (!tmp) {
+        rejects_fail(d->rejects, ENOMEM);
+        return -1;
+    }
+    d->rbuf = tmp;
+    d->rcap = cap;
+    return 0;
+}
+
+/*
+Queue the end of a row; a full buffer is written right away.
+*/
+static void end_row(Diag *d) {
+    d->rbuf[d->rlen++] = '\n';
+    if (d->rlen >= DIAG_REJECT_BUF) diag_flush(d);
+}
+
+void diag_reject_raw(Diag *d, const char *row, size_t len) {
+    if (!d->rejects || d->rejects->failed) return;
+
+    // Blank lines skipped after the row belong to its byte range.
+    while (len > 0 && (row[len - 1] == '\n' || row[len - 1] == '\r' ||
+                       row[len - 1] == ' ' || row[len - 1] == '\t')) {
+        len--;
+    }
+    if (len == SIZE_MAX || reserve(d, len + 1) != 0) return;
+
+    memcpy(d->rbuf + d->rlen, row, len);
+    d->rlen += len;
+    end_row(d);
+}
+
+/*
+Copy field `f` to `w` and return the end of the copy. A field that would
+not read back as one field is written quoted, with each '"' doubled.
+*/
+static char *put_field(const DiagRejects *rj, char *w, const char *f) {
+    char *start = w;
+    int special = 0;
+
+    for (const char *r = f; *r; r++) {
+        char c = *r;
+        special |= (c == rj->delim || c == '"' || c == '\n' || c == '\r');
+        *w++ = c;
+    }
+    if (!special || !rj->quotes) return w;
+
+    w = start;
+    *w++ = '"';
+    for (; *f; f++) {
+        if (*f == '"') *w++ = '"';
+        *w++ = *f;
+    }
+    *w++ = '"';
+    return w;
+}
+
+void diag_reject_fields(Diag *d, const CsvRowView *row, const char *rest) {
+    if (!d->rejects || d->rejects->failed) return;
+
+    size_t need = 1;  // '\n'
+    for (size_t i = 0; i < row->nfields; i++) {
+        need += 2 * strlen(row->fields[i]) + 3;  // doubled '"', quotes, delimiter
+    }
+    if (rest) need += strlen(rest) + 1;
+    if (reserve(d, need) != 0) return;
+
+    char *w = d->rbuf + d->rlen;
+    for (size_t i = 0; i < row->nfields; i++) {
+        if (i > 0) *w++ = d->rejects->delim;
+        w = put_field(d->rejects, w, row->fields[i]);
+    }
+    if (rest) {
+        // Not split yet, so still in the input's own encoding.
+        size_t n = strlen(rest);
+        if (row->nfields > 0) *w++ = d->rejects->delim;
+        memcpy(w, rest, n);
+        w += n;
+    }
+    d->rlen = (size_t)(w - d->rbuf);
+    end_row(d);
+}
+
+/*
+Draw a uniform sample of min(DIAG_SAMPLE, pa + pb) rejects into `out` from
+two disjoint groups: `a[0..na)` is a uniform sample of the `pa` rejects of
+the first, `b[0..nb)` of the `pb` of the second (na = min(DIAG_SAMPLE, pa),
+or all of them). Each draw picks a group with probability proportional to
+the rejects it has left, then one of its examples at random. Returns the
+sample size.
+*/
+static size_t merge_samples(DiagExample *out, DiagExample *a, size_t na, size_t pa,
+                            DiagExample *b, size_t nb, size_t pb, uint64_t *rng) {
+    size_t n = 0;
+    while (n < DIAG_SAMPLE && pa + pb > 0) {
+        int from_a = next_rand(rng) % (pa + pb) < pa;
+        DiagExample *e = from_a ? a : b;
+        size_t *ne = from_a ? &na : &nb;
+        size_t j = (size_t)(next_rand(rng) % *ne);
+
+        out[n++] = e[j];
+        e[j] = e[--*ne];
+        if (from_a) {
+            pa--;
+        } else {
+            pb--;
+        }
+    }
+    return n;
+}
+
+void diag_merge(Diag *dst, const Diag *src) {
+    if (!dst || !src) return;
+
+    for (int k = 0; k < DIAG_NKINDS; k++) dst->count[k] += src->count[k];
+    dst->total += src->total;
+
+    // The first rejects of `src` follow those of `dst`; the ones that no
+    // longer fit join the candidates for the sample.
+    size_t i = 0;
+    while (i < src->nfirst && dst->nfirst < DIAG_FIRST) dst->first[dst->nfirst++] = src->first[i++];
+
+    DiagExample left[DIAG_FIRST], theirs[DIAG_SAMPLE], ours[DIAG_SAMPLE], both[DIAG_SAMPLE];
+    size_t nleft = src->nfirst - i;
+    memcpy(left, src->first + i, nleft * sizeof *left);
+    memcpy(theirs, src->sample, src->nsample * sizeof *theirs);
+    memcpy(ours, dst->sample, dst->nsample * sizeof *ours);
+
+    size_t nb = merge_samples(both, left, nleft, nleft, theirs, src->nsample, src->sampled, &dst->rng);
+    size_t pb = nleft + src->sampled;
+    dst->nsample = merge_samples(dst->sample, ours, dst->nsample, dst->sampled, both, nb, pb, &dst->rng);
+    dst->sampled += pb;
+}
+
+/*
+One example as a warning line, e.g. "Row 4: invalid number '-'".
+*/
+static void report_example(FILE *out, const DiagExample *e, const char *col_name) {
+    fputs("  ", out);
+    if (e->chunk == NO_CHUNK) {
+        fprintf(out, "Row %zu: ", e->row_no);
+    } else {
+        fprintf(out, "Chunk %zu row %zu: ", e->chunk, e->row_no);
+    }
+
+    int n = e->len < DIAG_TEXT_MAX ? (int)e->len : DIAG_TEXT_MAX;
+    switch (e->kind) {
+        case DIAG_INVALID_NUMBER:
+            fprintf(out, "invalid number '%.*s%s'\n", n, e->text, e->len > DIAG_TEXT_MAX ? "..." : "");
+            break;
+        case DIAG_MISSING_COLUMN:
+            if (col_name) {
+                fprintf(out, "missing column %s\n", col_name);
+            } else {
+                fprintf(out, "missing column for expression\n");
+            }
+            break;
+        case DIAG_NOT_EXACT:
+            fprintf(out, "'%.*s%s' does not fit --decimal exactly\n", n, e->text,
+                    e->len > DIAG_TEXT_MAX ? "..." : "");
+            break;
+        default:
+            fprintf(out, "expression is not a finite number\n");
+            break;
+    }
+}
+
+/*
+Return 1 if `a` comes after `b` in the file (chunks are in file order).
+*/
+static int example_after(const DiagExample *a, const DiagExample *b) {
+    if (a->chunk != b->chunk) return a->chunk != NO_CHUNK && a->chunk > b->chunk;
+    return a->row_no > b->row_no;
+}
+
+/*
+Print `e[0..n)` in file order. Buffered --expr rows are rejected when their
+batch is evaluated, after rows rejected while splitting.
+*/
+static void report_examples(FILE *out, const DiagExample *e, size_t n, const char *col_name) {
+    const DiagExample *order[DIAG_FIRST > DIAG_SAMPLE ? DIAG_FIRST : DIAG_SAMPLE];
+    for (size_t i = 0; i < n; i++) {
+        size_t j = i;
+        while (j > 0 && example_after(order[j - 1], &e[i])) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = &e[i];
+    }
+    for (size_t i = 0; i < n; i++) report_example(out, order[i], col_name);
+}
+
+void diag_report(FILE *out, const Diag *d, const char *col_name) {
+    if (!out || !d || d->total == 0) return;
+
+    fprintf(out, "csvstat: %zu rejected row%s (", d->total, d->total == 1 ? "" : "s");
+    const char *sep = "";
+    for (int k = 0; k < DIAG_NKINDS; k++) {
+        if (d->count[k] == 0) continue;
+        fprintf(out, "%s%s: %zu", sep, kind_names[k], d->count[k]);
+        sep = ", ";
+    }
+    fprintf(out, ")\n");
+
+    report_examples(out, d->first, d->nfirst, col_name);
+    if (d->sampled > d->nsample) {
+        fprintf(out, "  sample of the other %zu:\n", d->sampled);
+    }
+    report_examples(out, d->sample, d->nsample, col_name);
+}
+
+const char *diag_kind_name(DiagKind kind) {
+    return (unsigned)kind < DIAG_NKINDS ? kind_names[kind] : "?";
+}
+
+int diag_rejects_open(DiagRejects *rj, const char *path, const CsvRowView *header,
+                      char delim, int quotes) {
+    if (!rj || !path || !header) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    *rj = (DiagRejects){0};
+    rj->delim = delim;
+    rj->quotes = quotes;
+    rj->out = fopen(path, "w");
+    if (!rj->out) return -1;
+    pthread_mutex_init(&rj->lock, NULL);
+
+    Diag d;
+    diag_init(&d, rj, 0);
+    diag_reject_fields(&d, header, NULL);
+    diag_flush(&d);
+    diag_destroy(&d);
+
+    if (rj->failed) {
+        int errnum = rj->saved_errno;
+        diag_rejects_close(rj);
+        errno = errnum;
+        return -1;
+    }
+    return 0;
+}
+
+int diag_rejects_resume(DiagRejects *rj, const char *path, unsigned long long offset,
+                        char delim, int quotes) {
+    if (!rj || !path) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    *rj = (DiagRejects){0};
+    rj->delim = delim;
+    rj->quotes = quotes;
+    rj->out = fopen(path, "r+");
+    if (!rj->out) return (errno == ENOENT) ? 1 : -1;
+
+    int errnum = 0;
+
+    // Rows written after the checkpoint are rejected again by the resumed
+    // scan, so the file is cut back to the length it had then.
+    if (fseeko(rj->out, 0, SEEK_END) != 0) goto fail;
+    off_t size = ftello(rj->out);
+    if (size < 0) goto fail;
+    if ((unsigned long long)size < offset) {
+        fclose(rj->out);
+        rj->out = NULL;
+        return 1;
+    }
+    if (ftruncate(fileno(rj->out), (off_t)offset) != 0) goto fail;
+    if (fseeko(rj->out, (off_t)offset, SEEK_SET) != 0) goto fail;
+
+    pthread_mutex_init(&rj->lock, NULL);
+    return 0;
+
+fail:
+    errnum = errno;
+    fclose(rj->out);
+    rj->out = NULL;
+    errno = errnum;
+    return -1;
+}
+
+int diag_rejects_sync(DiagRejects *rj, unsigned long long *offset) {
+    if (!rj || !rj->out || !offset) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    int rc = 0;
+    pthread_mutex_lock(&rj->lock);
+    if (rj->failed) {
+        rc = -1;
+        errno = rj->saved_errno ? rj->saved_errno : EIO;
+    } else if (fflush(rj->out) != 0 || fsync(fileno(rj->out)) != 0) {
+        rc = -1;
+    } else {
+        off_t at = ftello(rj->out);
+        if (at < 0) {
+            rc = -1;
+        } else {
+            *offset = (unsigned long long)at;
+        }
+    }
+    pthread_mutex_unlock(&rj->lock);
+    return rc;
+}
+
+int diag_rejects_close(DiagRejects *rj) {
+    if (!rj || !rj->out) return 0;
+
+    int rc = 0;
+    int errnum = rj->saved_errno;
+    if (rj->failed || ferror(rj->out)) rc = -1;
+    if (fclose(rj->out) != 0 && rc == 0) {
+        rc = -1;
+        errnum = errno;
+    }
+    pthread_mutex_destroy(&rj->lock);
+    rj->out = NULL;
+
+    if (rc != 0) errno = errnum ? errnum : EIO;
+    return rc;
+}
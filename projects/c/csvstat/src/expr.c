@@ -0,0 +1,1136 @@
+#include "expr.h"
+#include "numparse.h"
+#include "csvstat_assert.h"
+#include "csvstat_alloc.h"
+
+#include <stdio.h>   // snprintf
+#include <stdlib.h>  // strtod
+#include <string.h>  // memcpy, strcmp, strlen
+#include <stdint.h>  // SIZE_MAX
+#include <ctype.h>   // isdigit, isalpha, isalnum
+#include <math.h>    // NAN, INFINITY, isnan
+
+/*
+Implementation notes
+--------------------
+Compilation happens in two steps:
+1. A recursive-descent parser builds a small AST in a node pool. Column names
+   are resolved to indices and unary minus on literals is folded.
+2. Code generation walks the AST and emits flat stack-machine bytecode.
+   `&&` / `||` become conditional jumps so the right-hand side is skipped
+   (and its cells never converted) when the left-hand side decides the row.
+
+Evaluation is a single switch loop over the bytecode with a preallocated
+value stack; it performs no allocation.
+
+Vector mode (EXPR_VECTOR) emits straight-line code instead: `&&`, `||` and
+`?:` evaluate both sides and combine them elementwise, so every opcode is a
+tight loop over a batch of up to EXPR_BATCH rows stored column by column.
+*/
+
+typedef enum {
+    OP_CONST,    // push imm
+    OP_LOAD,     // push numeric value of column slot `arg` (NaN if missing/invalid)
+    OP_STREQ,    // push (cell of slot `arg` == strs[arg2])
+    OP_STRNE,    // push (cell of slot `arg` != strs[arg2])
+    OP_NEG,
+    OP_NOT,
+    OP_BOOL,     // normalize top of stack to 0/1
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_DIV,
+    OP_LT,
+    OP_LE,
+    OP_GT,
+    OP_GE,
+    OP_EQ,
+    OP_NE,
+    OP_ABS,
+    OP_LOG,
+    OP_SQRT,
+    OP_EXP,
+    OP_JZ_KEEP,  // if top is false jump to `arg`, keeping top
+    OP_JNZ_KEEP, // if top is true jump to `arg`, keeping top
+    OP_JZ,       // pop; if it was false jump to `arg`
+    OP_JMP,      // jump to `arg`
+    OP_POP,
+    OP_AND,      // vector mode: elementwise logical and (no short-circuit)
+    OP_OR,       // vector mode: elementwise logical or
+    OP_SELECT,   // vector mode: c ? a : b over the top three values
+} ExprOp;
+
+typedef enum {
+    T_EOF,
+    T_NUM,
+    T_STR,
+    T_IDENT,
+    T_LP,
+    T_RP,
+    T_PLUS,
+    T_MINUS,
+    T_STAR,
+    T_SLASH,
+    T_LT,
+    T_LE,
+    T_GT,
+    T_GE,
+    T_EQ,
+    T_NE,
+    T_AND,
+    T_OR,
+    T_NOT,
+    T_QUEST,
+    T_COLON,
+} TokKind;
+
+typedef enum {
+    N_NUM,
+    N_STR,
+    N_COL,
+    N_UNARY,
+    N_BINARY,
+    N_CALL,
+    N_COND,
+} NodeKind;
+
+typedef struct {
+    NodeKind kind;
+    TokKind op;     // operator token for unary/binary nodes
+    ExprOp fn;      // N_CALL function opcode
+    size_t a, b, c; // child node indices (N_COND: a ? b : c)
+    double num;     // N_NUM value
+    size_t idx;     // N_COL column index, N_STR string index
+} Node;
+
+typedef struct {
+    const char *src;
+    const char *p;             // next unread character
+    const CsvHeaderIndex *header;
+    ExprProgram *prog;
+
+    Node *nodes;               // owned node pool (freed after compile)
+    size_t nnodes;
+    size_t cap;
+
+    TokKind tok;               // current token
+    const char *tok_start;
+    double tok_num;
+    char *tok_text;            // owned decoded identifier/string text
+
+    char *err;
+    size_t errcap;
+    int failed;
+} Parser;
+
+static void fail(Parser *ps, const char *msg) {
+    if (ps->failed) return;  // keep the first error
+    ps->failed = 1;
+    if (ps->err && ps->errcap > 0) {
+        size_t off = (size_t)((ps->tok_start ? ps->tok_start : ps->p) - ps->src);
+        snprintf(ps->err, ps->errcap, "%s at offset %zu", msg, off);
+    }
+}
+
+static char *dup_range(const char *s, size_t n) {
+    char *d = (char *)csvstat_malloc(ALLOC_EXPR, n + 1);
+    if (!d) return NULL;
+    memcpy(d, s, n);
+    d[n] = '\0';
+    return d;
+}
+
+// ---- Tokenizer ----
+
+static void next_token(Parser *ps) {
+    csvstat_free(ps->tok_text);
+    ps->tok_text = NULL;
+
+    while (*ps->p == ' ' || *ps->p == '\t') ps->p++;
+
+    const char *s = ps->p;
+    ps->tok_start = s;
+
+    if (*s == '\0') {
+        ps->tok = T_EOF;
+        return;
+    }
+
+    // Number literal: digits or '.' followed by a digit.
+    if (isdigit((unsigned char)s[0]) || (s[0] == '.' && isdigit((unsigned char)s[1]))) {
+        char *end = NULL;
+        ps->tok_num = strtod(s, &end);
+        if (end == s || !isfinite(ps->tok_num)) {
+            fail(ps, "invalid number");
+            ps->tok = T_EOF;
+            return;
+        }
+        ps->p = end;
+        ps->tok = T_NUM;
+        return;
+    }
+
+    // String literal: "..." or '...', with backslash escapes.
+    if (s[0] == '"' || s[0] == '\'') {
+        char q = s[0];
+        size_t n = 0;
+        const char *t = s + 1;
+        while (*t && *t != q) {
+            if (*t == '\\' && t[1]) t++;
+            t++;
+            n++;
+        }
+        if (*t != q) {
+            fail(ps, "unterminated string");
+            ps->tok = T_EOF;
+            return;
+        }
+
+        ps->tok_text = (char *)csvstat_malloc(ALLOC_EXPR, n + 1);
+        if (!ps->tok_text) {
+            fail(ps, "out of memory");
+            ps->tok = T_EOF;
+            return;
+        }
+        size_t k = 0;
+        for (t = s + 1; *t != q; t++) {
+            if (*t == '\\' && t[1]) t++;
+            ps->tok_text[k++] = *t;
+        }
+        ps->tok_text[k] = '\0';
+
+        ps->p = t + 1;
+        ps->tok = T_STR;
+        return;
+    }
+
+    // Column name: identifier or `backquoted name`.
+    if (s[0] == '`') {
+        const char *t = strchr(s + 1, '`');
+        if (!t) {
+            fail(ps, "unterminated column name");
+            ps->tok = T_EOF;
+            return;
+        }
+        ps->tok_text = dup_range(s + 1, (size_t)(t - s - 1));
+        if (!ps->tok_text) fail(ps, "out of memory");
+        ps->p = t + 1;
+        ps->tok = T_IDENT;
+        return;
+    }
+    if (isalpha((unsigned char)s[0]) || s[0] == '_') {
+        const char *t = s;
+        while (isalnum((unsigned char)*t) || *t == '_' || *t == '.') t++;
+        ps->tok_text = dup_range(s, (size_t)(t - s));
+        if (!ps->tok_text) fail(ps, "out of memory");
+        ps->p = t;
+        ps->tok = T_IDENT;
+        return;
+    }
+
+    ps->p = s + 1;
+    switch (s[0]) {
+        case '(': ps->tok = T_LP; return;
+        case ')': ps->tok = T_RP; return;
+        case '+': ps->tok = T_PLUS; return;
+        case '-': ps->tok = T_MINUS; return;
+        case '*': ps->tok = T_STAR; return;
+        case '/': ps->tok = T_SLASH; return;
+        case '?': ps->tok = T_QUEST; return;
+        case ':': ps->tok = T_COLON; return;
+        case '<':
+            if (s[1] == '=') { ps->p = s + 2; ps->tok = T_LE; } else ps->tok = T_LT;
+            return;
+        case '>':
+            if (s[1] == '=') { ps->p = s + 2; ps->tok = T_GE; } else ps->tok = T_GT;
+            return;
+        case '=':
+            if (s[1] == '=') { ps->p = s + 2; ps->tok = T_EQ; return; }
+            break;
+        case '!':
+            if (s[1] == '=') { ps->p = s + 2; ps->tok = T_NE; } else ps->tok = T_NOT;
+            return;
+        case '&':
+            if (s[1] == '&') { ps->p = s + 2; ps->tok = T_AND; return; }
+            break;
+        case '|':
+            if (s[1] == '|') { ps->p = s + 2; ps->tok = T_OR; return; }
+            break;
+        default:
+            break;
+    }
+
+    fail(ps, "unexpected character");
+    ps->tok = T_EOF;
+}
+
+// ---- Parser (AST) ----
+
+static size_t new_node(Parser *ps, NodeKind kind) {
+    if (ps->failed) return 0;
+
+    if (ps->nnodes == ps->cap) {
+        size_t new_cap = (ps->cap == 0) ? 32 : ps->cap * 2;
+        Node *tmp = (Node *)csvstat_realloc(ALLOC_EXPR, ps->nodes, new_cap * sizeof(Node));
+        if (!tmp) {
+            fail(ps, "out of memory");
+            return 0;
+        }
+        ps->nodes = tmp;
+        ps->cap = new_cap;
+    }
+
+    Node *n = &ps->nodes[ps->nnodes];
+    n->kind = kind;
+    n->op = T_EOF;
+    n->fn = OP_CONST;
+    n->a = 0;
+    n->b = 0;
+    n->c = 0;
+    n->num = 0.0;
+    n->idx = 0;
+    return ps->nnodes++;
+}
+
+static size_t parse_cond(Parser *ps);
+
+typedef struct {
+    const char *name;
+    ExprOp op;
+} ExprFunc;
+
+static const ExprFunc k_funcs[] = {
+    { "abs",  OP_ABS },
+    { "log",  OP_LOG },
+    { "sqrt", OP_SQRT },
+    { "exp",  OP_EXP },
+};
+
+/*
+Parse `name(arg)` for a built-in one-argument function.
+The current token is the identifier and the next character is '('.
+*/
+static size_t parse_call(Parser *ps) {
+    const ExprFunc *f = NULL;
+    for (size_t i = 0; i < sizeof k_funcs / sizeof k_funcs[0]; i++) {
+        if (strcmp(ps->tok_text, k_funcs[i].name) == 0) f = &k_funcs[i];
+    }
+    if (!f) {
+        fail(ps, "unknown function");
+        return 0;
+    }
+
+    next_token(ps);  // name
+    next_token(ps);  // '('
+    size_t a = parse_cond(ps);
+    if (!ps->failed && ps->tok != T_RP) {
+        fail(ps, "expected ')' after function argument");
+        return 0;
+    }
+    next_token(ps);
+
+    size_t n = new_node(ps, N_CALL);
+    if (ps->failed) return 0;
+    ps->nodes[n].fn = f->op;
+    ps->nodes[n].a = a;
+    return n;
+}
+
+static size_t parse_primary(Parser *ps) {
+    if (ps->failed) return 0;
+
+    switch (ps->tok) {
+        case T_NUM: {
+            size_t n = new_node(ps, N_NUM);
+            if (!ps->failed) ps->nodes[n].num = ps->tok_num;
+            next_token(ps);
+            return n;
+        }
+        case T_STR: {
+            ExprProgram *prog = ps->prog;
+            char **tmp = (char **)csvstat_realloc(ALLOC_EXPR, prog->strs, (prog->nstrs + 1) * sizeof(char *));
+            if (!tmp) {
+                fail(ps, "out of memory");
+                return 0;
+            }
+            prog->strs = tmp;
+            prog->strs[prog->nstrs] = ps->tok_text;
+            ps->tok_text = NULL;  // ownership moved to the program
+
+            size_t n = new_node(ps, N_STR);
+            if (!ps->failed) ps->nodes[n].idx = prog->nstrs;
+            prog->nstrs++;
+            next_token(ps);
+            return n;
+        }
+        case T_IDENT: {
+            // `name(` is a function call; a column name is never followed by '('.
+            const char *q = ps->p;
+            while (*q == ' ' || *q == '\t') q++;
+            if (*q == '(' && ps->tok_start[0] != '`') return parse_call(ps);
+
+            size_t col = 0;
+            if (csv_header_index_find(ps->header, ps->tok_text, &col) != 0) {
+                fail(ps, "unknown column");
+                return 0;
+            }
+            size_t n = new_node(ps, N_COL);
+            if (!ps->failed) ps->nodes[n].idx = col;
+            next_token(ps);
+            return n;
+        }
+        case T_LP: {
+            next_token(ps);
+            size_t n = parse_cond(ps);
+            if (ps->tok != T_RP) {
+                fail(ps, "expected ')'");
+                return 0;
+            }
+            next_token(ps);
+            return n;
+        }
+        default:
+            fail(ps, "expected a number, string, column or '('");
+            return 0;
+    }
+}
+
+static size_t parse_unary(Parser *ps) {
+    if (ps->tok == T_MINUS || ps->tok == T_NOT) {
+        TokKind op = ps->tok;
+        next_token(ps);
+        size_t a = parse_unary(ps);
+        if (ps->failed) return 0;
+
+        // Fold "-<number>" so bounds like `x > -5` stay recognizable.
+        if (op == T_MINUS && ps->nodes[a].kind == N_NUM) {
+            ps->nodes[a].num = -ps->nodes[a].num;
+            return a;
+        }
+
+        size_t n = new_node(ps, N_UNARY);
+        if (ps->failed) return 0;
+        ps->nodes[n].op = op;
+        ps->nodes[n].a = a;
+        return n;
+    }
+    return parse_primary(ps);
+}
+
+static size_t make_binary(Parser *ps, TokKind op, size_t a, size_t b) {
+    size_t n = new_node(ps, N_BINARY);
+    if (ps->failed) return 0;
+    ps->nodes[n].op = op;
+    ps->nodes[n].a = a;
+    ps->nodes[n].b = b;
+    return n;
+}
+
+static size_t parse_mul(Parser *ps) {
+    size_t a = parse_unary(ps);
+    while (!ps->failed && (ps->tok == T_STAR || ps->tok == T_SLASH)) {
+        TokKind op = ps->tok;
+        next_token(ps);
+        size_t b = parse_unary(ps);
+        a = make_binary(ps, op, a, b);
+    }
+    return a;
+}
+
+static size_t parse_add(Parser *ps) {
+    size_t a = parse_mul(ps);
+    while (!ps->failed && (ps->tok == T_PLUS || ps->tok == T_MINUS)) {
+        TokKind op = ps->tok;
+        next_token(ps);
+        size_t b = parse_mul(ps);
+        a = make_binary(ps, op, a, b);
+    }
+    return a;
+}
+
+static int is_cmp(TokKind t) {
+    return t == T_LT || t == T_LE || t == T_GT || t == T_GE || t == T_EQ || t == T_NE;
+}
+
+static size_t parse_cmp(Parser *ps) {
+    size_t a = parse_add(ps);
+    if (!ps->failed && is_cmp(ps->tok)) {
+        TokKind op = ps->tok;
+        next_token(ps);
+        size_t b = parse_add(ps);
+        a = make_binary(ps, op, a, b);
+    }
+    return a;
+}
+
+static size_t parse_and(Parser *ps) {
+    size_t a = parse_cmp(ps);
+    while (!ps->failed && ps->tok == T_AND) {
+        next_token(ps);
+        size_t b = parse_cmp(ps);
+        a = make_binary(ps, T_AND, a, b);
+    }
+    return a;
+}
+
+static size_t parse_or(Parser *ps) {
+    size_t a = parse_and(ps);
+    while (!ps->failed && ps->tok == T_OR) {
+        next_token(ps);
+        size_t b = parse_and(ps);
+        a = make_binary(ps, T_OR, a, b);
+    }
+    return a;
+}
+
+static size_t parse_cond(Parser *ps) {
+    size_t c = parse_or(ps);
+    if (ps->failed || ps->tok != T_QUEST) return c;
+
+    next_token(ps);
+    size_t a = parse_cond(ps);
+    if (!ps->failed && ps->tok != T_COLON) {
+        fail(ps, "expected ':' in conditional");
+        return 0;
+    }
+    next_token(ps);
+    size_t b = parse_cond(ps);
+
+    size_t n = new_node(ps, N_COND);
+    if (ps->failed) return 0;
+    ps->nodes[n].a = c;
+    ps->nodes[n].b = a;
+    ps->nodes[n].c = b;
+    return n;
+}
+
+// ---- Code generation ----
+
+typedef struct {
+    Parser *ps;
+    ExprMode mode;
+    size_t cap;    // capacity of prog->code
+    size_t depth;  // current stack depth
+} Gen;
+
+static size_t emit(Gen *g, ExprOp op, unsigned arg, double imm) {
+    ExprProgram *prog = g->ps->prog;
+    if (g->ps->failed) return 0;
+
+    if (prog->ncode == g->cap) {
+        size_t new_cap = (g->cap == 0) ? 32 : g->cap * 2;
+        ExprInsn *tmp = (ExprInsn *)csvstat_realloc(ALLOC_EXPR, prog->code, new_cap * sizeof(ExprInsn));
+        if (!tmp) {
+            fail(g->ps, "out of memory");
+            return 0;
+        }
+        prog->code = tmp;
+        g->cap = new_cap;
+    }
+
+    ExprInsn *in = &prog->code[prog->ncode];
+    in->op = (unsigned char)op;
+    in->arg = arg;
+    in->arg2 = 0;
+    in->imm = imm;
+    return prog->ncode++;
+}
+
+static void push_depth(Gen *g) {
+    g->depth++;
+    if (g->depth > g->ps->prog->max_stack) g->ps->prog->max_stack = g->depth;
+}
+
+static unsigned slot_for(Gen *g, size_t col) {
+    ExprProgram *prog = g->ps->prog;
+
+    for (size_t i = 0; i < prog->nslots; i++) {
+        if (prog->slot_cols[i] == col) return (unsigned)i;
+    }
+
+    size_t *tmp = (size_t *)csvstat_realloc(ALLOC_EXPR, prog->slot_cols, (prog->nslots + 1) * sizeof(size_t));
+    if (!tmp) {
+        fail(g->ps, "out of memory");
+        return 0;
+    }
+    prog->slot_cols = tmp;
+    prog->slot_cols[prog->nslots] = col;
+    if (col + 1 > prog->max_col) prog->max_col = col + 1;
+    return (unsigned)prog->nslots++;
+}
+
+static ExprOp binary_op(TokKind t) {
+    switch (t) {
+        case T_PLUS:  return OP_ADD;
+        case T_MINUS: return OP_SUB;
+        case T_STAR:  return OP_MUL;
+        case T_SLASH: return OP_DIV;
+        case T_LT:    return OP_LT;
+        case T_LE:    return OP_LE;
+        case T_GT:    return OP_GT;
+        case T_GE:    return OP_GE;
+        case T_EQ:    return OP_EQ;
+        default:      return OP_NE;
+    }
+}
+
+static void gen(Gen *g, size_t ni) {
+    Parser *ps = g->ps;
+    if (ps->failed) return;
+
+    const Node n = ps->nodes[ni];
+
+    switch (n.kind) {
+        case N_NUM:
+            emit(g, OP_CONST, 0, n.num);
+            push_depth(g);
+            return;
+
+        case N_COL:
+            emit(g, OP_LOAD, slot_for(g, n.idx), 0.0);
+            push_depth(g);
+            return;
+
+        case N_STR:
+            fail(ps, "string literals are only allowed in == / != against a column");
+            return;
+
+        case N_UNARY:
+            gen(g, n.a);
+            emit(g, (n.op == T_MINUS) ? OP_NEG : OP_NOT, 0, 0.0);
+            return;
+
+        case N_CALL:
+            gen(g, n.a);
+            emit(g, n.fn, 0, 0.0);
+            return;
+
+        case N_COND:
+            if (g->mode == EXPR_VECTOR) {
+                // Both branches are computed for the whole batch, then blended.
+                gen(g, n.a);
+                gen(g, n.b);
+                gen(g, n.c);
+                emit(g, OP_SELECT, 0, 0.0);
+                g->depth -= 2;
+            } else {
+                // c; JZ else; a; JMP end; else: b; end:
+                gen(g, n.a);
+                size_t jz = emit(g, OP_JZ, 0, 0.0);
+                g->depth--;
+                gen(g, n.b);
+                size_t jmp = emit(g, OP_JMP, 0, 0.0);
+                g->depth--;
+                if (!ps->failed) ps->prog->code[jz].arg = (unsigned)ps->prog->ncode;
+                gen(g, n.c);
+                if (!ps->failed) ps->prog->code[jmp].arg = (unsigned)ps->prog->ncode;
+            }
+            return;
+
+        case N_BINARY:
+            break;
+    }
+
+    if ((n.op == T_AND || n.op == T_OR) && g->mode == EXPR_VECTOR) {
+        gen(g, n.a);
+        gen(g, n.b);
+        emit(g, (n.op == T_AND) ? OP_AND : OP_OR, 0, 0.0);
+        g->depth--;
+        return;
+    }
+
+    if (n.op == T_AND || n.op == T_OR) {
+        // a; BOOL; J(Z|NZ)_KEEP end; POP; b; BOOL; end:
+        gen(g, n.a);
+        emit(g, OP_BOOL, 0, 0.0);
+        size_t jump = emit(g, (n.op == T_AND) ? OP_JZ_KEEP : OP_JNZ_KEEP, 0, 0.0);
+        emit(g, OP_POP, 0, 0.0);
+        g->depth--;
+        gen(g, n.b);
+        emit(g, OP_BOOL, 0, 0.0);
+        if (!ps->failed) ps->prog->code[jump].arg = (unsigned)ps->prog->ncode;
+        return;
+    }
+
+    const Node *a = &ps->nodes[n.a];
+    const Node *b = &ps->nodes[n.b];
+    if ((n.op == T_EQ || n.op == T_NE) && (a->kind == N_STR || b->kind == N_STR)) {
+        const Node *col = (a->kind == N_STR) ? b : a;
+        const Node *str = (a->kind == N_STR) ? a : b;
+        if (g->mode == EXPR_VECTOR) {
+            fail(ps, "string comparisons are not supported in numeric expressions");
+            return;
+        }
+        if (col->kind != N_COL) {
+            fail(ps, "a string can only be compared with a column");
+            return;
+        }
+        size_t at = emit(g, (n.op == T_EQ) ? OP_STREQ : OP_STRNE, slot_for(g, col->idx), 0.0);
+        if (!ps->failed) ps->prog->code[at].arg2 = (unsigned)str->idx;
+        push_depth(g);
+        return;
+    }
+
+    gen(g, n.a);
+    gen(g, n.b);
+    emit(g, binary_op(n.op), 0, 0.0);
+    g->depth--;
+}
+
+// ---- Bounds extraction ----
+
+static void add_bound(Parser *ps, size_t col, double lo, double hi) {
+    ExprProgram *prog = ps->prog;
+
+    for (size_t i = 0; i < prog->nbounds; i++) {
+        if (prog->bounds[i].col == col) {
+            if (lo > prog->bounds[i].lo) prog->bounds[i].lo = lo;
+            if (hi < prog->bounds[i].hi) prog->bounds[i].hi = hi;
+            return;
+        }
+    }
+
+    ExprBound *tmp = (ExprBound *)csvstat_realloc(ALLOC_EXPR, prog->bounds, (prog->nbounds + 1) * sizeof(ExprBound));
+    if (!tmp) {
+        fail(ps, "out of memory");
+        return;
+    }
+    prog->bounds = tmp;
+    prog->bounds[prog->nbounds].col = col;
+    prog->bounds[prog->nbounds].lo = lo;
+    prog->bounds[prog->nbounds].hi = hi;
+    prog->nbounds++;
+}
+
+/*
+Collect `col OP number` comparisons reachable through `&&` only.
+Strict comparisons are widened to inclusive bounds (still conservative).
+*/
+static void collect_bounds(Parser *ps, size_t ni) {
+    if (ps->failed) return;
+
+    const Node *n = &ps->nodes[ni];
+    if (n->kind != N_BINARY) return;
+
+    if (n->op == T_AND) {
+        collect_bounds(ps, n->a);
+        collect_bounds(ps, n->b);
+        return;
+    }
+
+    const Node *a = &ps->nodes[n->a];
+    const Node *b = &ps->nodes[n->b];
+    TokKind op = n->op;
+
+    if (a->kind == N_NUM && b->kind == N_COL) {
+        // Mirror "5 < x" into "x > 5".
+        const Node *t = a; a = b; b = t;
+        switch (op) {
+            case T_LT: op = T_GT; break;
+            case T_LE: op = T_GE; break;
+            case T_GT: op = T_LT; break;
+            case T_GE: op = T_LE; break;
+            default: break;
+        }
+    }
+    if (a->kind != N_COL || b->kind != N_NUM) return;
+
+    switch (op) {
+        case T_LT: case T_LE: add_bound(ps, a->idx, -INFINITY, b->num); break;
+        case T_GT: case T_GE: add_bound(ps, a->idx, b->num, INFINITY); break;
+        case T_EQ:            add_bound(ps, a->idx, b->num, b->num); break;
+        default: break;
+    }
+}
+
+// ---- Public API ----
+
+static void prog_zero(ExprProgram *prog) {
+    prog->code = NULL;
+    prog->ncode = 0;
+    prog->strs = NULL;
+    prog->nstrs = 0;
+    prog->slot_cols = NULL;
+    prog->nslots = 0;
+    prog->bounds = NULL;
+    prog->nbounds = 0;
+    prog->max_stack = 0;
+    prog->max_col = 0;
+    prog->mode = EXPR_SCALAR;
+}
+
+int expr_compile(ExprProgram *prog, const char *src, const CsvHeaderIndex *header,
+                 ExprMode mode, char *err, size_t errcap) {
+    if (err && errcap > 0) err[0] = '\0';
+    if (!prog) return -1;
+    prog_zero(prog);
+    if (!src || !header) return -1;
+
+    Parser ps = {0};
+    ps.src = src;
+    ps.p = src;
+    ps.header = header;
+    ps.prog = prog;
+    ps.err = err;
+    ps.errcap = errcap;
+
+    next_token(&ps);
+    size_t root = parse_cond(&ps);
+    if (!ps.failed && ps.tok != T_EOF) fail(&ps, "unexpected trailing input");
+
+    Gen g = {0};
+    g.ps = &ps;
+    g.mode = mode;
+    prog->mode = mode;
+    if (!ps.failed) gen(&g, root);
+    if (!ps.failed) collect_bounds(&ps, root);
+
+    csvstat_free(ps.tok_text);
+    csvstat_free(ps.nodes);
+
+    if (ps.failed) {
+        expr_destroy(prog);
+        return -1;
+    }
+
+    CSVSTAT_ASSERT(g.depth == 1);
+    return 0;
+}
+
+void expr_destroy(ExprProgram *prog) {
+    if (!prog) return;
+
+    for (size_t i = 0; i < prog->nstrs; i++) {
+        csvstat_free(prog->strs[i]);
+    }
+    csvstat_free(prog->strs);
+    csvstat_free(prog->code);
+    csvstat_free(prog->slot_cols);
+    csvstat_free(prog->bounds);
+
+    prog_zero(prog);
+}
+
+int expr_eval_init(ExprEval *ev, const ExprProgram *prog) {
+    if (!ev) return -1;
+
+    ev->stack = NULL;
+    ev->vals = NULL;
+    ev->have = NULL;
+    ev->nslots = 0;
+
+    if (!prog) return -1;
+
+    size_t depth = (prog->max_stack > 0) ? prog->max_stack : 1;
+    size_t nslots = (prog->nslots > 0) ? prog->nslots : 1;
+
+    ev->stack = (double *)csvstat_malloc(ALLOC_EXPR, depth * sizeof(double));
+    ev->vals = (double *)csvstat_malloc(ALLOC_EXPR, nslots * sizeof(double));
+    ev->have = (unsigned char *)csvstat_malloc(ALLOC_EXPR, nslots);
+    if (!ev->stack || !ev->vals || !ev->have) {
+        expr_eval_destroy(ev);
+        return -1;
+    }
+    ev->nslots = prog->nslots;
+    return 0;
+}
+
+void expr_eval_destroy(ExprEval *ev) {
+    if (!ev) return;
+
+    csvstat_free(ev->stack);
+    csvstat_free(ev->vals);
+    csvstat_free(ev->have);
+    ev->stack = NULL;
+    ev->vals = NULL;
+    ev->have = NULL;
+    ev->nslots = 0;
+}
+
+static int truthy(double v) {
+    return (v == v && v != 0.0) ? 1 : 0;  // NaN is false
+}
+
+static const char *cell(const ExprProgram *prog, const CsvRowView *row, unsigned slot) {
+    size_t col = prog->slot_cols[slot];
+    return (col < row->nfields && row->fields[col]) ? row->fields[col] : NULL;
+}
+
+int expr_eval_row(const ExprProgram *prog, ExprEval *ev, const CsvRowView *row, double *out) {
+    if (!prog || !ev || !row || !out || !prog->code) return -1;
+    if (prog->mode != EXPR_SCALAR) return -1;
+
+    CSVSTAT_ASSERT(ev->nslots == prog->nslots);
+
+    memset(ev->have, 0, ev->nslots);
+
+    double *st = ev->stack;
+    size_t sp = 0;
+    size_t pc = 0;
+
+    while (pc < prog->ncode) {
+        const ExprInsn *in = &prog->code[pc++];
+
+        switch ((ExprOp)in->op) {
+            case OP_CONST:
+                st[sp++] = in->imm;
+                break;
+
+            case OP_LOAD:
+                if (!ev->have[in->arg]) {
+                    double x = 0.0;
+                    const char *c = cell(prog, row, in->arg);
+                    ev->vals[in->arg] = (c && parse_double_strict(c, &x) == 0) ? x : NAN;
+                    ev->have[in->arg] = 1;
+                }
+                st[sp++] = ev->vals[in->arg];
+                break;
+
+            case OP_STREQ:
+            case OP_STRNE: {
+                const char *c = cell(prog, row, in->arg);
+                int eq = strcmp(c ? c : "", prog->strs[in->arg2]) == 0;
+                st[sp++] = (in->op == OP_STREQ) ? (double)eq : (double)!eq;
+                break;
+            }
+
+            case OP_NEG:  st[sp - 1] = -st[sp - 1]; break;
+            case OP_NOT:  st[sp - 1] = truthy(st[sp - 1]) ? 0.0 : 1.0; break;
+            case OP_BOOL: st[sp - 1] = truthy(st[sp - 1]) ? 1.0 : 0.0; break;
+
+            case OP_ADD: sp--; st[sp - 1] = st[sp - 1] + st[sp]; break;
+            case OP_SUB: sp--; st[sp - 1] = st[sp - 1] - st[sp]; break;
+            case OP_MUL: sp--; st[sp - 1] = st[sp - 1] * st[sp]; break;
+            case OP_DIV: sp--; st[sp - 1] = st[sp - 1] / st[sp]; break;
+            case OP_LT:  sp--; st[sp - 1] = (st[sp - 1] <  st[sp]) ? 1.0 : 0.0; break;
+            case OP_LE:  sp--; st[sp - 1] = (st[sp - 1] <= st[sp]) ? 1.0 : 0.0; break;
+            case OP_GT:  sp--; st[sp - 1] = (st[sp - 1] >  st[sp]) ? 1.0 : 0.0; break;
+            case OP_GE:  sp--; st[sp - 1] = (st[sp - 1] >= st[sp]) ? 1.0 : 0.0; break;
+            case OP_EQ:  sp--; st[sp - 1] = (st[sp - 1] == st[sp]) ? 1.0 : 0.0; break;
+            case OP_NE:  sp--; st[sp - 1] = (st[sp - 1] != st[sp]) ? 1.0 : 0.0; break;
+
+            case OP_ABS:  st[sp - 1] = fabs(st[sp - 1]); break;
+            case OP_LOG:  st[sp - 1] = log(st[sp - 1]); break;
+            case OP_SQRT: st[sp - 1] = sqrt(st[sp - 1]); break;
+            case OP_EXP:  st[sp - 1] = exp(st[sp - 1]); break;
+
+            case OP_JZ_KEEP:
+                if (!truthy(st[sp - 1])) pc = in->arg;
+                break;
+            case OP_JNZ_KEEP:
+                if (truthy(st[sp - 1])) pc = in->arg;
+                break;
+            case OP_JZ:
+                sp--;
+                if (!truthy(st[sp])) pc = in->arg;
+                break;
+            case OP_JMP:
+                pc = in->arg;
+                break;
+            case OP_POP:
+                sp--;
+                break;
+
+            case OP_AND:
+            case OP_OR:
+            case OP_SELECT:
+                // Vector-only opcodes are never emitted in scalar mode.
+                return -1;
+        }
+    }
+
+    CSVSTAT_ASSERT(sp == 1);
+    *out = st[0];
+    return 0;
+}
+
+int expr_test_row(const ExprProgram *prog, ExprEval *ev, const CsvRowView *row) {
+    double v = 0.0;
+    if (expr_eval_row(prog, ev, row, &v) != 0) return 0;
+    return truthy(v);
+}
+
+// ---- Vector (batch) evaluation ----
+
+int expr_batch_init(ExprBatch *b, const ExprProgram *prog) {
+    if (!b) return -1;
+
+    b->cols = NULL;
+    b->regs = NULL;
+    b->src = NULL;
+    b->out = NULL;
+    b->nslots = 0;
+    b->depth = 0;
+    b->n = 0;
+
+    if (!prog || prog->mode != EXPR_VECTOR) return -1;
+
+    size_t nslots = (prog->nslots > 0) ? prog->nslots : 1;
+    size_t depth = (prog->max_stack > 0) ? prog->max_stack : 1;
+
+    b->cols = (double *)csvstat_malloc(ALLOC_EXPR, nslots * EXPR_BATCH * sizeof(double));
+    b->regs = (double *)csvstat_malloc(ALLOC_EXPR, depth * EXPR_BATCH * sizeof(double));
+    b->src = (const double **)csvstat_malloc(ALLOC_EXPR, depth * sizeof(const double *));
+    b->out = (double *)csvstat_malloc(ALLOC_EXPR, EXPR_BATCH * sizeof(double));
+    if (!b->cols || !b->regs || !b->src || !b->out) {
+        expr_batch_destroy(b);
+        return -1;
+    }
+
+    b->nslots = prog->nslots;
+    b->depth = depth;
+    return 0;
+}
+
+void expr_batch_destroy(ExprBatch *b) {
+    if (!b) return;
+
+    csvstat_free(b->cols);
+    csvstat_free(b->regs);
+    csvstat_free((void *)b->src);
+    csvstat_free(b->out);
+    b->cols = NULL;
+    b->regs = NULL;
+    b->src = NULL;
+    b->out = NULL;
+    b->nslots = 0;
+    b->depth = 0;
+    b->n = 0;
+}
+
+int expr_batch_add_row(ExprBatch *b, const ExprProgram *prog, const CsvRowView *row) {
+    if (!b || !prog || !row || b->n >= EXPR_BATCH) return -1;
+
+    CSVSTAT_ASSERT(b->nslots == prog->nslots);
+
+    // Transpose the referenced cells into per-column arrays (SoA).
+    for (size_t slot = 0; slot < prog->nslots; slot++) {
+        double x = 0.0;
+        const char *c = cell(prog, row, (unsigned)slot);
+        b->cols[slot * EXPR_BATCH + b->n] = (c && parse_double_strict(c, &x) == 0) ? x : NAN;
+    }
+
+    b->n++;
+    return 0;
+}
+
+/*
+Elementwise kernels. Each loop has a single store per element and no calls
+other than libm, so the compiler can vectorize it at -O2 and above. The
+inputs are not `restrict`: an operand computed by an earlier op lives in
+the very register the result is written to (e.g. `abs(-(a*b))`), which is
+safe here because element i is only read before it is written.
+*/
+#define EXPR_UNARY_LOOP(expr_)                                     \
+    do {                                                           \
+        const double *x = src[sp - 1];                    \
+        double *r = &regs[(sp - 1) * EXPR_BATCH];         \
+        for (size_t i = 0; i < n; i++) r[i] = (expr_);             \
+        src[sp - 1] = r;                                           \
+    } while (0)
+
+#define EXPR_BINARY_LOOP(expr_)                                    \
+    do {                                                           \
+        const double *x = src[sp - 2];                    \
+        const double *y = src[sp - 1];                    \
+        double *r = &regs[(sp - 2) * EXPR_BATCH];         \
+        for (size_t i = 0; i < n; i++) r[i] = (expr_);             \
+        src[sp - 2] = r;                                           \
+        sp--;                                                      \
+    } while (0)
+
+int expr_eval_columns(const ExprProgram *prog, ExprBatch *b,
+                      const double *const *cols, size_t n, double *out) {
+    if (!prog || !b || !out || n > EXPR_BATCH || !prog->code) return -1;
+    if (prog->mode != EXPR_VECTOR) return -1;
+    if (prog->nslots > 0 && !cols) return -1;
+
+    // Operands are referenced through `src` so column loads are zero-copy;
+    // results land in the register that belongs to the stack position.
+    const double **src = b->src;
+    double *regs = b->regs;
+    size_t sp = 0;
+
+    for (size_t pc = 0; pc < prog->ncode; pc++) {
+        const ExprInsn *in = &prog->code[pc];
+
+        switch ((ExprOp)in->op) {
+            case OP_CONST: {
+                double *r = &regs[sp * EXPR_BATCH];
+                for (size_t i = 0; i < n; i++) r[i] = in->imm;
+                src[sp++] = r;
+                break;
+            }
+            case OP_LOAD:
+                src[sp++] = cols[in->arg];
+                break;
+
+            case OP_NEG:  EXPR_UNARY_LOOP(-x[i]); break;
+            case OP_NOT:  EXPR_UNARY_LOOP((x[i] == x[i] && x[i] != 0.0) ? 0.0 : 1.0); break;
+            case OP_BOOL: EXPR_UNARY_LOOP((x[i] == x[i] && x[i] != 0.0) ? 1.0 : 0.0); break;
+            case OP_ABS:  EXPR_UNARY_LOOP(fabs(x[i])); break;
+            case OP_LOG:  EXPR_UNARY_LOOP(log(x[i])); break;
+            case OP_SQRT: EXPR_UNARY_LOOP(sqrt(x[i])); break;
+            case OP_EXP:  EXPR_UNARY_LOOP(exp(x[i])); break;
+
+            case OP_ADD: EXPR_BINARY_LOOP(x[i] + y[i]); break;
+            case OP_SUB: EXPR_BINARY_LOOP(x[i] - y[i]); break;
+            case OP_MUL: EXPR_BINARY_LOOP(x[i] * y[i]); break;
+            case OP_DIV: EXPR_BINARY_LOOP(x[i] / y[i]); break;
+            case OP_LT:  EXPR_BINARY_LOOP((x[i] <  y[i]) ? 1.0 : 0.0); break;
+            case OP_LE:  EXPR_BINARY_LOOP((x[i] <= y[i]) ? 1.0 : 0.0); break;
+            case OP_GT:  EXPR_BINARY_LOOP((x[i] >  y[i]) ? 1.0 : 0.0); break;
+            case OP_GE:  EXPR_BINARY_LOOP((x[i] >= y[i]) ? 1.0 : 0.0); break;
+            case OP_EQ:  EXPR_BINARY_LOOP((x[i] == y[i]) ? 1.0 : 0.0); break;
+            case OP_NE:  EXPR_BINARY_LOOP((x[i] != y[i]) ? 1.0 : 0.0); break;
+            case OP_AND:
+                EXPR_BINARY_LOOP((x[i] == x[i] && x[i] != 0.0 && y[i] == y[i] && y[i] != 0.0) ? 1.0 : 0.0);
+                break;
+            case OP_OR:
+                EXPR_BINARY_LOOP(((x[i] == x[i] && x[i] != 0.0) || (y[i] == y[i] && y[i] != 0.0)) ? 1.0 : 0.0);
+                break;
+
+            case OP_SELECT: {
+                const double *c = src[sp - 3];
+                const double *x = src[sp - 2];
+                const double *y = src[sp - 1];
+                double *r = &regs[(sp - 3) * EXPR_BATCH];
+                for (size_t i = 0; i < n; i++) {
+                    r[i] = (c[i] == c[i] && c[i] != 0.0) ? x[i] : y[i];
+                }
+                src[sp - 3] = r;
+                sp -= 2;
+                break;
+            }
+
+            default:
+                // Jumps and string opcodes are never emitted in vector mode.
+                return -1;
+        }
+    }
+
+    CSVSTAT_ASSERT(sp == 1);
+    memcpy(out, src[0], n * sizeof(double));
+    return 0;
+}
+
+int expr_batch_eval(ExprBatch *b, const ExprProgram *prog) {
+    if (!b || !prog) return -1;
+
+    const double *cols[64];
+    const double **colp = cols;
+    const double **heap = NULL;
+
+    if (prog->nslots > sizeof cols / sizeof cols[0]) {
+        heap = (const double **)csvstat_malloc(ALLOC_EXPR, prog->nslots * sizeof(const double *));
+        if (!heap) return -1;
+        colp = heap;
+    }
+    for (size_t slot = 0; slot < prog->nslots; slot++) {
+        colp[slot] = &b->cols[slot * EXPR_BATCH];
+    }
+
+    int rc = expr_eval_columns(prog, b, colp, b->n, b->out);
+    csvstat_free((void *)heap);
+    return rc;
+}
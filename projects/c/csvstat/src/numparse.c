@@ -0,0 +1,138 @@
+#include "numparse.h"
+#include "csvstat_alloc.h"
+
+#include <stdlib.h>  // strtod
+#include <errno.h>   // errno, ERANGE
+#include <math.h>    // isfinite
+#include <string.h>  // memcpy
+#include <stdint.h>  // uint64_t
+
+int parse_double_strict(const char *s, double *out) {
+    // Null checks
+    if (!s || !out) return -1;
+
+    // Reject empty string
+    if (s[0] == '\0') return -1;
+
+    char *end = NULL;
+    errno = 0;
+    double v = strtod(s, &end);
+
+    // No conversion performed
+    if (end == s) return -1;
+
+    // Allow trailing spaces/tabs only
+    while (*end == ' ' || *end == '\t') end++;
+
+    // Any remaining characters => invalid numeric token
+    if (*end != '\0') return -1;
+
+    // Treat ERANGE as invalid (overflow/underflow) - Number too large
+    if (errno == ERANGE) return -1;
+
+    // Reject NaN / +/-Inf
+    if (!isfinite(v)) return -1;
+
+    *out = v;
+    return 0;
+}
+
+static const double pow10_exact[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+/*
+Fast path of parse_double_n(). Returns 0 and writes *out when `s[0..len)` is
+a plain decimal it can convert exactly; returns -1 to request the fallback
+(which also decides whether the text is a valid number at all).
+*/
+static int parse_decimal_fast(const char *s, size_t len, double *out) {
+    const char *p = s;
+    const char *end = s + len;
+
+    // Trailing spaces/tabs are allowed, as for parse_double_strict().
+    while (end > p && (end[-1] == ' ' || end[-1] == '\t')) end--;
+
+    int neg = 0;
+    if (p < end && (*p == '-' || *p == '+')) {
+        neg = (*p == '-');
+        p++;
+    }
+
+    uint64_t m = 0;
+    int digits = 0;       // significant digits accumulated in m
+    int any = 0;          // at least one digit seen
+    int exp10 = 0;
+
+    for (; p < end && *p >= '0' && *p <= '9'; p++) {
+        any = 1;
+        if (m == 0 && *p == '0') continue;  // leading zeros
+        if (++digits > 19) return -1;
+        m = m * 10 + (uint64_t)(*p - '0');
+    }
+    if (p < end && *p == '.') {
+        p++;
+        for (; p < end && *p >= '0' && *p <= '9'; p++) {
+            any = 1;
+            exp10--;
+            if (m == 0 && *p == '0') continue;
+            if (++digits > 19) return -1;
+            m = m * 10 + (uint64_t)(*p - '0');
+        }
+    }
+    if (!any) return -1;
+
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        int eneg = 0;
+        if (p < end && (*p == '-' || *p == '+')) {
+            eneg = (*p == '-');
+            p++;
+        }
+        if (p >= end || *p < '0' || *p > '9') return -1;
+        int e = 0;
+        for (; p < end && *p >= '0' && *p <= '9'; p++) {
+            if (e > 1000) return -1;
+            e = e * 10 + (*p - '0');
+        }
+        exp10 += eneg ? -e : e;
+    }
+    if (p != end) return -1;
+
+    if (m > ((uint64_t)1 << 53)) return -1;
+    if (m == 0) {
+        *out = neg ? -0.0 : 0.0;
+        return 0;
+    }
+    if (exp10 < -22 || exp10 > 22) return -1;
+
+    double v = (double)m;
+    v = (exp10 < 0) ? v / pow10_exact[-exp10] : v * pow10_exact[exp10];
+    *out = neg ? -v : v;
+    return 0;
+}
+
+int parse_double_n(const char *s, size_t len, double *out) {
+    if (!s || !out) return -1;
+    if (len == 0) return -1;
+
+    if (parse_decimal_fast(s, len, out) == 0) return 0;
+
+    // Fallback: strtod needs a terminator. Real numbers are short; longer
+    // text is copied to the heap.
+    char stack[128];
+    char *buf = stack;
+    if (len >= sizeof stack) {
+        buf = csvstat_malloc(ALLOC_NUMPARSE, len + 1);
+        if (!buf) return -1;
+    }
+    memcpy(buf, s, len);
+    buf[len] = '\0';
+
+    // An embedded NUL would end the string early; reject like a junk suffix.
+    int rc = (strlen(buf) == len) ? parse_double_strict(buf, out) : -1;
+
+    if (buf != stack) csvstat_free(buf);
+    return rc;
+}
@@ -0,0 +1,152 @@
+#define _POSIX_C_SOURCE 200809L  // clock_gettime()
+#define _DEFAULT_SOURCE          // getrusage()
+
+#include "profile.h"
+
+#include <string.h>        // memset
+#include <time.h>          // clock_gettime
+#include <sys/resource.h>  // getrusage
+
+static const char *const phase_names[PROF_NPHASES] = {
+    "read", "split", "eval", "parse", "accum",
+};
+
+unsigned long long profile_clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ull + (unsigned long long)ts.tv_nsec;
+}
+
+/*
+Timer ticks in PROFILE_SAMPLE_CAP_US, measured once against the monotonic
+clock. Called from the main thread only (before workers start).
+*/
+static uint64_t sample_cap_ticks(void) {
+    static uint64_t cap = 0;
+    if (cap != 0) return cap;
+
+    unsigned long long ns0 = profile_clock_ns();
+    uint64_t t0 = profile_now();
+    unsigned long long ns1 = ns0;
+    while (ns1 - ns0 < 200000) ns1 = profile_clock_ns();
+    uint64_t t1 = profile_now();
+
+    double ticks_per_ns = (double)(t1 - t0) / (double)(ns1 - ns0);
+    cap = (uint64_t)(ticks_per_ns * PROFILE_SAMPLE_CAP_US * 1000.0) + 1;
+    return cap;
+}
+
+void profile_init(Profile *p, int on) {
+    if (!p) return;
+
+    memset(p, 0, sizeof *p);
+    p->on = on;
+    p->cap = on ? sample_cap_ticks() : UINT64_MAX;
+    p->countdown = 1;  // time the first row, so short inputs get a sample
+}
+
+void profile_merge(Profile *dst, const Profile *src) {
+    if (!dst || !src) return;
+
+    dst->seen += src->seen;
+    dst->sampled += src->sampled;
+    for (int i = 0; i < PROF_NPHASES; i++) {
+        dst->ticks[i] += src->ticks[i];
+        dst->bytes[i] += src->bytes[i];
+        dst->sticks[i] += src->sticks[i];
+        dst->sbytes[i] += src->sbytes[i];
+        dst->calls[i] += src->calls[i];
+        dst->scalls[i] += src->scalls[i];
+    }
+}
+
+void profile_mark(ProfileMark *m) {
+    if (!m) return;
+
+    // An empty timed section measures what start/stop cost; the minimum
+    // over a few runs is what every sample carries on top of the phase.
+    uint64_t best = UINT64_MAX;
+    for (int i = 0; i < 256; i++) {
+        uint64_t t0 = profile_now();
+        uint64_t d = profile_now() - t0;
+        if (d < best) best = d;
+    }
+    m->overhead = best;
+
+    m->ns = profile_clock_ns();
+    m->ticks = profile_now();
+}
+
+const char *profile_timer_name(void) {
+#ifdef PROFILE_HAVE_TSC
+    return "tsc";
+#else
+    return "monotonic";
+#endif
+}
+
+/*
+Peak resident set size in KiB, or 0 if unknown.
+*/
+static long peak_rss_kib(void) {
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) != 0) return 0;
+#if defined(__APPLE__)
+    return ru.ru_maxrss / 1024;  // bytes on macOS
+#else
+    return ru.ru_maxrss;         // KiB on Linux and the BSDs
+#endif
+}
+
+void profile_report(FILE *out, const Profile *p, const ProfileMark *start,
+                    size_t nthreads, size_t rows) {
+    if (!out || !p || !start) return;
+
+    ProfileMark end;
+    profile_mark(&end);
+
+    double wall = (double)(end.ns - start->ns) / 1e9;
+    uint64_t span = end.ticks - start->ticks;
+    double sec_per_tick = (span > 0) ? wall / (double)span : 0.0;
+    double budget = wall * (double)(nthreads ? nthreads : 1);
+
+    fprintf(out, "profile: timer %s, 1 in %d rows or batches timed, %zu thread(s), wall %.3f s\n",
+            profile_timer_name(), PROFILE_SAMPLE_EVERY, nthreads, wall);
+    fprintf(out, "%-8s %10s %7s %14s %12s %10s\n",
+            "phase", "seconds", "share", "bytes", "rows/s", "MB/s");
+
+    // Sampled rows (or batches) stand for all of them.
+    double scale = p->sampled ? (double)p->seen / (double)p->sampled : 0.0;
+
+    double attributed = 0.0;
+    for (int i = 0; i < PROF_NPHASES; i++) {
+        if (p->calls[i] == 0 && p->scalls[i] == 0) continue;  // phase not used by this scan
+
+        // Each timed call also measured the timer itself.
+        double block = (double)p->ticks[i] - (double)p->calls[i] * (double)start->overhead;
+        double per_row = (double)p->sticks[i] - (double)p->scalls[i] * (double)start->overhead;
+        double net = (block > 0 ? block : 0.0) + (per_row > 0 ? per_row : 0.0) * scale;
+        double secs = net * sec_per_tick;
+        double bytes = (double)p->bytes[i] + (double)p->sbytes[i] * scale;
+        attributed += secs;
+
+        fprintf(out, "%-8s %10.3f %6.1f%% ", phase_names[i], secs,
+                budget > 0 ? 100.0 * secs / budget : 0.0);
+        if (bytes > 0) {
+            fprintf(out, "%14.0f", bytes);
+        } else {
+            fprintf(out, "%14s", "-");
+        }
+        fprintf(out, " %12.0f", secs > 0 ? (double)rows / secs : 0.0);
+        if (bytes > 0 && secs > 0) {
+            fprintf(out, " %10.1f\n", bytes / 1e6 / secs);
+        } else {
+            fprintf(out, " %10s\n", "-");
+        }
+    }
+
+    double rest = budget - attributed;
+    if (rest < 0) rest = 0;
+    fprintf(out, "%-8s %10.3f %6.1f%%\n", "other", rest, budget > 0 ? 100.0 * rest / budget : 0.0);
+    fprintf(out, "peak_rss_kib: %ld\n", peak_rss_kib());
+}
@@ -0,0 +1,162 @@
+#define _POSIX_C_SOURCE 200809L  // clock_gettime()
+
+#include "progress.h"
+#include "csvstat_alloc.h"
+
+#include <errno.h>
+#include <math.h>      // isfinite
+#include <time.h>      // clock_gettime
+
+static unsigned long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ull + (unsigned long long)ts.tv_nsec;
+}
+
+int progress_init(Progress *p, const char *path, double interval_s, size_t nslots,
+                  size_t base_rows) {
+    if (!p || nslots == 0 || !(interval_s > 0.0)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    p->out = stderr;
+    p->own_out = 0;
+    p->slots = NULL;
+    p->nslots = 0;
+
+    if (path) {
+        p->out = fopen(path, "w");
+        if (!p->out) return -1;
+        p->own_out = 1;
+    }
+
+    p->slots = csvstat_calloc(ALLOC_PROGRESS, nslots, sizeof *p->slots);
+    if (!p->slots) {
+        if (p->own_out) fclose(p->out);
+        p->out = NULL;
+        errno = ENOMEM;
+        return -1;
+    }
+    for (size_t i = 0; i < nslots; i++) {
+        stats_init(&p->slots[i].st);
+    }
+    p->nslots = nslots;
+
+    if (pthread_mutex_init(&p->lock, NULL) != 0) {
+        csvstat_free(p->slots);
+        p->slots = NULL;
+        if (p->own_out) fclose(p->out);
+        p->out = NULL;
+        errno = ENOMEM;
+        return -1;
+    }
+
+    p->interval_ns = (unsigned long long)(interval_s * 1e9);
+    p->t0_ns = now_ns();
+    p->next_ns = p->t0_ns + p->interval_ns;
+    p->base_rows = base_rows;
+    return 0;
+}
+
+void progress_destroy(Progress *p) {
+    if (!p || !p->slots) return;
+
+    pthread_mutex_destroy(&p->lock);
+    csvstat_free(p->slots);
+    p->slots = NULL;
+    p->nslots = 0;
+
+    if (p->own_out && p->out) fclose(p->out);
+    p->out = NULL;
+    p->own_out = 0;
+}
+
+/*
+Print a JSON number, or null when the value is undefined.
+*/
+static void put_num(FILE *out, const char *key, int ok, double v) {
+    if (ok && isfinite(v)) {
+        fprintf(out, ",\"%s\":%.17g", key, v);
+    } else {
+        fprintf(out, ",\"%s\":null", key);
+    }
+}
+
+static int emit(Progress *p, const Stats *st, const ScanCounters *sc,
+                unsigned long long bytes, unsigned long long t_ns, int done) {
+    double elapsed = (double)(t_ns - p->t0_ns) / 1e9;
+    size_t rows_run = (sc->rows_seen > p->base_rows) ? sc->rows_seen - p->base_rows : 0;
+    double v = 0.0;
+
+    fprintf(p->out, "{\"elapsed_s\":%.3f,\"bytes\":%llu,\"rows\":%zu", elapsed, bytes, sc->rows_seen);
+    fprintf(p->out, ",\"rows_per_s\":%.1f,\"mb_per_s\":%.2f",
+            elapsed > 0 ? (double)rows_run / elapsed : 0.0,
+            elapsed > 0 ? (double)bytes / 1e6 / elapsed : 0.0);
+    fprintf(p->out, ",\"n\":%zu", stats_count(st));
+    int ok = (stats_min(st, &v) == 0);
+    put_num(p->out, "min", ok, v);
+    ok = (stats_max(st, &v) == 0);
+    put_num(p->out, "max", ok, v);
+    ok = (stats_mean(st, &v) == 0);
+    put_num(p->out, "mean", ok, v);
+    ok = (stats_stddev_sample(st, &v) == 0);
+    put_num(p->out, "stddev", ok, v);
+    fprintf(p->out, ",\"done\":%s}\n", done ? "true" : "false");
+
+    if (fflush(p->out) != 0 || ferror(p->out)) return -1;
+    return 0;
+}
+
+int progress_update(Progress *p, const ScanState *ss, unsigned long long bytes) {
+    if (!p || !p->slots || !ss) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    size_t slot = (ss->chunk == SCAN_NO_CHUNK) ? 0 : ss->chunk;
+    if (slot >= p->nslots) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    unsigned long long t = now_ns();
+    int rc = 0;
+
+    pthread_mutex_lock(&p->lock);
+
+    scan_stats(ss, &p->slots[slot].st);
+    p->slots[slot].sc = ss->sc;
+    p->slots[slot].bytes = bytes;
+
+    if (t >= p->next_ns) {
+        // Merge in slot (file) order, as scan_parallel() does at the end.
+        Stats st;
+        ScanCounters sc = {0};
+        unsigned long long total = 0;
+        stats_init(&st);
+
+        for (size_t i = 0; i < p->nslots; i++) {
+            const ProgressSlot *s = &p->slots[i];
+            if (stats_merge(&st, &s->st) != 0) break;
+            sc.rows_seen += s->sc.rows_seen;
+            total += s->bytes;
+        }
+
+        rc = emit(p, &st, &sc, total, t, 0);
+        p->next_ns = t + p->interval_ns;
+    }
+
+    pthread_mutex_unlock(&p->lock);
+    return rc;
+}
+
+int progress_finish(Progress *p, const ScanState *ss, unsigned long long bytes) {
+    if (!p || !p->slots || !ss) {
+        errno = EINVAL;
+        return -1;
+    }
+    Stats st;
+    scan_stats(ss, &st);
+    return emit(p, &st, &ss->sc, bytes, now_ns(), 1);
+}
@@ -0,0 +1,827 @@
+#include "scan.h"
+#include "chunker.h"
+#include "line_reader.h"
+#include "source.h"
+#include "numparse.h"
+#include "csvstat_assert.h"
+#include "csvstat_alloc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <math.h>
+#include <string.h>
+#include <limits.h>
+#include <pthread.h>
+
+int scan_is_empty_line(const char *s) {
+    // "empty line" policy: skip empty or whitespace-only
+    while (*s) {
+        if (*s != ' ' && *s != '\t') return 0;
+        s++;
+    }
+
+    return 1;
+}
+
+/*
+Record a rejected row (see diag.h); nothing is printed per row. Rows are
+numbered per state; in a parallel scan the chunk id is kept alongside since
+row numbers restart per chunk.
+*/
+static void reject(ScanState *ss, DiagKind kind, size_t row_no, const char *text, size_t len) {
+    diag_add(&ss->diag, kind, ss->chunk, row_no, text, len);
+}
+
+/*
+--reject-file: queue the row being processed by `scan_row()`.
+*/
+static void reject_row(ScanState *ss) {
+    if (ss->cfg->rejects) diag_reject_fields(&ss->diag, &ss->row, ss->parser.rest);
+}
+
+int scan_can_batch(const ScanConfig *cfg) {
+    return cfg && !cfg->where && !cfg->expr && !cfg->split_all;
+}
+
+int scan_state_init(ScanState *ss, const ScanConfig *cfg) {
+    if (!ss || !cfg) return -1;
+
+    *ss = (ScanState){0};
+    ss->cfg = cfg;
+    ss->chunk = SCAN_NO_CHUNK;
+    if (cfg->moments) {
+        stats_init_moments(&ss->st);
+    } else {
+        stats_init(&ss->st);
+    }
+    if (stats_set_precision(&ss->st, cfg->precision) != 0) return -1;
+    if (cfg->decimal && (cfg->expr || cfg->has_range || cfg->scale > DECIMAL_MAX_SCALE)) return -1;
+    if (cfg->ncorr == 1 || cfg->ncorr > CORR_MAX_COLS || (cfg->ncorr && !cfg->corr_cols)) return -1;
+    decimal_stats_init(&ss->dec);
+    comoment_init(&ss->co);
+    diag_init(&ss->diag, cfg->rejects, 0);
+    profile_init(&ss->prof, 0);
+
+    if (csv_parser_init(&ss->parser, 16) != 0) return -1;
+    csv_parser_set_quotes(&ss->parser, cfg->quotes);
+    if (csv_parser_set_delim(&ss->parser, cfg->delim) != 0) goto fail;
+
+    if (cfg->where) {
+        if (expr_eval_init(&ss->where_ev, cfg->where) != 0) goto fail;
+        ss->where_init = 1;
+    }
+
+    if (cfg->expr) {
+        ss->expr_rows = csvstat_malloc(ALLOC_SCAN, EXPR_BATCH * sizeof *ss->expr_rows);
+        if (!ss->expr_rows) goto fail;
+        if (expr_batch_init(&ss->expr_batch, cfg->expr) != 0) goto fail;
+        ss->expr_init = 1;
+    }
+
+    if (cfg->ncorr > 2) {
+        if (corr_matrix_init(&ss->cm, cfg->ncorr) != 0) goto fail;
+        ss->cm_init = 1;
+    }
+
+    if (scan_can_batch(cfg)) {
+        // Slot 0 is the stats column, then the --corr columns.
+        size_t cols[1 + CORR_MAX_COLS];
+        cols[0] = cfg->col_index;
+        for (size_t i = 0; i < cfg->ncorr; i++) cols[1 + i] = cfg->corr_cols[i];
+
+        ss->vals = csvstat_malloc(ALLOC_SCAN, SCAN_BATCH_ROWS * sizeof *ss->vals);
+        if (!ss->vals) goto fail;
+        if (csv_batch_init(&ss->batch, cols, 1 + cfg->ncorr, SCAN_BATCH_ROWS) != 0) goto fail;
+        ss->batch_init = 1;
+    }
+
+    // Split only as far as needed: the zone map needs every field, the
+    // filter its own columns first, and the stats just `col_index` (or the
+    // columns referenced by --expr) and the --corr columns.
+    ss->need_fields = cfg->expr ? cfg->expr->max_col : cfg->col_index + 1;
+    for (size_t i = 0; i < cfg->ncorr; i++) {
+        if (cfg->corr_cols[i] + 1 > ss->need_fields) ss->need_fields = cfg->corr_cols[i] + 1;
+    }
+    if (cfg->split_all) ss->need_fields = SIZE_MAX;
+    ss->first_fields = ss->need_fields;
+    if (cfg->where && !cfg->split_all) ss->first_fields = cfg->where->max_col;
+
+    return 0;
+
+fail:
+    scan_state_destroy(ss);
+    return -1;
+}
+
+void scan_state_destroy(ScanState *ss) {
+    if (!ss) return;
+
+    if (ss->expr_init) expr_batch_destroy(&ss->expr_batch);
+    if (ss->where_init) expr_eval_destroy(&ss->where_ev);
+    if (ss->batch_init) csv_batch_destroy(&ss->batch);
+    if (ss->cm_init) corr_matrix_destroy(&ss->cm);
+    diag_destroy(&ss->diag);
+    csvstat_free(ss->expr_rows);
+    csvstat_free(ss->vals);
+    csvstat_free(ss->buf);
+    csvstat_free(ss->cell);
+    csv_parser_destroy(&ss->parser);
+
+    ss->expr_rows = NULL;
+    ss->vals = NULL;
+    ss->buf = NULL;
+    ss->bufcap = 0;
+    ss->cell = NULL;
+    ss->cellcap = 0;
+    ss->batch_init = 0;
+    ss->cm_init = 0;
+    ss->expr_init = 0;
+    ss->where_init = 0;
+}
+
+/*
+Apply --range to a valid value and accumulate it.
+Returns 0 on success, -1 if the stats update fails.
+*/
+static int accept_value(ScanState *ss, double x) {
+    const ScanConfig *cfg = ss->cfg;
+
+    if (cfg->has_range && (x < cfg->range_lo || x > cfg->range_hi)) {
+        ss->sc.range_rejected++;
+        return 0;
+    }
+
+    if (stats_push(&ss->st, x) != 0) return -1;
+
+    ss->sc.numeric_ok++;
+    return 0;
+}
+
+/*
+--decimal: parse `text[0..len)` of row `row_no` and accumulate it exactly.
+Returns CSVSTAT_OK (rejected cells included), or CSVSTAT_EOVERFLOW.
+*/
+static CsvStatErr accept_decimal(ScanState *ss, size_t row_no, const char *text, size_t len) {
+    int64_t v = 0;
+    int prc = decimal_parse(text, len, ss->cfg->scale, &v);
+    if (prc != 0) {
+        ss->sc.numeric_bad++;
+        reject(ss, prc == -2 ? DIAG_NOT_EXACT : DIAG_INVALID_NUMBER, row_no, text, len);
+        return CSVSTAT_OK;
+    }
+    if (decimal_stats_push(&ss->dec, v) != 0) return CSVSTAT_EOVERFLOW;
+
+    ss->sc.numeric_ok++;
+    return CSVSTAT_OK;
+}
+
+/*
+--corr: accumulate the row's values in `ss->corr_row`.
+*/
+static void accept_corr(ScanState *ss) {
+    if (ss->cm_init) {
+        corr_matrix_push(&ss->cm, ss->corr_row);
+    } else {
+        comoment_push(&ss->co, ss->corr_row[0], ss->corr_row[1]);
+    }
+}
+
+/*
+--corr on the line path: parse the columns of `row` and accumulate them if
+every one is a number.
+*/
+static void corr_row_fields(ScanState *ss, const CsvRowView *row) {
+    const ScanConfig *cfg = ss->cfg;
+
+    for (size_t i = 0; i < cfg->ncorr; i++) {
+        size_t c = cfg->corr_cols[i];
+        if (c >= row->nfields || parse_double_strict(row->fields[c], &ss->corr_row[i]) != 0) {
+            ss->sc.corr_skipped++;
+            return;
+        }
+    }
+    accept_corr(ss);
+}
+
+/*
+Apply --range to the valid values x[0..n) (compacting them in place) and
+accumulate them together, so the precision modes see whole blocks.
+Returns 0 on success, -1 if the stats update fails.
+*/
+static int accept_values(ScanState *ss, double *x, size_t n) {
+    const ScanConfig *cfg = ss->cfg;
+    size_t k = n;
+
+    if (cfg->has_range) {
+        k = 0;
+        for (size_t i = 0; i < n; i++) {
+            if (x[i] < cfg->range_lo || x[i] > cfg->range_hi) {
+                ss->sc.range_rejected++;
+                continue;
+            }
+            x[k++] = x[i];
+        }
+    }
+
+    if (stats_push_batch(&ss->st, x, k) != 0) return -1;
+
+    ss->sc.numeric_ok += k;
+    return 0;
+}
+
+/*
+Evaluate the buffered --expr rows and accumulate the results.
+Returns 0 on success, -1 on evaluation or stats failure.
+*/
+static int flush_expr_batch(ScanState *ss) {
+    ExprBatch *eb = &ss->expr_batch;
+    if (eb->n == 0) return 0;
+
+    const int on = PROFILE_ON(&ss->prof);
+    uint64_t t0 = 0, tt = 0;
+    TRACE_START(tt);
+    PROFILE_START(on, t0);
+    if (expr_batch_eval(eb, ss->cfg->expr) != 0) return -1;
+    PROFILE_STOP(on, &ss->prof, PROF_EVAL, t0, 0, 0);
+    TRACE_SPAN("eval", tt, eb->n, 0);
+
+    TRACE_START(tt);
+    PROFILE_START(on, t0);
+    size_t nvals = 0;
+    for (size_t i = 0; i < eb->n; i++) {
+        double x = eb->out[i];
+        if (!isfinite(x)) {
+            ss->sc.numeric_bad++;
+            reject(ss, DIAG_NOT_FINITE, ss->expr_rows[i], NULL, 0);
+            continue;
+        }
+        eb->out[nvals++] = x;
+    }
+    if (accept_values(ss, eb->out, nvals) != 0) return -1;
+    PROFILE_STOP(on, &ss->prof, PROF_ACCUM, t0, 0, 0);
+    TRACE_SPAN("accum", tt, eb->n, 0);
+
+    eb->n = 0;
+    return 0;
+}
+
+/*
+--trace on the line path: rows are recorded in runs of SCAN_BATCH_ROWS, each
+span covering everything from the first row of the run to the next run.
+*/
+static void trace_rows(ScanState *ss) {
+    if (ss->trace_rows == SCAN_BATCH_ROWS) {
+        trace_span("rows", ss->trace_t0, ss->trace_rows, 0);
+        ss->trace_rows = 0;
+    }
+    if (ss->trace_rows++ == 0) ss->trace_t0 = trace_now();
+}
+
+CsvStatErr scan_row(ScanState *ss, char *line, ZoneMap *zm, unsigned long long row_off) {
+    if (!ss || !line) return CSVSTAT_EINTERNAL;
+    if (TRACE_ON()) trace_rows(ss);
+
+    const ScanConfig *cfg = ss->cfg;
+    CsvRowView *row = &ss->row;
+    Profile *prof = &ss->prof;
+    const int timed = PROFILE_ON(prof) && prof->timed;  // sampled by the caller
+    size_t row_no = ss->row_no++;
+    uint64_t t0 = 0;
+
+    PROFILE_START(timed, t0);
+    if (csv_split_n(&ss->parser, line, ss->first_fields, row) != 0) {
+        return CSVSTAT_EFORMAT;
+    }
+    PROFILE_STOP(timed, prof, PROF_SPLIT, t0, 0, 1);
+
+    ss->sc.rows_seen++;
+
+    if (zm && zonemap_add_row(zm, row_off, row) != 0) {
+        return CSVSTAT_ENOMEM;
+    }
+
+    if (ss->where_init) {
+        PROFILE_START(timed, t0);
+        int keep = expr_test_row(cfg->where, &ss->where_ev, row);
+        PROFILE_STOP(timed, prof, PROF_EVAL, t0, 0, 1);
+        if (!keep) {
+            ss->sc.where_rejected++;
+            return CSVSTAT_OK;
+        }
+
+        PROFILE_START(timed, t0);
+        if (csv_split_more(&ss->parser, ss->need_fields, row) != 0) {
+            return CSVSTAT_EFORMAT;
+        }
+        PROFILE_STOP(timed, prof, PROF_SPLIT, t0, 0, 1);
+    }
+
+    if (cfg->ncorr) {
+        PROFILE_START(timed, t0);
+        corr_row_fields(ss, row);
+        PROFILE_STOP(timed, prof, PROF_ACCUM, t0, 0, 1);
+    }
+
+    if (ss->expr_init) {
+        // Gathering the row's operands parses its numbers; cells a short row
+        // lacks are missing (NaN), as for any other empty cell.
+        ss->expr_rows[ss->expr_batch.n] = row_no;
+        PROFILE_START(timed, t0);
+        if (expr_batch_add_row(&ss->expr_batch, cfg->expr, row) != 0) {
+            return CSVSTAT_EINTERNAL;
+        }
+        PROFILE_STOP(timed, prof, PROF_PARSE, t0, 0, 1);
+        if (ss->expr_batch.n == EXPR_BATCH && flush_expr_batch(ss) != 0) {
+            return CSVSTAT_EINTERNAL;
+        }
+        return CSVSTAT_OK;
+    }
+
+    if (cfg->col_index >= row->nfields) {
+        // Row has fewer fields than the header (v1 behavior: skip; optionally warn).
+        ss->sc.missing_col++;
+        reject(ss, DIAG_MISSING_COLUMN, row_no, NULL, 0);
+        reject_row(ss);
+        return CSVSTAT_OK;
+    }
+
+    const char *cell = row->fields[cfg->col_index];
+    double x = 0.0;
+
+    if (cfg->decimal) {
+        PROFILE_START(timed, t0);
+        size_t bad = ss->sc.numeric_bad;
+        CsvStatErr err = accept_decimal(ss, row_no, cell, strlen(cell));
+        PROFILE_STOP(timed, prof, PROF_PARSE, t0, strlen(cell), 1);
+        if (ss->sc.numeric_bad != bad) reject_row(ss);
+        return err;
+    }
+
+    PROFILE_START(timed, t0);
+    int prc = parse_double_strict(cell, &x);
+    PROFILE_STOP(timed, prof, PROF_PARSE, t0, strlen(cell), 1);
+    if (prc != 0) {
+        ss->sc.numeric_bad++;
+        reject(ss, DIAG_INVALID_NUMBER, row_no, cell, strlen(cell));
+        reject_row(ss);
+        return CSVSTAT_OK;
+    }
+
+    PROFILE_START(timed, t0);
+    if (accept_value(ss, x) != 0) return CSVSTAT_EINTERNAL;
+    PROFILE_STOP(timed, prof, PROF_ACCUM, t0, 0, 1);
+
+    return CSVSTAT_OK;
+}
+
+/*
+--reject-file on the batch path: queue row `r` of the batch verbatim; its
+bytes run to the next row, or to the end of the `used` bytes of the block.
+*/
+static void reject_batch_row(ScanState *ss, const char *base, size_t used, size_t r) {
+    const CsvBatch *b = &ss->batch;
+    size_t end = r + 1 < b->nrows ? b->row_off[r + 1] : used;
+    diag_reject_raw(&ss->diag, base + b->row_off[r], end - b->row_off[r]);
+}
+
+/*
+Point `*text`/`*len` at the field `sp` of block `base`: in place, or
+unescaped into `ss->cell` for quoted fields that need it.
+Returns 0 on success, -1 on allocation failure.
+*/
+static int span_text(ScanState *ss, const char *base, const CsvSpan *sp,
+                     const char **text, size_t *len) {
+    *text = base + sp->off;
+    *len = sp->len;
+    if (!(sp->flags & CSV_SPAN_RAW)) return 0;
+
+    if (sp->len + 1 > ss->cellcap) {
+        size_t cap = ss->cellcap ? ss->cellcap : 64;
+        while (cap < sp->len + 1) cap *= 2;
+        char *tmp = csvstat_realloc(ALLOC_SCAN, ss->cell, cap);
+        if (!tmp) return -1;
+        ss->cell = tmp;
+        ss->cellcap = cap;
+    }
+    *len = csv_span_copy(&ss->parser, base, sp, ss->cell, ss->cellcap);
+    *text = ss->cell;
+    return 0;
+}
+
+/*
+--corr on the batch path: parse the --corr slots of row `r` and accumulate
+them if every one is a number.
+Returns 0 on success, -1 on allocation failure.
+*/
+static int corr_batch_row(ScanState *ss, const char *base, size_t r) {
+    const CsvBatch *b = &ss->batch;
+
+    for (size_t i = 0; i < ss->cfg->ncorr; i++) {
+        const CsvSpan *sp = &b->spans[(1 + i) * b->cap + r];
+        const char *text = NULL;
+        size_t len = 0;
+        if (sp->flags & CSV_SPAN_MISSING) {
+            ss->sc.corr_skipped++;
+            return 0;
+        }
+        if (span_text(ss, base, sp, &text, &len) != 0) return -1;
+        if (parse_double_n(text, len, &ss->corr_row[i]) != 0) {
+            ss->sc.corr_skipped++;
+            return 0;
+        }
+    }
+    accept_corr(ss);
+    return 0;
+}
+
+/*
+Convert the stats column of the rows in `ss->batch`, then accumulate the
+values in row order; `base` is the block the spans refer to and `used` the
+bytes the batch was split from.
+Returns CSVSTAT_OK, or the error that should abort the scan.
+*/
+static CsvStatErr scan_batch_rows(ScanState *ss, const char *base, size_t used) {
+    const CsvBatch *b = &ss->batch;
+    const CsvSpan *col = b->spans;  // slot 0: the stats column
+    Profile *prof = &ss->prof;
+    const int timed = PROFILE_ON(prof) && profile_sample(prof, 1);
+    uint64_t t0 = 0, tt = 0;
+    size_t nvals = 0;
+
+    TRACE_START(tt);
+
+    for (size_t r = 0; r < b->nrows; r++) {
+        const CsvSpan *sp = &col[r];
+        size_t row_no = ss->row_no++;
+        ss->sc.rows_seen++;
+
+        if (ss->cfg->ncorr && corr_batch_row(ss, base, r) != 0) return CSVSTAT_ENOMEM;
+
+        if (sp->flags & CSV_SPAN_MISSING) {
+            ss->sc.missing_col++;
+            reject(ss, DIAG_MISSING_COLUMN, row_no, NULL, 0);
+            if (ss->cfg->rejects) reject_batch_row(ss, base, used, r);
+            continue;
+        }
+
+        // Parse straight from the block; only quoted fields that need
+        // unescaping are materialized first.
+        const char *text = NULL;
+        size_t len = 0;
+        if (span_text(ss, base, sp, &text, &len) != 0) return CSVSTAT_ENOMEM;
+
+        if (ss->cfg->decimal) {
+            // Exact integers: parsed and accumulated in one step.
+            size_t bad = ss->sc.numeric_bad;
+            PROFILE_START(timed, t0);
+            CsvStatErr err = accept_decimal(ss, row_no, text, len);
+            PROFILE_STOP(timed, prof, PROF_PARSE, t0, len, 1);
+            if (err != CSVSTAT_OK) return err;
+            if (ss->sc.numeric_bad != bad && ss->cfg->rejects) reject_batch_row(ss, base, used, r);
+            continue;
+        }
+
+        double x = 0.0;
+        PROFILE_START(timed, t0);
+        int prc = parse_double_n(text, len, &x);
+        PROFILE_STOP(timed, prof, PROF_PARSE, t0, len, 1);
+        if (prc != 0) {
+            ss->sc.numeric_bad++;
+            reject(ss, DIAG_INVALID_NUMBER, row_no, text, len);
+            if (ss->cfg->rejects) reject_batch_row(ss, base, used, r);
+            continue;
+        }
+        ss->vals[nvals++] = x;
+    }
+    TRACE_SPAN("parse", tt, b->nrows, 0);
+
+    TRACE_START(tt);
+    PROFILE_START(timed, t0);
+    if (accept_values(ss, ss->vals, nvals) != 0) return CSVSTAT_EINTERNAL;
+    PROFILE_STOP(timed, prof, PROF_ACCUM, t0, 0, 1);
+    TRACE_SPAN("accum", tt, nvals, 0);
+
+    return CSVSTAT_OK;
+}
+
+CsvStatErr scan_stream(ScanState *ss, LineReader *lr, unsigned long long limit, int *saved_errno) {
+    if (!ss || !lr || !ss->batch_init) return CSVSTAT_EINTERNAL;
+
+    if (!ss->buf) {
+        ss->buf = csvstat_malloc(ALLOC_SCAN, SCAN_BLOCK_SIZE);
+        if (!ss->buf) return CSVSTAT_ENOMEM;
+        ss->bufcap = SCAN_BLOCK_SIZE;
+    }
+
+    size_t have = 0;       // bytes in buf
+    size_t pos = 0;        // first unconsumed byte
+    int eof = 0;
+    int need_more = 1;
+
+    for (;;) {
+        if (need_more && !eof) {
+            // Keep the partial record, then top the block up.
+            memmove(ss->buf, ss->buf + pos, have - pos);
+            have -= pos;
+            pos = 0;
+
+            if (have == ss->bufcap) {
+                // One record is longer than the block: grow it.
+                if (ss->bufcap > SIZE_MAX / 2) return CSVSTAT_ENOMEM;
+                char *tmp = csvstat_realloc(ALLOC_SCAN, ss->buf, ss->bufcap * 2);
+                if (!tmp) return CSVSTAT_ENOMEM;
+                ss->buf = tmp;
+                ss->bufcap *= 2;
+            }
+
+            size_t want = ss->bufcap - have;
+            if (limit < want) want = (size_t)limit;
+
+            // Short reads are normal (read-ahead bytes, pipes, decoder
+            // blocks); only an empty read means end of input.
+            size_t got = 0;
+            uint64_t t0 = 0, tt = 0;
+            TRACE_START(tt);
+            PROFILE_START(PROFILE_ON(&ss->prof), t0);
+            if (want > 0 && line_reader_read_raw(lr, ss->buf + have, want, &got) != 0) {
+                if (saved_errno) *saved_errno = errno;
+                return CSVSTAT_EIO;
+            }
+            PROFILE_STOP(PROFILE_ON(&ss->prof), &ss->prof, PROF_READ, t0, got, 0);
+            TRACE_SPAN("read", tt, 0, got);
+            have += got;
+            if (limit != ULLONG_MAX) limit -= got;
+            if (got == 0 || limit == 0) eof = 1;
+        }
+
+        if (pos == have && eof) break;
+
+        size_t used = 0;
+        uint64_t t0 = 0, tt = 0;
+        TRACE_START(tt);
+        PROFILE_START(PROFILE_ON(&ss->prof), t0);
+        if (csv_split_batch(&ss->parser, &ss->batch, ss->buf + pos, have - pos, eof, &used) != 0) {
+            return CSVSTAT_EINTERNAL;
+        }
+        PROFILE_STOP(PROFILE_ON(&ss->prof), &ss->prof, PROF_SPLIT, t0, used, 0);
+        TRACE_SPAN("split", tt, ss->batch.nrows, used);
+
+        need_more = (used == 0 && ss->batch.nrows == 0);
+        if (need_more) {
+            if (eof) break;  // cannot happen: at EOF every byte is a record
+            continue;
+        }
+
+        CsvStatErr err = scan_batch_rows(ss, ss->buf + pos, used);
+        if (err != CSVSTAT_OK) return err;
+
+        pos += used;
+
+        if (ss->tick) {
+            // The reader is at the offset of buf[have].
+            err = scan_tick(ss, lr->pos - (have - pos));
+            if (err != CSVSTAT_OK) {
+                if (err == CSVSTAT_EIO && saved_errno) *saved_errno = errno;
+                return err;
+            }
+        }
+        if (pos == have) need_more = 1;
+    }
+
+    return CSVSTAT_OK;
+}
+
+CsvStatErr scan_tick(ScanState *ss, unsigned long long offset) {
+    if (!ss) return CSVSTAT_EINTERNAL;
+    if (!ss->tick || ss->row_no - ss->tick_row < ss->tick_every) return CSVSTAT_OK;
+
+    if (ss->expr_init && flush_expr_batch(ss) != 0) return CSVSTAT_EINTERNAL;
+
+    ss->tick_row = ss->row_no;
+    return ss->tick(ss->tick_ctx, ss, offset) == 0 ? CSVSTAT_OK : CSVSTAT_EIO;
+}
+
+CsvStatErr scan_finish(ScanState *ss) {
+    if (!ss) return CSVSTAT_EINTERNAL;
+
+    if (ss->expr_init && flush_expr_batch(ss) != 0) return CSVSTAT_EINTERNAL;
+    if (ss->cm_init) corr_matrix_flush(&ss->cm);
+    diag_flush(&ss->diag);
+
+    if (TRACE_ON() && ss->trace_rows > 0) {
+        trace_span("rows", ss->trace_t0, ss->trace_rows, 0);
+        ss->trace_rows = 0;
+    }
+
+    return CSVSTAT_OK;
+}
+
+int scan_merge(ScanState *dst, const ScanState *src) {
+    if (!dst || !src) return -1;
+
+    dst->sc.rows_seen += src->sc.rows_seen;
+    dst->sc.numeric_ok += src->sc.numeric_ok;
+    dst->sc.numeric_bad += src->sc.numeric_bad;
+    dst->sc.missing_col += src->sc.missing_col;
+    dst->sc.range_rejected += src->sc.range_rejected;
+    dst->sc.where_rejected += src->sc.where_rejected;
+    dst->sc.corr_skipped += src->sc.corr_skipped;
+    dst->row_no += src->row_no;
+    diag_merge(&dst->diag, &src->diag);
+    profile_merge(&dst->prof, &src->prof);
+
+    if (decimal_stats_merge(&dst->dec, &src->dec) != 0) return -1;
+    if (comoment_merge(&dst->co, &src->co) != 0) return -1;
+    if (dst->cm_init && corr_matrix_merge(&dst->cm, &src->cm) != 0) return -1;
+    return stats_merge(&dst->st, &src->st);
+}
+
+void scan_stats(const ScanState *ss, Stats *out) {
+    if (!ss || !out) return;
+    if (ss->cfg && ss->cfg->decimal) {
+        decimal_stats_to_stats(&ss->dec, ss->cfg->scale, out);
+    } else {
+        *out = ss->st;
+    }
+}
+
+/*
+One parallel worker: scans the records of a single chunk with its own stream.
+*/
+typedef struct {
+    const char *path;
+    CsvChunk chunk;
+    ScanState ss;
+    int ss_init;
+    CsvStatErr err;
+    int saved_errno;
+} ScanWorker;
+
+static void *scan_worker(void *arg) {
+    ScanWorker *w = arg;
+    ScanState *ss = &w->ss;
+    uint64_t tt = 0;
+
+    w->err = CSVSTAT_OK;
+    w->saved_errno = 0;
+
+    if (w->chunk.start >= w->chunk.end) return NULL;
+
+    if (TRACE_ON()) {
+        char name[32];
+        snprintf(name, sizeof name, "worker %zu", ss->chunk);
+        trace_thread_name(name);
+    }
+    TRACE_START(tt);
+
+    Source src;
+    if (source_open(&src, w->path, 1) != 0) {
+        w->err = CSVSTAT_EIO;
+        w->saved_errno = errno;
+        return NULL;
+    }
+
+    LineReader lr;
+    if (line_reader_init_source(&lr, &src) != 0) {
+        w->err = CSVSTAT_EIO;
+        w->saved_errno = errno;
+        source_close(&src);
+        return NULL;
+    }
+    line_reader_set_quotes(&lr, ss->cfg->quotes);
+
+    if (line_reader_seek(&lr, w->chunk.start) != 0) {
+        w->err = CSVSTAT_EIO;
+        w->saved_errno = errno;
+        goto done;
+    }
+
+    if (scan_can_batch(ss->cfg)) {
+        w->err = scan_stream(ss, &lr, w->chunk.end - w->chunk.start, &w->saved_errno);
+        if (w->err == CSVSTAT_OK) w->err = scan_finish(ss);
+        goto done;
+    }
+
+    // Chunks start at record boundaries, so the last record of a chunk ends
+    // exactly at the next chunk's start.
+    while (lr.pos < w->chunk.end) {
+        const char *line = NULL;
+        size_t len = 0;
+        uint64_t t0 = 0;
+
+        const int timed = PROFILE_ON(&ss->prof) && profile_sample(&ss->prof, PROFILE_ROW_BURST);
+        PROFILE_START(timed, t0);
+        int rc = line_reader_next(&lr, &line, &len);
+        if (rc == 1) break;
+        if (rc != 0) {
+            w->err = CSVSTAT_EIO;
+            w->saved_errno = errno;
+            goto done;
+        }
+        PROFILE_STOP(timed, &ss->prof, PROF_READ, t0, len + 1, 1);
+
+        if (scan_is_empty_line(line)) continue;
+
+        w->err = scan_row(ss, (char *)line, NULL, 0);
+        if (w->err != CSVSTAT_OK) goto done;
+
+        w->err = scan_tick(ss, lr.pos);
+        if (w->err != CSVSTAT_OK) {
+            if (w->err == CSVSTAT_EIO) w->saved_errno = errno;
+            goto done;
+        }
+    }
+
+    w->err = scan_finish(ss);
+
+done:
+    line_reader_destroy(&lr);
+    source_close(&src);
+    TRACE_SPAN("chunk", tt, ss->row_no, w->chunk.end - w->chunk.start);
+    return NULL;
+}
+
+CsvStatErr scan_parallel(const ScanConfig *cfg, const char *path,
+                         unsigned long long begin, unsigned long long end,
+                         size_t nthreads, ScanState *out, int *saved_errno) {
+    if (!cfg || !path || !out || nthreads == 0 || cfg->split_all) return CSVSTAT_EINTERNAL;
+
+    CsvStatErr err = CSVSTAT_OK;
+    uint64_t tt = 0;
+
+    CsvChunk *chunks = csvstat_calloc(ALLOC_SCAN, nthreads, sizeof *chunks);
+    ScanWorker *workers = csvstat_calloc(ALLOC_SCAN, nthreads, sizeof *workers);
+    pthread_t *tids = csvstat_calloc(ALLOC_SCAN, nthreads, sizeof *tids);
+    size_t started = 0;
+
+    if (!chunks || !workers || !tids) {
+        err = CSVSTAT_ENOMEM;
+        goto cleanup;
+    }
+
+    TRACE_START(tt);
+    if (csv_chunk_plan(path, begin, end, cfg->quotes, nthreads, chunks) != 0) {
+        err = CSVSTAT_EIO;
+        if (saved_errno) *saved_errno = errno;
+        goto cleanup;
+    }
+    TRACE_SPAN("plan", tt, 0, end - begin);
+
+    for (size_t i = 0; i < nthreads; i++) {
+        ScanWorker *w = &workers[i];
+        w->path = path;
+        w->chunk = chunks[i];
+        if (scan_state_init(&w->ss, cfg) != 0) {
+            err = CSVSTAT_ENOMEM;
+            goto cleanup;
+        }
+        w->ss_init = 1;
+        w->ss.chunk = i;
+        diag_init(&w->ss.diag, cfg->rejects, i + 1);  // a sample stream of its own
+        w->ss.tick = out->tick;
+        w->ss.tick_ctx = out->tick_ctx;
+        w->ss.tick_every = out->tick_every;
+        w->ss.tick_origin = chunks[i].start;
+        profile_init(&w->ss.prof, out->prof.on);
+    }
+
+    for (; started < nthreads; started++) {
+        if (pthread_create(&tids[started], NULL, scan_worker, &workers[started]) != 0) {
+            err = CSVSTAT_EINTERNAL;
+            break;
+        }
+    }
+    for (size_t i = 0; i < started; i++) {
+        pthread_join(tids[i], NULL);
+    }
+    if (err != CSVSTAT_OK) goto cleanup;
+
+    // Merge in file order so the result is independent of scheduling.
+    TRACE_START(tt);
+    for (size_t i = 0; i < nthreads; i++) {
+        ScanWorker *w = &workers[i];
+        if (w->err != CSVSTAT_OK) {
+            err = w->err;
+            if (saved_errno) *saved_errno = w->saved_errno;
+            goto cleanup;
+        }
+        if (scan_merge(out, &w->ss) != 0) {
+            err = cfg->decimal ? CSVSTAT_EOVERFLOW : CSVSTAT_EINTERNAL;
+            goto cleanup;
+        }
+    }
+    TRACE_SPAN("merge", tt, out->row_no, 0);
+
+cleanup:
+    if (workers) {
+        for (size_t i = 0; i < nthreads; i++) {
+            if (workers[i].ss_init) scan_state_destroy(&workers[i].ss);
+        }
+    }
+    csvstat_free(tids);
+    csvstat_free(workers);
+    csvstat_free(chunks);
+    return err;
+}
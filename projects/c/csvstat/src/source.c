@@ -0,0 +1,822 @@
+#define _POSIX_C_SOURCE 200809L  // pread()
+
+#include "source.h"
+#include "csvstat_alloc.h"
+#include "trace.h"
+
+#include <string.h>    // memcpy
+#include <stdint.h>    // INT32_MAX, INT64_MAX
+#include <errno.h>
+#include <fcntl.h>     // open, fcntl
+#include <unistd.h>    // read, pread, lseek, close, dup
+#include <sys/stat.h>  // fstat
+#include <time.h>      // clock_gettime
+#include <pthread.h>
+
+#if defined(__linux__) && !defined(F_SETPIPE_SZ)
+#define F_SETPIPE_SZ 1031  // from <linux/fcntl.h>; hidden without _GNU_SOURCE
+#endif
+
+#ifdef CSVSTAT_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef CSVSTAT_HAVE_ZSTD
+#include <zstd.h>
+#include <sys/mman.h>  // mmap, munmap
+#endif
+
+#if defined(CSVSTAT_HAVE_ZLIB) || defined(CSVSTAT_HAVE_ZSTD)
+#define SOURCE_HAVE_DECODER 1
+#endif
+
+/*
+Implementation notes
+--------------------
+Decoders produce numbered blocks (0, 1, 2, ...) into a ring of `nslots`
+slots; block `seq` always lives in slot `seq % nslots`. A producer may fill
+block `seq` only once the reader has released block `seq - nslots`, so at
+most `nslots` decoded blocks exist at a time and memory stays bounded.
+
+The reader drains blocks strictly in sequence order. Streaming decoders
+(gzip, zstd without frame sizes) have one producer that emits blocks in
+order; parallel zstd workers take frames in order from a shared counter and
+may finish out of order, which the numbering absorbs.
+
+All shared decoder state is guarded by one mutex; a single condition
+variable signals both "slot released" and "block published".
+*/
+
+#ifdef SOURCE_HAVE_DECODER
+
+#define SOURCE_BLOCK (1u << 20)     // decoded block size for streaming decoders (bytes)
+#define SOURCE_IN_BLOCK (1u << 18)  // compressed read size (bytes)
+#define SOURCE_SLOTS 4              // ring size for a single streaming decoder
+#define SOURCE_MAX_THREADS 64
+#define SOURCE_MAX_FRAME (1ull << 30)  // larger frames are streamed, not buffered whole
+#define SOURCE_UNKNOWN ((unsigned long long)-1)
+
+typedef struct {
+    char *data;                // owned
+    size_t len;                // decoded bytes in data
+    size_t cap;
+    unsigned long long seq;    // block number, valid while full
+    int full;                  // published and not yet released by the reader
+} DecBlock;
+
+typedef struct {
+    size_t off;                // offset of the frame in the compressed file
+    size_t csize;              // compressed size
+    size_t dsize;              // decoded size (from the frame header)
+} ZFrame;
+
+struct SourceDecoder {
+    pthread_mutex_t mu;
+    pthread_cond_t cv;
+
+    DecBlock *slots;           // owned ring
+    size_t nslots;
+
+    unsigned long long next_read;  // block the reader consumes next
+    size_t read_off;               // reader offset inside that block
+    unsigned long long total;      // number of blocks once known, else SOURCE_UNKNOWN
+    int err;                       // first decoder failure (errno value), else 0
+    int cancel;                    // set by source_close()
+
+    pthread_t *threads;            // owned
+    size_t started;
+
+    int fd;                        // borrowed from the Source
+    unsigned char prefix[4];       // bytes the Source read before the decoder started
+    size_t prefix_len;
+    size_t prefix_pos;
+
+    // Parallel zstd frames.
+    const unsigned char *map;      // owned mapping of the compressed file
+    size_t map_len;
+    ZFrame *frames;                // owned
+    size_t nframes;
+    size_t next_frame;             // next frame to hand to a worker
+};
+
+/*
+Wait until block `seq` may be written. Returns its slot, or NULL when the
+decoder is cancelled or has failed.
+*/
+static DecBlock *claim_slot(SourceDecoder *d, unsigned long long seq) {
+    pthread_mutex_lock(&d->mu);
+    for (;;) {
+        if (d->cancel || d->err) {
+            pthread_mutex_unlock(&d->mu);
+            return NULL;
+        }
+        DecBlock *b = &d->slots[seq % d->nslots];
+        if (!b->full && seq < d->next_read + d->nslots) {
+            pthread_mutex_unlock(&d->mu);
+            return b;
+        }
+        pthread_cond_wait(&d->cv, &d->mu);
+    }
+}
+
+static void publish_slot(SourceDecoder *d, DecBlock *b, unsigned long long seq, size_t len) {
+    pthread_mutex_lock(&d->mu);
+    b->len = len;
+    b->seq = seq;
+    b->full = 1;
+    pthread_cond_broadcast(&d->cv);
+    pthread_mutex_unlock(&d->mu);
+}
+
+/*
+Record the end of the stream (`err == 0`, `total` blocks) or a failure.
+*/
+static void finish_decoder(SourceDecoder *d, unsigned long long total, int err) {
+    pthread_mutex_lock(&d->mu);
+    if (err) {
+        if (!d->err) d->err = err;
+    } else if (d->total == SOURCE_UNKNOWN) {
+        d->total = total;
+    }
+    pthread_cond_broadcast(&d->cv);
+    pthread_mutex_unlock(&d->mu);
+}
+
+/*
+Compressed input for a streaming decoder: the format-detection prefix (stdin
+only), then read() with EINTR retries. Returns bytes read, 0 at EOF, -1 on
+error.
+*/
+static ssize_t decoder_input(SourceDecoder *d, void *buf, size_t cap) {
+    if (d->prefix_pos < d->prefix_len) {
+        size_t n = d->prefix_len - d->prefix_pos;
+        if (n > cap) n = cap;
+        memcpy(buf, d->prefix + d->prefix_pos, n);
+        d->prefix_pos += n;
+        return (ssize_t)n;
+    }
+    for (;;) {
+        ssize_t n = read(d->fd, buf, cap);
+        if (n >= 0 || errno != EINTR) return n;
+    }
+}
+
+#endif  // SOURCE_HAVE_DECODER
+
+#ifdef CSVSTAT_HAVE_ZLIB
+
+/*
+gzip producer: inflate the whole file into consecutive blocks. Concatenated
+members (as written by `cat a.gz b.gz`) decode as one stream.
+*/
+static void *gzip_thread(void *arg) {
+    SourceDecoder *d = arg;
+    trace_thread_name("decoder");
+
+    unsigned char *in = csvstat_malloc(ALLOC_SOURCE, SOURCE_IN_BLOCK);
+    z_stream zs;
+    memset(&zs, 0, sizeof zs);
+    if (!in || inflateInit2(&zs, 15 + 32) != Z_OK) {  // +32: expect a gzip header
+        csvstat_free(in);
+        finish_decoder(d, 0, ENOMEM);
+        return NULL;
+    }
+
+    unsigned long long seq = 0;
+    int in_eof = 0;
+    int member_end = 0;  // the previous member ended; the next byte starts a new one
+    int done = 0;
+    int err = 0;
+
+    while (!done && !err) {
+        DecBlock *b = claim_slot(d, seq);
+        if (!b) break;
+
+        uint64_t tt = 0;
+        TRACE_START(tt);
+        zs.next_out = (Bytef *)b->data;
+        zs.avail_out = (uInt)b->cap;
+
+        while (zs.avail_out > 0) {
+            if (zs.avail_in == 0 && !in_eof) {
+                ssize_t n = decoder_input(d, in, SOURCE_IN_BLOCK);
+                if (n < 0) {
+                    err = errno;
+                    break;
+                }
+                if (n == 0) {
+                    in_eof = 1;
+                } else {
+                    zs.next_in = in;
+                    zs.avail_in = (uInt)n;
+                }
+            }
+            if (zs.avail_in == 0 && in_eof) {
+                if (!member_end) err = EIO;  // truncated member
+                done = 1;
+                break;
+            }
+            if (member_end) {
+                if (inflateReset(&zs) != Z_OK) {
+                    err = EIO;
+                    break;
+                }
+                member_end = 0;
+            }
+
+            int rc = inflate(&zs, Z_NO_FLUSH);
+            if (rc == Z_STREAM_END) {
+                member_end = 1;
+            } else if (rc == Z_MEM_ERROR) {
+                err = ENOMEM;
+                break;
+            } else if (rc != Z_OK && rc != Z_BUF_ERROR) {
+                err = EIO;  // corrupt data
+                break;
+            }
+        }
+
+        size_t len = b->cap - zs.avail_out;
+        TRACE_SPAN("decode", tt, 0, len);
+        if (len > 0 && !err) {
+            publish_slot(d, b, seq, len);
+            seq++;
+        }
+    }
+
+    inflateEnd(&zs);
+    csvstat_free(in);
+    finish_decoder(d, seq, err);
+    return NULL;
+}
+
+#endif  // CSVSTAT_HAVE_ZLIB
+
+#ifdef CSVSTAT_HAVE_ZSTD
+
+/*
+zstd producer for files without usable frame sizes: one streaming decoder.
+*/
+static void *zstd_stream_thread(void *arg) {
+    SourceDecoder *d = arg;
+    trace_thread_name("decoder");
+
+    unsigned char *in = csvstat_malloc(ALLOC_SOURCE, SOURCE_IN_BLOCK);
+    ZSTD_DCtx *dctx = ZSTD_createDCtx();
+    if (!in || !dctx) {
+        csvstat_free(in);
+        ZSTD_freeDCtx(dctx);
+        finish_decoder(d, 0, ENOMEM);
+        return NULL;
+    }
+
+    ZSTD_inBuffer zin = { in, 0, 0 };
+    unsigned long long seq = 0;
+    int in_eof = 0;
+    size_t hint = 0;  // 0 once a frame is complete and flushed
+    int done = 0;
+    int err = 0;
+
+    while (!done && !err) {
+        DecBlock *b = claim_slot(d, seq);
+        if (!b) break;
+
+        uint64_t tt = 0;
+        TRACE_START(tt);
+        ZSTD_outBuffer zout = { b->data, b->cap, 0 };
+
+        while (zout.pos < zout.size) {
+            if (zin.pos == zin.size && !in_eof) {
+                ssize_t n = decoder_input(d, in, SOURCE_IN_BLOCK);
+                if (n < 0) {
+                    err = errno;
+                    break;
+                }
+                if (n == 0) in_eof = 1;
+                zin.size = (size_t)n;
+                zin.pos = 0;
+            }
+
+            size_t before = zout.pos;
+            if (zin.pos < zin.size || hint != 0) {
+                hint = ZSTD_decompressStream(dctx, &zout, &zin);
+                if (ZSTD_isError(hint)) {
+                    err = EIO;
+                    break;
+                }
+            }
+            if (in_eof && zin.pos == zin.size && zout.pos == before) {
+                // No input left and nothing more to flush.
+                if (hint != 0) err = EIO;  // truncated frame
+                done = 1;
+                break;
+            }
+        }
+
+        TRACE_SPAN("decode", tt, 0, zout.pos);
+        if (zout.pos > 0 && !err) {
+            publish_slot(d, b, seq, zout.pos);
+            seq++;
+        }
+    }
+
+    ZSTD_freeDCtx(dctx);
+    csvstat_free(in);
+    finish_decoder(d, seq, err);
+    return NULL;
+}
+
+/*
+Parallel zstd worker: decode whole frames, one block per frame.
+*/
+static void *zstd_frame_thread(void *arg) {
+    SourceDecoder *d = arg;
+    trace_thread_name("decoder");
+
+    ZSTD_DCtx *dctx = ZSTD_createDCtx();
+    if (!dctx) {
+        finish_decoder(d, 0, ENOMEM);
+        return NULL;
+    }
+
+    for (;;) {
+        pthread_mutex_lock(&d->mu);
+        size_t i = d->next_frame;
+        if (i < d->nframes) d->next_frame++;
+        pthread_mutex_unlock(&d->mu);
+        if (i >= d->nframes) break;
+
+        DecBlock *b = claim_slot(d, i);
+        if (!b) break;
+
+        uint64_t tt = 0;
+        TRACE_START(tt);
+        const ZFrame *f = &d->frames[i];
+        if (f->dsize > b->cap) {
+            char *tmp = csvstat_realloc(ALLOC_SOURCE, b->data, f->dsize);
+            if (!tmp) {
+                finish_decoder(d, 0, ENOMEM);
+                break;
+            }
+            b->data = tmp;
+            b->cap = f->dsize;
+        }
+
+        size_t n = ZSTD_decompressDCtx(dctx, b->data, b->cap, d->map + f->off, f->csize);
+        if (ZSTD_isError(n) || n != f->dsize) {
+            finish_decoder(d, 0, EIO);
+            break;
+        }
+        TRACE_SPAN("decode", tt, 0, n);
+        publish_slot(d, b, i, n);
+    }
+
+    ZSTD_freeDCtx(dctx);
+    return NULL;
+}
+
+/*
+Map the file and list its frames. Returns 1 if every frame records its size
+(so frames can be decoded independently), 0 to fall back to streaming, -1 on
+error (errno is set).
+*/
+static int zstd_index_frames(SourceDecoder *d) {
+    struct stat sb;
+    if (fstat(d->fd, &sb) != 0) return -1;
+    if (!S_ISREG(sb.st_mode) || sb.st_size <= 0) return 0;
+
+    size_t len = (size_t)sb.st_size;
+    void *map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, d->fd, 0);
+    if (map == MAP_FAILED) return 0;  // not mappable: stream it
+
+    d->map = map;
+    d->map_len = len;
+
+    size_t cap = 0;
+    size_t off = 0;
+    while (off < len) {
+        const unsigned char *p = d->map + off;
+        size_t csize = ZSTD_findFrameCompressedSize(p, len - off);
+        if (ZSTD_isError(csize)) return 0;  // let the streaming decoder report it
+
+        unsigned long long dsize = ZSTD_getFrameContentSize(p, len - off);
+        if (dsize == ZSTD_CONTENTSIZE_UNKNOWN || dsize == ZSTD_CONTENTSIZE_ERROR ||
+            dsize > SOURCE_MAX_FRAME) {
+            return 0;
+        }
+
+        if (d->nframes == cap) {
+            size_t ncap = cap ? cap * 2 : 64;
+            ZFrame *tmp = csvstat_realloc(ALLOC_SOURCE, d->frames, ncap * sizeof *tmp);
+            if (!tmp) {
+                errno = ENOMEM;
+                return -1;
+            }
+            d->frames = tmp;
+            cap = ncap;
+        }
+        d->frames[d->nframes].off = off;
+        d->frames[d->nframes].csize = csize;
+        d->frames[d->nframes].dsize = (size_t)dsize;
+        d->nframes++;
+
+        off += csize;
+    }
+
+    return d->nframes > 1;
+}
+
+#endif  // CSVSTAT_HAVE_ZSTD
+
+#ifdef SOURCE_HAVE_DECODER
+
+static void decoder_free(SourceDecoder *d) {
+    if (!d) return;
+
+    pthread_mutex_lock(&d->mu);
+    d->cancel = 1;
+    pthread_cond_broadcast(&d->cv);
+    pthread_mutex_unlock(&d->mu);
+
+    for (size_t i = 0; i < d->started; i++) {
+        pthread_join(d->threads[i], NULL);
+    }
+
+    if (d->slots) {
+        for (size_t i = 0; i < d->nslots; i++) csvstat_free(d->slots[i].data);
+    }
+#ifdef CSVSTAT_HAVE_ZSTD
+    if (d->map) munmap((void *)d->map, d->map_len);
+#endif
+    csvstat_free(d->frames);
+    csvstat_free(d->slots);
+    csvstat_free(d->threads);
+    pthread_cond_destroy(&d->cv);
+    pthread_mutex_destroy(&d->mu);
+    csvstat_free(d);
+}
+
+/*
+Create the decoder for `kind` and start its threads. `prefix` holds bytes
+already read from a stream input (none for files, which are read from 0).
+Returns NULL on failure (errno is set).
+*/
+static SourceDecoder *decoder_start(SourceKind kind, int fd, size_t threads,
+                                    const unsigned char *prefix, size_t prefix_len) {
+    SourceDecoder *d = csvstat_calloc(ALLOC_SOURCE, 1, sizeof *d);
+    if (!d) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    if (pthread_mutex_init(&d->mu, NULL) != 0) {
+        csvstat_free(d);
+        errno = ENOMEM;
+        return NULL;
+    }
+    if (pthread_cond_init(&d->cv, NULL) != 0) {
+        pthread_mutex_destroy(&d->mu);
+        csvstat_free(d);
+        errno = ENOMEM;
+        return NULL;
+    }
+    d->fd = fd;
+    d->total = SOURCE_UNKNOWN;
+    memcpy(d->prefix, prefix, prefix_len);
+    d->prefix_len = prefix_len;
+
+    void *(*fn)(void *) = NULL;
+    size_t nthreads = 1;
+    size_t block = SOURCE_BLOCK;
+
+    if (threads == 0) threads = 1;
+    if (threads > SOURCE_MAX_THREADS) threads = SOURCE_MAX_THREADS;
+
+#ifdef CSVSTAT_HAVE_ZLIB
+    if (kind == SOURCE_GZIP) fn = gzip_thread;
+#endif
+#ifdef CSVSTAT_HAVE_ZSTD
+    if (kind == SOURCE_ZSTD) {
+        fn = zstd_stream_thread;
+        int indexed = (prefix_len == 0) ? zstd_index_frames(d) : 0;
+        if (indexed < 0) {
+            int saved = errno;
+            decoder_free(d);
+            errno = saved;
+            return NULL;
+        }
+        if (indexed && threads > 1) {
+            fn = zstd_frame_thread;
+            nthreads = (threads < d->nframes) ? threads : d->nframes;
+            block = 0;                       // sized per frame by the workers
+            d->total = d->nframes;
+        }
+    }
+#endif
+    if (!fn) {
+        decoder_free(d);
+        errno = ENOTSUP;
+        return NULL;
+    }
+
+    // Two slots per worker keep every worker busy while the reader drains.
+    d->nslots = (nthreads > 1) ? 2 * nthreads : SOURCE_SLOTS;
+    d->slots = csvstat_calloc(ALLOC_SOURCE, d->nslots, sizeof *d->slots);
+    d->threads = csvstat_calloc(ALLOC_SOURCE, nthreads, sizeof *d->threads);
+    if (!d->slots || !d->threads) {
+        decoder_free(d);
+        errno = ENOMEM;
+        return NULL;
+    }
+    for (size_t i = 0; i < d->nslots && block > 0; i++) {
+        d->slots[i].data = csvstat_malloc(ALLOC_SOURCE, block);
+        if (!d->slots[i].data) {
+            decoder_free(d);
+            errno = ENOMEM;
+            return NULL;
+        }
+        d->slots[i].cap = block;
+    }
+
+    for (; d->started < nthreads; d->started++) {
+        if (pthread_create(&d->threads[d->started], NULL, fn, d) != 0) {
+            decoder_free(d);
+            errno = EAGAIN;
+            return NULL;
+        }
+    }
+
+    return d;
+}
+
+/*
+Copy decoded bytes to `buf`, blocking until the next block is ready.
+*/
+static int decoder_read(SourceDecoder *d, char *buf, size_t cap, size_t *got) {
+    pthread_mutex_lock(&d->mu);
+
+    DecBlock *b = NULL;
+    for (;;) {
+        if (d->err) {
+            int err = d->err;
+            pthread_mutex_unlock(&d->mu);
+            errno = err;
+            return -1;
+        }
+        if (d->next_read >= d->total) {
+            pthread_mutex_unlock(&d->mu);
+            *got = 0;
+            return 0;
+        }
+
+        b = &d->slots[d->next_read % d->nslots];
+        if (b->full && b->seq == d->next_read) {
+            if (d->read_off < b->len) break;
+
+            // Drained (or empty) block: hand the slot back to the producers.
+            b->full = 0;
+            d->next_read++;
+            d->read_off = 0;
+            pthread_cond_broadcast(&d->cv);
+            continue;
+        }
+        pthread_cond_wait(&d->cv, &d->mu);
+    }
+    pthread_mutex_unlock(&d->mu);
+
+    // The block stays ours until released, so copy without the lock.
+    size_t n = b->len - d->read_off;
+    if (n > cap) n = cap;
+    memcpy(buf, b->data + d->read_off, n);
+    d->read_off += n;
+    *got = n;
+
+    return 0;
+}
+
+#endif  // SOURCE_HAVE_DECODER
+
+static unsigned long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ull + (unsigned long long)ts.tv_nsec;
+}
+
+/*
+Read the format magic. Files are probed with pread() and left at offset 0;
+stream input cannot be rewound, so its bytes are kept in `src->head`.
+Returns the number of magic bytes available, or -1 on error.
+*/
+static ssize_t read_magic(Source *src, unsigned char *magic, size_t cap) {
+    if (!src->stream) return pread(src->fd, magic, cap, 0);
+
+    size_t have = 0;
+    while (have < cap) {
+        ssize_t n = read(src->fd, magic + have, cap - have);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (n == 0) break;
+        have += (size_t)n;
+    }
+    memcpy(src->head, magic, have);
+    src->head_len = have;
+    return (ssize_t)have;
+}
+
+int source_open(Source *src, const char *path, size_t threads) {
+    if (!src || !path) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    src->kind = SOURCE_PLAIN;
+    src->fd = -1;
+    src->pos = 0;
+    src->dec = NULL;
+    src->stream = (strcmp(path, "-") == 0);
+    src->head_len = 0;
+    src->head_pos = 0;
+    src->wait_ns = 0;
+
+    // stdin is duplicated so closing the Source never closes fd 0.
+    int fd = src->stream ? dup(STDIN_FILENO) : open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    src->fd = fd;
+
+    unsigned char magic[4] = {0};
+    ssize_t n = read_magic(src, magic, sizeof magic);
+    if (n < 0) {
+        int saved = errno;
+        close(fd);
+        src->fd = -1;
+        errno = saved;
+        return -1;
+    }
+
+    SourceKind kind = SOURCE_PLAIN;
+    if (n >= 2 && magic[0] == 0x1f && magic[1] == 0x8b) {
+        kind = SOURCE_GZIP;
+    } else if (n >= 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd) {
+        kind = SOURCE_ZSTD;
+    }
+
+    if (kind != SOURCE_PLAIN) {
+#ifdef SOURCE_HAVE_DECODER
+        // The decoder consumes the magic bytes itself.
+        SourceDecoder *d = decoder_start(kind, fd, threads, src->head, src->head_len);
+        if (!d) {
+            int saved = errno;
+            close(fd);
+            src->fd = -1;
+            errno = saved;
+            return -1;
+        }
+        src->dec = d;
+        src->head_len = 0;
+#else
+        (void)threads;
+        close(fd);
+        src->fd = -1;
+        errno = ENOTSUP;
+        return -1;
+#endif
+    }
+
+    src->kind = kind;
+    return 0;
+}
+
+void source_close(Source *src) {
+    if (!src) return;
+
+#ifdef SOURCE_HAVE_DECODER
+    decoder_free(src->dec);  // joins the threads before the fd goes away
+#endif
+    src->dec = NULL;
+
+    if (src->fd >= 0) close(src->fd);
+    src->fd = -1;
+    src->pos = 0;
+    src->kind = SOURCE_PLAIN;
+    src->stream = 0;
+    src->head_len = 0;
+    src->head_pos = 0;
+}
+
+int source_read(Source *src, char *buf, size_t cap, size_t *got) {
+    if (!src || !buf || !got || src->fd < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    *got = 0;
+    if (cap == 0) return 0;
+
+    if (src->head_pos < src->head_len) {
+        // Format-detection bytes of a plain stream come first.
+        size_t n = src->head_len - src->head_pos;
+        if (n > cap) n = cap;
+        memcpy(buf, src->head + src->head_pos, n);
+        src->head_pos += n;
+        src->pos += n;
+        *got = n;
+        return 0;
+    }
+
+    unsigned long long t0 = now_ns();
+
+#ifdef SOURCE_HAVE_DECODER
+    if (src->dec) {
+        uint64_t tt = 0;
+        TRACE_START(tt);
+        int rc = decoder_read(src->dec, buf, cap, got);
+        TRACE_SPAN("wait", tt, 0, *got);
+        src->wait_ns += now_ns() - t0;
+        if (rc != 0) return -1;
+        src->pos += *got;
+        return 0;
+    }
+#endif
+
+    for (;;) {
+        ssize_t n = read(src->fd, buf, cap);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        src->wait_ns += now_ns() - t0;
+        *got = (size_t)n;
+        src->pos += (size_t)n;
+        return 0;
+    }
+}
+
+int source_seek(Source *src, unsigned long long off) {
+    if (!src || src->fd < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (!src->dec && !src->stream) {
+        if (off > (unsigned long long)INT64_MAX ||
+            lseek(src->fd, (off_t)off, SEEK_SET) == (off_t)-1) {
+            return -1;
+        }
+        src->pos = off;
+        return 0;
+    }
+
+    if (off < src->pos) {
+        errno = ESPIPE;
+        return -1;
+    }
+
+    // Forward on a compressed or read-once stream: read and discard.
+    char skip[16384];
+    while (src->pos < off) {
+        size_t want = sizeof skip;
+        if (off - src->pos < want) want = (size_t)(off - src->pos);
+
+        size_t got = 0;
+        if (source_read(src, skip, want, &got) != 0) return -1;
+        if (got == 0) break;  // past the end: later reads see EOF
+    }
+    return 0;
+}
+
+int source_is_seekable(const Source *src) {
+    if (!src || src->fd < 0 || src->dec || src->stream) return 0;
+
+    struct stat sb;
+    return fstat(src->fd, &sb) == 0 && S_ISREG(sb.st_mode);
+}
+
+int source_set_pipe_size(Source *src, size_t bytes) {
+    if (!src || src->fd < 0 || bytes == 0 || bytes > INT32_MAX) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    struct stat sb;
+    if (fstat(src->fd, &sb) != 0) return -1;
+    if (!S_ISFIFO(sb.st_mode)) {
+        errno = ENOTSUP;  // not a pipe: nothing to resize
+        return -1;
+    }
+
+#ifdef F_SETPIPE_SZ
+    // The kernel rounds up to a power-of-two number of pages.
+    return fcntl(src->fd, F_SETPIPE_SZ, (int)bytes) < 0 ? -1 : 0;
+#else
+    errno = ENOTSUP;
+    return -1;
+#endif
+}
+
+const char *source_kind_name(SourceKind kind) {
+    switch (kind) {
+        case SOURCE_PLAIN: return "plain";
+        case SOURCE_GZIP:  return "gzip";
+        case SOURCE_ZSTD:  return "zstd";
+        default:           return "unknown";
+    }
+}
@@ -1,15 +1,25 @@
 #include "stats.h"
 #include "csvstat_assert.h"
 
-#include <math.h>   // sqrt
+#include <math.h>   // sqrt, fabs, fma
+#include <string.h> // strcmp
+
+static const char *const precision_names[STATS_NPRECISIONS] = {
+    "welford", "neumaier", "pairwise",
+};
 
 int stats_is_valid(const Stats *st) {
     if (!st) return 0;
 
+    if ((unsigned)st->precision >= STATS_NPRECISIONS) return 0;
+    if (st->precision == STATS_WELFORD && (st->sum != 0.0 || st->sum_c != 0.0 || st->m2_c != 0.0)) {
+        return 0;
+    }
+
     if (st->n == 0) {
         // when empty, min/max may be uninitialized depending on the design;
         // but M2 should be 0 and mean should be 0 (or stable).
-        if (st->m2 != 0.0) return 0;
+        if (st->m2 != 0.0 || st->m3 != 0.0 || st->m4 != 0.0) return 0;
         return 1;
     }
 
@@ -19,6 +29,9 @@ int stats_is_valid(const Stats *st) {
 
     // Numeric drift shouldn't make this negative; allow a tiny epsilon if wanted.
     if (st->m2 < 0.0) return 0;
+
+    // m4 is a sum of fourth powers; m3 has no sign constraint.
+    if (st->moments ? st->m4 < 0.0 : (st->m3 != 0.0 || st->m4 != 0.0)) return 0;
     
     return 1;
 }
@@ -40,10 +53,406 @@ void stats_init(Stats *s) {
     s->n = 0;
     s->mean = 0.0;
     s->m2 = 0.0;
+    s->m3 = 0.0;
+    s->m4 = 0.0;
     s->min = 0.0;
     s->max = 0.0;
+    s->moments = 0;
+    s->precision = STATS_WELFORD;
+    s->sum = 0.0;
+    s->sum_c = 0.0;
+    s->m2_c = 0.0;
+
+    CSVSTAT_ASSERT(stats_is_valid(s));
+}
+
+void stats_init_moments(Stats *s) {
+    if (!s) return;
+    stats_init(s);
+    s->moments = 1;
+}
+
+int stats_set_precision(Stats *s, StatsPrecision p) {
+    if (!s || s->n != 0 || (unsigned)p >= STATS_NPRECISIONS) return -1;
+    s->precision = (int)p;
+    return 0;
+}
+
+const char *stats_precision_name(StatsPrecision p) {
+    return (unsigned)p < STATS_NPRECISIONS ? precision_names[p] : "?";
+}
+
+int stats_precision_parse(const char *name, StatsPrecision *out) {
+    if (!name || !out) return -1;
+    for (int p = 0; p < STATS_NPRECISIONS; p++) {
+        if (strcmp(name, precision_names[p]) == 0) {
+            *out = (StatsPrecision)p;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/*
+m2 including its compensation (0 in STATS_WELFORD mode).
+*/
+static double m2_total(const Stats *s) {
+    return s->m2 + s->m2_c;
+}
+
+/*
+Neumaier's step: add `x` to the compensated sum (*s, *c).
+*/
+static void neumaier_add(double *s, double *c, double x) {
+    double t = *s + x;
+    *c += fabs(*s) >= fabs(x) ? (*s - t) + x : (x - t) + *s;
+    *s = t;
+}
+
+/*
+Mean of the compensated sum (sum, sum_c) of `n` values as an unevaluated
+pair hi + lo: the rounding error of sum/n (exact through fma) and the
+compensation are divided separately, so the pair keeps the precision of the
+sum.
+*/
+static void mean_parts(double sum, double sum_c, double n, double *hi, double *lo) {
+    *hi = sum / n;
+    *lo = (fma(-*hi, n, sum) + sum_c) / n;
+}
+
+static double mean_of(double sum, double sum_c, double n) {
+    double hi, lo;
+    mean_parts(sum, sum_c, n, &hi, &lo);
+    return hi + lo;
+}
+
+/*
+src mean - dst mean from the sums. The high parts are close, so their
+difference is exact and the low parts keep the bits a difference of two
+rounded means would lose.
+*/
+static double mean_delta(const Stats *dst, const Stats *src) {
+    double ha, la, hb, lb;
+    mean_parts(dst->sum, dst->sum_c, (double)dst->n, &ha, &la);
+    mean_parts(src->sum, src->sum_c, (double)src->n, &hb, &lb);
+    return (hb - ha) + (lb - la);
+}
+
+/*
+Sum (with compensation), minimum and maximum of a block.
+*/
+typedef struct {
+    double sum;
+    double sum_c;
+    double min;
+    double max;
+} BlockSum;
+
+/*
+Central sums of a block around a center c: sum of (x-c)^k for k = 1..4
+(d3/d4 only with moments).
+*/
+typedef struct {
+    double d1;
+    double d2;
+    double d3;
+    double d4;
+} DevSums;
+
+/*
+Add the lanes of `a` pairwise into a[0] and return it.
+*/
+static double lanes_total(double *a) {
+    for (size_t w = STATS_LANES / 2; w > 0; w /= 2) {
+        for (size_t j = 0; j < w; j++) a[j] += a[j + w];
+    }
+    return a[0];
+}
+
+static void lanes_min_max(double *lo, double *hi, BlockSum *out) {
+    for (size_t w = STATS_LANES / 2; w > 0; w /= 2) {
+        for (size_t j = 0; j < w; j++) {
+            lo[j] = lo[j + w] < lo[j] ? lo[j + w] : lo[j];
+            hi[j] = hi[j + w] > hi[j] ? hi[j + w] : hi[j];
+        }
+    }
+    out->min = lo[0];
+    out->max = hi[0];
+}
+
+/*
+Plain lane-wise sum of x[0..n), n >= 1 (the leaves of the pairwise sum).
+*/
+static void sum_lanes(const double *x, size_t n, BlockSum *out) {
+    double s[STATS_LANES] = {0}, lo[STATS_LANES], hi[STATS_LANES];
+    for (size_t j = 0; j < STATS_LANES; j++) lo[j] = hi[j] = x[0];
+
+    size_t i = 0;
+    for (; i + STATS_LANES <= n; i += STATS_LANES) {
+        for (size_t j = 0; j < STATS_LANES; j++) {
+            double v = x[i + j];
+            s[j] += v;
+            lo[j] = v < lo[j] ? v : lo[j];
+            hi[j] = v > hi[j] ? v : hi[j];
+        }
+    }
+    for (size_t j = 0; i < n; i++, j++) {
+        s[j] += x[i];
+        lo[j] = x[i] < lo[j] ? x[i] : lo[j];
+        hi[j] = x[i] > hi[j] ? x[i] : hi[j];
+    }
+
+    out->sum = lanes_total(s);
+    out->sum_c = 0.0;
+    lanes_min_max(lo, hi, out);
+}
+
+/*
+STATS_PAIRWISE: split x[0..n) in halves (at a multiple of STATS_LANES) down
+to STATS_PAIRWISE_BASE values.
+*/
+static void sum_pairwise(const double *x, size_t n, BlockSum *out) {
+    if (n <= STATS_PAIRWISE_BASE) {
+        sum_lanes(x, n, out);
+        return;
+    }
+    size_t h = n / 2 / STATS_LANES * STATS_LANES;
+    BlockSum a, b;
+    sum_pairwise(x, h, &a);
+    sum_pairwise(x + h, n - h, &b);
+    out->sum = a.sum + b.sum;
+    out->sum_c = 0.0;
+    out->min = b.min < a.min ? b.min : a.min;
+    out->max = b.max > a.max ? b.max : a.max;
+}
+
+/*
+STATS_NEUMAIER: lane-wise compensated sum of x[0..n), n >= 1.
+*/
+static void sum_neumaier(const double *x, size_t n, BlockSum *out) {
+    double s[STATS_LANES] = {0}, c[STATS_LANES] = {0}, lo[STATS_LANES], hi[STATS_LANES];
+    for (size_t j = 0; j < STATS_LANES; j++) lo[j] = hi[j] = x[0];
+
+    size_t i = 0;
+    for (; i + STATS_LANES <= n; i += STATS_LANES) {
+        for (size_t j = 0; j < STATS_LANES; j++) {
+            double v = x[i + j];
+            double t = s[j] + v;
+            int ge = fabs(s[j]) >= fabs(v);
+            double big = ge ? s[j] : v;    // selects, not branches: vectorizes
+            double small = ge ? v : s[j];
+            c[j] += (big - t) + small;
+            s[j] = t;
+            lo[j] = v < lo[j] ? v : lo[j];
+            hi[j] = v > hi[j] ? v : hi[j];
+        }
+    }
+    for (size_t j = 0; i < n; i++, j++) {
+        neumaier_add(&s[j], &c[j], x[i]);
+        lo[j] = x[i] < lo[j] ? x[i] : lo[j];
+        hi[j] = x[i] > hi[j] ? x[i] : hi[j];
+    }
+
+    double sum = s[0], comp = 0.0;
+    for (size_t j = 1; j < STATS_LANES; j++) neumaier_add(&sum, &comp, s[j]);
+    out->sum = sum;
+    out->sum_c = comp + lanes_total(c);
+    lanes_min_max(lo, hi, out);
+}
+
+/*
+Central sums of x[0..n) around c in STATS_LANES lanes.
+*/
+static void dev_lanes(const double *x, size_t n, double c, int moments, DevSums *out) {
+    double s1[STATS_LANES] = {0}, s2[STATS_LANES] = {0};
+    double s3[STATS_LANES] = {0}, s4[STATS_LANES] = {0};
+    size_t i = 0;
+
+    if (!moments) {
+        for (; i + STATS_LANES <= n; i += STATS_LANES) {
+            for (size_t j = 0; j < STATS_LANES; j++) {
+                double d = x[i + j] - c;
+                s1[j] += d;
+                s2[j] += d * d;
+            }
+        }
+    } else {
+        for (; i + STATS_LANES <= n; i += STATS_LANES) {
+            for (size_t j = 0; j < STATS_LANES; j++) {
+                double d = x[i + j] - c;
+                double d2 = d * d;
+                s1[j] += d;
+                s2[j] += d2;
+                s3[j] += d2 * d;
+                s4[j] += d2 * d2;
+            }
+        }
+    }
+    for (size_t j = 0; i < n; i++, j++) {
+        double d = x[i] - c;
+        s1[j] += d;
+        s2[j] += d * d;
+        s3[j] += d * d * d;
+        s4[j] += d * d * d * d;
+    }
+
+    out->d1 = lanes_total(s1);
+    out->d2 = lanes_total(s2);
+    out->d3 = moments ? lanes_total(s3) : 0.0;
+    out->d4 = moments ? lanes_total(s4) : 0.0;
+}
+
+/*
+Central sums of x[0..n), split pairwise down to `base` values.
+*/
+static void dev_sums(const double *x, size_t n, double c, int moments, size_t base, DevSums *out) {
+    if (n <= base) {
+        dev_lanes(x, n, c, moments, out);
+        return;
+    }
+    size_t h = n / 2 / STATS_LANES * STATS_LANES;
+    DevSums a, b;
+    dev_sums(x, h, c, moments, base, &a);
+    dev_sums(x + h, n - h, c, moments, base, &b);
+    out->d1 = a.d1 + b.d1;
+    out->d2 = a.d2 + b.d2;
+    out->d3 = a.d3 + b.d3;
+    out->d4 = a.d4 + b.d4;
+}
+
+/*
+Summarize the block x[0..n), n >= 1, as an accumulator `b` of the same kind
+as `s`: the sum first, then the central sums around the block's mean. The
+computed mean is off by e = d1/n; the corrected two-pass formulas remove
+that error from m2 (and m3/m4), and in STATS_PAIRWISE d1 corrects the sum.
+*/
+static void summarize_block(const Stats *s, const double *x, size_t n, Stats *b) {
+    int pairwise = (s->precision == STATS_PAIRWISE);
+    BlockSum bs;
+    if (pairwise) {
+        sum_pairwise(x, n, &bs);
+    } else {
+        sum_neumaier(x, n, &bs);
+    }
+
+    double cnt = (double)n;
+    double mb = mean_of(bs.sum, bs.sum_c, cnt);
+    DevSums d;
+    dev_sums(x, n, mb, s->moments, pairwise ? STATS_PAIRWISE_BASE : n, &d);
+    double e = d.d1 / cnt;
+
+    stats_init(b);
+    b->n = n;
+    b->moments = s->moments;
+    b->precision = s->precision;
+    if (pairwise) {
+        // The pairwise sum keeps its rounding error; n*mb + d1, which sums
+        // the much smaller deviations, mostly does not.
+        b->sum = cnt * mb;
+        b->sum_c = fma(cnt, mb, -b->sum) + d.d1;
+    } else {
+        b->sum = bs.sum;
+        b->sum_c = bs.sum_c;
+    }
+    b->mean = mb + e;
+    b->m2 = d.d2 - d.d1 * e;
+    if (b->m2 < 0.0) b->m2 = 0.0;
+    if (s->moments) {
+        b->m3 = d.d3 - 3.0 * e * d.d2 + 2.0 * cnt * e * e * e;
+        b->m4 = d.d4 - 4.0 * e * d.d3 + 6.0 * e * e * d.d2 - 3.0 * cnt * e * e * e * e;
+        if (b->m4 < 0.0) b->m4 = 0.0;
+    }
+    b->min = bs.min;
+    b->max = bs.max;
+}
+
+static int merge_nonempty(Stats *dst, const Stats *src);
+
+/*
+`stats_push_batch()` in a precision mode. The state is restored if any
+block fails, so a failed batch adds nothing.
+*/
+static int push_blocks(Stats *s, const double *x, size_t n) {
+    int bad = 0;
+    for (size_t i = 0; i < n; i++) bad |= !isfinite(x[i]);
+    if (bad || s->n > (size_t)-1 - n) return -1;
+
+    Stats saved = *s;
+    while (n > 0) {
+        size_t m = n < STATS_BLOCK ? n : STATS_BLOCK;
+        Stats b;
+        summarize_block(s, x, m, &b);
+        if (!isfinite(b.sum) || !isfinite(b.m2) || !isfinite(b.m3) || !isfinite(b.m4)) {
+            *s = saved;
+            return -1;
+        }
+        if (s->n == 0) {
+            *s = b;
+        } else if (merge_nonempty(s, &b) != 0) {
+            *s = saved;
+            return -1;
+        }
+        x += m;
+        n -= m;
+    }
+    return 0;
+}
+
+/*
+`stats_push()` in a precision mode for n >= 1 without moments: a block of
+one, without the block machinery. The deviations are taken from the mean
+as a hi + lo pair, like `mean_delta()`.
+*/
+static int push_compensated(Stats *s, double x) {
+    if (s->n == (size_t)-1) return -1; // overflow guard
+
+    double hi, lo;
+    mean_parts(s->sum, s->sum_c, (double)s->n, &hi, &lo);
+    double delta = (x - hi) - lo;
+
+    s->n++;
+    neumaier_add(&s->sum, &s->sum_c, x);
+    mean_parts(s->sum, s->sum_c, (double)s->n, &hi, &lo);
+    s->mean = hi + lo;
+    neumaier_add(&s->m2, &s->m2_c, delta * ((x - hi) - lo));
+
+    if (!isfinite(s->sum) || !isfinite(s->sum_c) || !isfinite(s->m2) || !isfinite(s->m2_c)) return -1;
+
+    if (x < s->min) s->min = x;
+    if (x > s->max) s->max = x;
+
+    CSVSTAT_ASSERT(stats_is_valid(s));
+    return 0;
+}
+
+/*
+`stats_push()` for an accumulator with moments and n >= 1 (Pébay 2008,
+eq. 2.1-2.3). m4 and m3 use the previous m3 and m2, so they are updated in
+that order.
+*/
+static int push_moments(Stats *s, double x) {
+    if (s->n == (size_t)-1) return -1; // overflow guard
+
+    double n1 = (double)s->n;
+    double n = n1 + 1.0;
+    double delta = x - s->mean;
+    double delta_n = delta / n;
+    double delta_n2 = delta_n * delta_n;
+    double term1 = delta * delta_n * n1;
+
+    s->n++;
+    s->mean += delta_n;
+    s->m4 += term1 * delta_n2 * (n * n - 3.0 * n + 3.0) + 6.0 * delta_n2 * s->m2 - 4.0 * delta_n * s->m3;
+    s->m3 += term1 * delta_n * (n - 2.0) - 3.0 * delta_n * s->m2;
+    s->m2 += term1;
+
+    if (!isfinite(s->mean) || !isfinite(s->m2) || !isfinite(s->m3) || !isfinite(s->m4)) return -1;
+
+    if (x < s->min) s->min = x;
+    if (x > s->max) s->max = x;
 
     CSVSTAT_ASSERT(stats_is_valid(s));
+    return 0;
 }
 
 int stats_push(Stats *s, double x) {
@@ -54,6 +463,10 @@ int stats_push(Stats *s, double x) {
 
     CSVSTAT_ASSERT(stats_is_valid(s));
 
+    if (s->precision != STATS_WELFORD) {
+        return (s->n == 0 || s->moments) ? push_blocks(s, &x, 1) : push_compensated(s, x);
+    }
+
     // First value initializes the running state.
     if (s->n == 0) {
         s->n = 1;
@@ -68,6 +481,8 @@ int stats_push(Stats *s, double x) {
         return 0;
     }
 
+    if (s->moments) return push_moments(s, x);
+
     if (s->n == (size_t)-1) return -1; // overflow guard
     s->n++;
     double delta = x - s->mean;
@@ -87,6 +502,86 @@ int stats_push(Stats *s, double x) {
     return 0;
 }
 
+int stats_push_batch(Stats *s, const double *x, size_t n) {
+    if (!s || (!x && n > 0)) return -1;
+
+    CSVSTAT_ASSERT(stats_is_valid(s));
+
+    if (s->precision != STATS_WELFORD) return push_blocks(s, x, n);
+
+    for (size_t i = 0; i < n; i++) {
+        if (stats_push(s, x[i]) != 0) return -1;
+    }
+    return 0;
+}
+
+/*
+Merge two non-empty accumulators of the same kind. In the precision modes
+the sum and m2 are added with compensation and the mean is derived from the
+sum.
+*/
+static int merge_nonempty(Stats *dst, const Stats *src) {
+    if (dst->n > (size_t)-1 - src->n) return -1; // overflow guard
+
+    double na = (double)dst->n;
+    double nb = (double)src->n;
+    double n = na + nb;
+    double delta = src->mean - dst->mean;
+    if (dst->precision != STATS_WELFORD) delta = mean_delta(dst, src);
+
+    if (dst->moments) {
+        // Pébay 2008, eq. 3.1: m3 and m4 need the m2 (and m3) of both sides.
+        double ma2 = m2_total(dst);
+        double mb2 = m2_total(src);
+        double d2 = delta * delta;
+        double m3 = src->m3 + delta * d2 * na * nb * (na - nb) / (n * n) +
+                    3.0 * delta * (na * mb2 - nb * ma2) / n;
+        double m4 = src->m4 + d2 * d2 * na * nb * (na * na - na * nb + nb * nb) / (n * n * n) +
+                    6.0 * d2 * (na * na * mb2 + nb * nb * ma2) / (n * n) +
+                    4.0 * delta * (na * src->m3 - nb * dst->m3) / n;
+        dst->m3 += m3;
+        dst->m4 += m4;
+        if (!isfinite(dst->m3) || !isfinite(dst->m4)) return -1;
+    }
+
+    if (dst->precision == STATS_WELFORD) {
+        dst->mean += delta * (nb / n);
+        dst->m2 += src->m2 + delta * delta * (na * nb / n);
+    } else {
+        neumaier_add(&dst->sum, &dst->sum_c, src->sum);
+        neumaier_add(&dst->sum, &dst->sum_c, src->sum_c);
+        dst->mean = mean_of(dst->sum, dst->sum_c, n);
+        neumaier_add(&dst->m2, &dst->m2_c, src->m2);
+        neumaier_add(&dst->m2, &dst->m2_c, src->m2_c + delta * delta * (na * nb / n));
+        if (!isfinite(dst->sum) || !isfinite(dst->sum_c) || !isfinite(dst->m2_c)) return -1;
+    }
+    dst->n += src->n;
+
+    if (src->min < dst->min) dst->min = src->min;
+    if (src->max > dst->max) dst->max = src->max;
+
+    if (!isfinite(dst->mean) || !isfinite(dst->m2)) return -1;
+
+    CSVSTAT_ASSERT(stats_is_valid(dst));
+    return 0;
+}
+
+int stats_merge(Stats *dst, const Stats *src) {
+    if (!dst || !src) return -1;
+
+    CSVSTAT_ASSERT(stats_is_valid(dst));
+    CSVSTAT_ASSERT(stats_is_valid(src));
+
+    if (src->n == 0) return 0;
+    if (dst->n == 0) {
+        *dst = *src;
+        return 0;
+    }
+
+    if (dst->moments != src->moments || dst->precision != src->precision) return -1;
+    return merge_nonempty(dst, src);
+}
+
 int stats_mean(const Stats *s, double *out_mean) {
     if (!s || !out_mean) return -1;
     if (s->n == 0) { *out_mean = 0.0; return -1; }
@@ -111,7 +606,7 @@ int stats_max(const Stats *s, double *out_max) {
 int stats_variance_sample(const Stats *s, double *out_var) {
     if (!s || !out_var) return -1;
     if (s->n < 2) { *out_var = 0.0; return -1; }
-    *out_var = s->m2 / (double)(s->n - 1);
+    *out_var = m2_total(s) / (double)(s->n - 1);
     return 0;
 }
 
@@ -121,4 +616,48 @@ int stats_stddev_sample(const Stats *s, double *out_std) {
     if (stats_variance_sample(s, &var) != 0) { *out_std = 0.0; return -1; }
     *out_std = sqrt(var);
     return 0;
-}
\ No newline at end of file
+}
+
+/*
+Check the common requirements of the shape statistics: moments tracked, at
+least `min_n` samples and a nonzero spread.
+*/
+static int has_shape(const Stats *s, size_t min_n) {
+    return s->moments && s->n >= min_n && m2_total(s) > 0.0;
+}
+
+int stats_skewness_population(const Stats *s, double *out) {
+    if (!s || !out) return -1;
+    if (!has_shape(s, 1)) { *out = 0.0; return -1; }
+    double m2 = m2_total(s);
+    *out = sqrt((double)s->n) * s->m3 / (m2 * sqrt(m2));
+    return 0;
+}
+
+int stats_skewness_sample(const Stats *s, double *out) {
+    if (!s || !out) return -1;
+    if (!has_shape(s, 3)) { *out = 0.0; return -1; }
+    double n = (double)s->n;
+    double g1 = 0.0;
+    (void)stats_skewness_population(s, &g1);
+    *out = g1 * sqrt(n * (n - 1.0)) / (n - 2.0);
+    return 0;
+}
+
+int stats_kurtosis_population(const Stats *s, double *out) {
+    if (!s || !out) return -1;
+    if (!has_shape(s, 1)) { *out = 0.0; return -1; }
+    double m2 = m2_total(s);
+    *out = (double)s->n * s->m4 / (m2 * m2) - 3.0;
+    return 0;
+}
+
+int stats_kurtosis_sample(const Stats *s, double *out) {
+    if (!s || !out) return -1;
+    if (!has_shape(s, 4)) { *out = 0.0; return -1; }
+    double n = (double)s->n;
+    double g2 = 0.0;
+    (void)stats_kurtosis_population(s, &g2);
+    *out = ((n + 1.0) * g2 + 6.0) * (n - 1.0) / ((n - 2.0) * (n - 3.0));
+    return 0;
+}
@@ -0,0 +1,165 @@
+#define _POSIX_C_SOURCE 200809L  // clock_gettime(), getpid()
+
+#include "trace.h"
+#include "csvstat_alloc.h"
+
+#include <stdio.h>
+#include <string.h>    // strncpy
+#include <errno.h>
+#include <time.h>      // clock_gettime
+#include <unistd.h>    // getpid
+#include <pthread.h>
+
+typedef struct {
+    const char *name;
+    uint64_t t0;        // ns since trace_open()
+    uint64_t dur;       // ns
+    uint64_t rows;
+    uint64_t bytes;
+} TraceEvent;
+
+/*
+One thread's ring. Rings are linked into a list when first used and only
+read by trace_close(), after their threads have ended.
+*/
+typedef struct TraceRing {
+    struct TraceRing *next;
+    unsigned tid;               // 1, 2, ... in order of first use
+    char name[32];
+    uint64_t count;             // spans recorded; the ring holds the last ones
+    TraceEvent ev[TRACE_RING_EVENTS];
+} TraceRing;
+
+int trace_enabled = 0;
+
+static FILE *trace_out = NULL;
+static uint64_t trace_origin = 0;
+static TraceRing *rings = NULL;
+static unsigned next_tid = 1;
+static pthread_mutex_t rings_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static _Thread_local TraceRing *my_ring = NULL;
+static _Thread_local int my_ring_failed = 0;
+
+uint64_t trace_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/*
+The calling thread's ring, created on first use. NULL if it could not be
+allocated; the thread's spans are then not recorded.
+*/
+static TraceRing *ring(void) {
+    if (my_ring || my_ring_failed) return my_ring;
+
+    TraceRing *r = csvstat_malloc(ALLOC_TRACE, sizeof *r);
+    if (!r) {
+        my_ring_failed = 1;
+        return NULL;
+    }
+    r->name[0] = '\0';
+    r->count = 0;
+
+    pthread_mutex_lock(&rings_lock);
+    r->tid = next_tid++;
+    r->next = rings;
+    rings = r;
+    pthread_mutex_unlock(&rings_lock);
+
+    my_ring = r;
+    return r;
+}
+
+int trace_open(const char *path) {
+    if (!path) {
+        errno = EINVAL;
+        return -1;
+    }
+    trace_out = fopen(path, "w");
+    if (!trace_out) return -1;
+
+    trace_origin = trace_now();
+    trace_enabled = 1;
+    return 0;
+}
+
+void trace_thread_name(const char *name) {
+    if (!TRACE_ON() || !name) return;
+
+    TraceRing *r = ring();
+    if (!r) return;
+    strncpy(r->name, name, sizeof r->name - 1);
+    r->name[sizeof r->name - 1] = '\0';
+}
+
+void trace_span(const char *name, uint64_t t0, uint64_t rows, uint64_t bytes) {
+    uint64_t t1 = trace_now();
+    TraceRing *r = ring();
+    if (!r) return;
+
+    TraceEvent *e = &r->ev[r->count % TRACE_RING_EVENTS];
+    e->name = name;
+    e->t0 = t0 - trace_origin;
+    e->dur = t1 - t0;
+    e->rows = rows;
+    e->bytes = bytes;
+    r->count++;
+}
+
+/*
+One span; every span follows its thread's name record, hence the comma.
+*/
+static void write_event(FILE *out, long pid, unsigned tid, const TraceEvent *e) {
+    fprintf(out, ",\n{\"name\":\"%s\",\"cat\":\"scan\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                 "\"pid\":%ld,\"tid\":%u",
+            e->name, (double)e->t0 / 1e3, (double)e->dur / 1e3, pid, tid);
+    if (e->rows || e->bytes) {
+        fprintf(out, ",\"args\":{");
+        if (e->rows) fprintf(out, "\"rows\":%llu", (unsigned long long)e->rows);
+        if (e->bytes) fprintf(out, "%s\"bytes\":%llu", e->rows ? "," : "", (unsigned long long)e->bytes);
+        fputc('}', out);
+    }
+    fputc('}', out);
+}
+
+int trace_close(void) {
+    if (!TRACE_ON()) return 0;
+    trace_enabled = 0;
+
+    FILE *out = trace_out;
+    long pid = (long)getpid();
+    uint64_t dropped = 0;
+    int first = 1;
+
+    fprintf(out, "{\"traceEvents\":[");
+    for (TraceRing *r = rings; r; r = r->next) {
+        // Thread names are plain identifiers chosen by the caller.
+        fprintf(out, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%ld,\"tid\":%u,"
+                     "\"args\":{\"name\":\"%s\"}}",
+                first ? "" : ",", pid, r->tid, r->name[0] ? r->name : "thread");
+        first = 0;
+
+        uint64_t n = r->count < TRACE_RING_EVENTS ? r->count : TRACE_RING_EVENTS;
+        dropped += r->count - n;
+        for (uint64_t i = r->count - n; i < r->count; i++) {
+            write_event(out, pid, r->tid, &r->ev[i % TRACE_RING_EVENTS]);
+        }
+    }
+    fprintf(out, "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped_events\":%llu}}\n",
+            (unsigned long long)dropped);
+
+    int rc = ferror(out) ? -1 : 0;
+    if (fclose(out) != 0) rc = -1;
+    if (rc != 0 && errno == 0) errno = EIO;
+    trace_out = NULL;
+
+    while (rings) {
+        TraceRing *next = rings->next;
+        csvstat_free(rings);
+        rings = next;
+    }
+    my_ring = NULL;
+    return rc;
+}
@@ -0,0 +1,78 @@
+#define _POSIX_C_SOURCE 200809L  // nanosleep()
+
+#include "watch.h"
+
+#include <errno.h>
+#include <time.h>      // nanosleep
+#include <unistd.h>    // read, close
+
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#define WATCH_HAVE_INOTIFY 1
+#endif
+
+int file_watch_init(FileWatch *fw, const char *path) {
+    if (!fw || !path) return -1;
+
+    fw->fd = -1;
+    fw->wd = -1;
+
+#ifdef WATCH_HAVE_INOTIFY
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) return 0;  // out of inotify instances: poll instead
+
+    int wd = inotify_add_watch(fd, path, IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB |
+                                         IN_DELETE_SELF | IN_MOVE_SELF);
+    if (wd < 0) {
+        close(fd);
+        return 0;
+    }
+    fw->fd = fd;
+    fw->wd = wd;
+#endif
+
+    return 0;
+}
+
+void file_watch_destroy(FileWatch *fw) {
+    if (!fw) return;
+
+    // Closing the inotify descriptor also removes its watches.
+    if (fw->fd >= 0) close(fw->fd);
+    fw->fd = -1;
+    fw->wd = -1;
+}
+
+int file_watch_wait(FileWatch *fw, int timeout_ms) {
+    if (!fw) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (timeout_ms < 0) timeout_ms = 0;
+
+#ifdef WATCH_HAVE_INOTIFY
+    if (fw->fd >= 0) {
+        struct pollfd pfd = { .fd = fw->fd, .events = POLLIN, .revents = 0 };
+        int rc = poll(&pfd, 1, timeout_ms);
+        if (rc < 0) return (errno == EINTR) ? 0 : -1;
+        if (rc == 0) return 0;
+
+        // Drain the queued events; their details do not matter.
+        char buf[4096];
+        for (;;) {
+            ssize_t n = read(fw->fd, buf, sizeof buf);
+            if (n > 0) continue;
+            if (n < 0 && errno == EINTR) continue;
+            break;
+        }
+        return 1;
+    }
+#endif
+
+    struct timespec ts;
+    ts.tv_sec = timeout_ms / 1000;
+    ts.tv_nsec = (long)(timeout_ms % 1000) * 1000000L;
+    if (nanosleep(&ts, NULL) != 0) return (errno == EINTR) ? 0 : -1;
+    return 1;
+}
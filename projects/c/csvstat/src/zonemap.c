@@ -0,0 +1,400 @@
+#define _POSIX_C_SOURCE 200809L  // stat()
+
+#include "zonemap.h"
+#include "numparse.h"
+#include "csvstat_assert.h"
+#include "csvstat_alloc.h"
+
+#include <stdio.h>     // FILE, fopen, fwrite, fread, rename
+#include <string.h>    // strlen, memcpy, strcmp
+#include <stdint.h>    // uint64_t, SIZE_MAX
+#include <sys/stat.h>  // stat
+
+/*
+Sidecar file layout (native byte order, written field by field)
+---------------------------------------------------------------
+magic        8 bytes  "CSVZMAP1"
+size         u64      source file size
+mtime        i64      source modification time (seconds)
+ncols        u64
+block_rows   u64
+nblocks      u64
+names        ncols x { u64 len, len bytes }
+blocks       nblocks x { u64 start, u64 end, u64 rows,
+                         ncols x { f64 min, f64 max, u64 count, u64 nulls } }
+*/
+
+#define ZONEMAP_MAGIC "CSVZMAP1"
+#define ZONEMAP_DEFAULT_BLOCK_ROWS 8192
+
+/*
+ZoneMap invariants:
+- If cap == 0 then blocks == NULL and cols == NULL
+- nblocks <= cap
+- open implies nblocks > 0
+- names != NULL when ncols > 0
+*/
+int zonemap_is_valid(const ZoneMap *zm) {
+    if (!zm) return 0;
+
+    if (zm->cap == 0 && (zm->blocks != NULL || zm->cols != NULL)) return 0;
+    if (zm->nblocks > zm->cap) return 0;
+    if (zm->open && zm->nblocks == 0) return 0;
+    if (zm->ncols > 0 && zm->names == NULL) return 0;
+
+    return 1;
+}
+
+static void zonemap_zero(ZoneMap *zm) {
+    zm->ncols = 0;
+    zm->names = NULL;
+    zm->block_rows = 0;
+    zm->blocks = NULL;
+    zm->cols = NULL;
+    zm->nblocks = 0;
+    zm->cap = 0;
+    zm->open = 0;
+}
+
+static char *dup_str(const char *s, size_t n) {
+    char *d = (char *)csvstat_malloc(ALLOC_ZONEMAP, n + 1);
+    if (!d) return NULL;
+    memcpy(d, s, n);
+    d[n] = '\0';
+    return d;
+}
+
+/*
+Allocate the name table for `ncols` columns (all NULL).
+*/
+static int alloc_names(ZoneMap *zm, size_t ncols) {
+    if (ncols == 0) return -1;
+    if (ncols > SIZE_MAX / sizeof(char *)) return -1;
+
+    zm->names = (char **)csvstat_calloc(ALLOC_ZONEMAP, ncols, sizeof(char *));
+    if (!zm->names) return -1;
+    zm->ncols = ncols;
+    return 0;
+}
+
+static int ensure_block_capacity(ZoneMap *zm, size_t needed) {
+    CSVSTAT_ASSERT(zonemap_is_valid(zm));
+
+    if (needed <= zm->cap) return 0;
+
+    size_t new_cap = (zm->cap == 0) ? 16 : zm->cap;
+    while (new_cap < needed) {
+        if (new_cap > SIZE_MAX / 2) return -1;
+        new_cap *= 2;
+    }
+    if (new_cap > SIZE_MAX / (zm->ncols * sizeof(ZoneColStats))) return -1;
+
+    ZoneBlock *b = (ZoneBlock *)csvstat_realloc(ALLOC_ZONEMAP, zm->blocks, new_cap * sizeof(ZoneBlock));
+    if (!b) return -1;
+    zm->blocks = b;
+
+    ZoneColStats *c = (ZoneColStats *)csvstat_realloc(ALLOC_ZONEMAP, zm->cols, new_cap * zm->ncols * sizeof(ZoneColStats));
+    if (!c) return -1;
+    zm->cols = c;
+
+    zm->cap = new_cap;
+
+    CSVSTAT_ASSERT(zonemap_is_valid(zm));
+    return 0;
+}
+
+int zonemap_init(ZoneMap *zm, const CsvRowView *header, size_t block_rows) {
+    if (!zm) return -1;
+    zonemap_zero(zm);
+
+    if (!header || header->nfields == 0) return -1;
+
+    if (alloc_names(zm, header->nfields) != 0) return -1;
+
+    for (size_t i = 0; i < header->nfields; i++) {
+        const char *h = header->fields[i] ? header->fields[i] : "";
+        zm->names[i] = dup_str(h, strlen(h));
+        if (!zm->names[i]) {
+            zonemap_destroy(zm);
+            return -1;
+        }
+    }
+
+    zm->block_rows = (block_rows == 0) ? ZONEMAP_DEFAULT_BLOCK_ROWS : block_rows;
+
+    CSVSTAT_ASSERT(zonemap_is_valid(zm));
+    return 0;
+}
+
+void zonemap_destroy(ZoneMap *zm) {
+    if (!zm) return;
+
+    if (zm->names) {
+        for (size_t i = 0; i < zm->ncols; i++) {
+            csvstat_free(zm->names[i]);
+        }
+    }
+    csvstat_free(zm->names);
+    csvstat_free(zm->blocks);
+    csvstat_free(zm->cols);
+
+    zonemap_zero(zm);
+
+    CSVSTAT_ASSERT(zonemap_is_valid(zm));
+}
+
+int zonemap_source_stat(const char *path, ZoneSource *out) {
+    if (!path || !out) return -1;
+
+    struct stat sb;
+    if (stat(path, &sb) != 0) return -1;
+
+    out->size = (unsigned long long)sb.st_size;
+    out->mtime = (long long)sb.st_mtime;
+    return 0;
+}
+
+int zonemap_at_block_start(const ZoneMap *zm) {
+    if (!zm) return 0;
+    if (!zm->open) return 1;
+    return (zm->blocks[zm->nblocks - 1].rows >= zm->block_rows) ? 1 : 0;
+}
+
+static int open_block(ZoneMap *zm, unsigned long long start) {
+    if (ensure_block_capacity(zm, zm->nblocks + 1) != 0) return -1;
+
+    ZoneBlock *b = &zm->blocks[zm->nblocks];
+    b->start = start;
+    b->end = start;
+    b->rows = 0;
+
+    ZoneColStats *c = &zm->cols[zm->nblocks * zm->ncols];
+    for (size_t i = 0; i < zm->ncols; i++) {
+        c[i].min = 0.0;
+        c[i].max = 0.0;
+        c[i].count = 0;
+        c[i].nulls = 0;
+    }
+
+    zm->nblocks++;
+    zm->open = 1;
+    return 0;
+}
+
+int zonemap_add_row(ZoneMap *zm, unsigned long long row_start, const CsvRowView *row) {
+    if (!zm || !row || zm->ncols == 0) return -1;
+
+    CSVSTAT_ASSERT(zonemap_is_valid(zm));
+
+    if (zonemap_at_block_start(zm)) {
+        zonemap_finish(zm, row_start);
+        if (open_block(zm, row_start) != 0) return -1;
+    }
+
+    size_t b = zm->nblocks - 1;
+    zm->blocks[b].rows++;
+
+    ZoneColStats *c = &zm->cols[b * zm->ncols];
+    for (size_t i = 0; i < zm->ncols; i++) {
+        double x = 0.0;
+        if (i >= row->nfields || parse_double_strict(row->fields[i], &x) != 0) {
+            c[i].nulls++;
+            continue;
+        }
+
+        if (c[i].count == 0) {
+            c[i].min = x;
+            c[i].max = x;
+        } else {
+            if (x < c[i].min) c[i].min = x;
+            if (x > c[i].max) c[i].max = x;
+        }
+        c[i].count++;
+    }
+
+    CSVSTAT_ASSERT(zonemap_is_valid(zm));
+    return 0;
+}
+
+void zonemap_finish(ZoneMap *zm, unsigned long long end) {
+    if (!zm || !zm->open) return;
+
+    zm->blocks[zm->nblocks - 1].end = end;
+    zm->open = 0;
+
+    CSVSTAT_ASSERT(zonemap_is_valid(zm));
+}
+
+static int write_u64(FILE *fp, uint64_t v) {
+    return (fwrite(&v, sizeof v, 1, fp) == 1) ? 0 : -1;
+}
+
+static int write_f64(FILE *fp, double v) {
+    return (fwrite(&v, sizeof v, 1, fp) == 1) ? 0 : -1;
+}
+
+static int read_u64(FILE *fp, uint64_t *v) {
+    return (fread(v, sizeof *v, 1, fp) == 1) ? 0 : -1;
+}
+
+static int read_f64(FILE *fp, double *v) {
+    return (fread(v, sizeof *v, 1, fp) == 1) ? 0 : -1;
+}
+
+static int write_body(const ZoneMap *zm, FILE *fp, const ZoneSource *src) {
+    if (fwrite(ZONEMAP_MAGIC, 1, 8, fp) != 8) return -1;
+    if (write_u64(fp, src->size) != 0) return -1;
+    if (write_u64(fp, (uint64_t)src->mtime) != 0) return -1;
+    if (write_u64(fp, zm->ncols) != 0) return -1;
+    if (write_u64(fp, zm->block_rows) != 0) return -1;
+    if (write_u64(fp, zm->nblocks) != 0) return -1;
+
+    for (size_t i = 0; i < zm->ncols; i++) {
+        size_t n = strlen(zm->names[i]);
+        if (write_u64(fp, n) != 0) return -1;
+        if (n > 0 && fwrite(zm->names[i], 1, n, fp) != n) return -1;
+    }
+
+    for (size_t b = 0; b < zm->nblocks; b++) {
+        const ZoneBlock *blk = &zm->blocks[b];
+        if (write_u64(fp, blk->start) != 0) return -1;
+        if (write_u64(fp, blk->end) != 0) return -1;
+        if (write_u64(fp, blk->rows) != 0) return -1;
+
+        const ZoneColStats *c = &zm->cols[b * zm->ncols];
+        for (size_t i = 0; i < zm->ncols; i++) {
+            if (write_f64(fp, c[i].min) != 0) return -1;
+            if (write_f64(fp, c[i].max) != 0) return -1;
+            if (write_u64(fp, c[i].count) != 0) return -1;
+            if (write_u64(fp, c[i].nulls) != 0) return -1;
+        }
+    }
+    return 0;
+}
+
+int zonemap_save(const ZoneMap *zm, const char *path, const ZoneSource *src) {
+    if (!zm || !path || !src || zm->open) return -1;
+
+    CSVSTAT_ASSERT(zonemap_is_valid(zm));
+
+    size_t plen = strlen(path);
+    char *tmp = (char *)csvstat_malloc(ALLOC_ZONEMAP, plen + 5);
+    if (!tmp) return -1;
+    memcpy(tmp, path, plen);
+    memcpy(tmp + plen, ".tmp", 5);
+
+    FILE *fp = fopen(tmp, "wb");
+    if (!fp) {
+        csvstat_free(tmp);
+        return -1;
+    }
+
+    int rc = write_body(zm, fp, src);
+    if (fclose(fp) != 0) rc = -1;
+
+    // Only a completely written file replaces the previous map.
+    if (rc == 0 && rename(tmp, path) != 0) rc = -1;
+    if (rc != 0) remove(tmp);
+
+    csvstat_free(tmp);
+    return rc;
+}
+
+/*
+Read the body of a sidecar file into `zm`.
+
+Returns 0 on success, 1 if the map is stale, -1 on format/alloc errors.
+*/
+static int read_body(ZoneMap *zm, FILE *fp, const ZoneSource *src, const CsvRowView *header) {
+    char magic[8];
+    if (fread(magic, 1, 8, fp) != 8 || memcmp(magic, ZONEMAP_MAGIC, 8) != 0) return -1;
+
+    uint64_t size = 0, mtime = 0, ncols = 0, block_rows = 0, nblocks = 0;
+    if (read_u64(fp, &size) != 0) return -1;
+    if (read_u64(fp, &mtime) != 0) return -1;
+    if (read_u64(fp, &ncols) != 0) return -1;
+    if (read_u64(fp, &block_rows) != 0) return -1;
+    if (read_u64(fp, &nblocks) != 0) return -1;
+
+    if (size != src->size || (long long)mtime != src->mtime) return 1;
+    if (ncols != header->nfields || block_rows == 0) return 1;
+
+    if (alloc_names(zm, (size_t)ncols) != 0) return -1;
+    zm->block_rows = (size_t)block_rows;
+
+    for (size_t i = 0; i < zm->ncols; i++) {
+        uint64_t n = 0;
+        if (read_u64(fp, &n) != 0 || n > size) return -1;
+
+        zm->names[i] = (char *)csvstat_malloc(ALLOC_ZONEMAP, (size_t)n + 1);
+        if (!zm->names[i]) return -1;
+        if (n > 0 && fread(zm->names[i], 1, (size_t)n, fp) != n) return -1;
+        zm->names[i][n] = '\0';
+
+        const char *h = header->fields[i] ? header->fields[i] : "";
+        if (strcmp(zm->names[i], h) != 0) return 1;
+    }
+
+    // Each block covers at least one byte, so nblocks is bounded by the size.
+    if (nblocks > size) return -1;
+    if (nblocks > 0 && ensure_block_capacity(zm, (size_t)nblocks) != 0) return -1;
+
+    for (size_t b = 0; b < (size_t)nblocks; b++) {
+        ZoneBlock *blk = &zm->blocks[b];
+        uint64_t start = 0, end = 0, rows = 0;
+        if (read_u64(fp, &start) != 0) return -1;
+        if (read_u64(fp, &end) != 0) return -1;
+        if (read_u64(fp, &rows) != 0) return -1;
+        if (start > end || end > size) return -1;
+
+        blk->start = start;
+        blk->end = end;
+        blk->rows = (size_t)rows;
+
+        ZoneColStats *c = &zm->cols[b * zm->ncols];
+        for (size_t i = 0; i < zm->ncols; i++) {
+            uint64_t count = 0, nulls = 0;
+            if (read_f64(fp, &c[i].min) != 0) return -1;
+            if (read_f64(fp, &c[i].max) != 0) return -1;
+            if (read_u64(fp, &count) != 0) return -1;
+            if (read_u64(fp, &nulls) != 0) return -1;
+            c[i].count = (size_t)count;
+            c[i].nulls = (size_t)nulls;
+        }
+        zm->nblocks++;
+    }
+
+    return 0;
+}
+
+int zonemap_load(ZoneMap *zm, const char *path, const ZoneSource *src,
+                 const CsvRowView *header) {
+    if (!zm) return -1;
+    zonemap_zero(zm);
+
+    if (!path || !src || !header || header->nfields == 0) return -1;
+
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return 1; // no map yet
+
+    int rc = read_body(zm, fp, src, header);
+    fclose(fp);
+
+    if (rc != 0) {
+        zonemap_destroy(zm);
+        return rc;
+    }
+
+    CSVSTAT_ASSERT(zonemap_is_valid(zm));
+    return 0;
+}
+
+int zonemap_block_may_match(const ZoneMap *zm, size_t b, size_t col,
+                            double lo, double hi) {
+    if (!zm || b >= zm->nblocks || col >= zm->ncols) return 1;
+
+    const ZoneColStats *c = &zm->cols[b * zm->ncols + col];
+    if (c->count == 0) return 0;  // no numeric cells can satisfy a range
+    if (c->max < lo || c->min > hi) return 0;
+    return 1;
+}